@@ -0,0 +1,185 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _ALERT_RECORD_H_
+#define _ALERT_RECORD_H_
+
+#include "osm_object.h"
+#include <string>
+#include <vector>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Immutable description of an aligned way. It contains everything needed
+  // to generate reports so that it can be handed to the report writer
+  class alert_record
+  {
+  public:
+    inline alert_record(const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                        const osm_api_data_types::osm_object::t_osm_id & p_changeset_id,
+                        const std::string & p_user_name,
+                        const osm_api_data_types::osm_object::t_osm_id & p_user_id,
+                        const std::string & p_way_url,
+                        const std::string & p_changeset_url,
+                        const std::string & p_user_url,
+                        const double & p_alignment_modification_rate,
+                        const double & p_min_square_modification_rate,
+                        const std::vector<std::pair<double,double> > & p_old_coordinates,
+                        const std::vector<std::pair<double,double> > & p_new_coordinates,
+                        const double & p_center_lat,
+                        const double & p_center_lon);
+    inline const osm_api_data_types::osm_object::t_osm_id & get_way_id(void)const;
+    inline const osm_api_data_types::osm_object::t_osm_id & get_changeset_id(void)const;
+    inline const std::string & get_user_name(void)const;
+    inline const osm_api_data_types::osm_object::t_osm_id & get_user_id(void)const;
+    inline const std::string & get_way_url(void)const;
+    inline const std::string & get_changeset_url(void)const;
+    inline const std::string & get_user_url(void)const;
+    inline const double & get_alignment_modification_rate(void)const;
+    inline const double & get_min_square_modification_rate(void)const;
+    inline const std::vector<std::pair<double,double> > & get_old_coordinates(void)const;
+    inline const std::vector<std::pair<double,double> > & get_new_coordinates(void)const;
+    inline const double & get_center_lat(void)const;
+    inline const double & get_center_lon(void)const;
+  private:
+    const osm_api_data_types::osm_object::t_osm_id m_way_id;
+    const osm_api_data_types::osm_object::t_osm_id m_changeset_id;
+    const std::string m_user_name;
+    const osm_api_data_types::osm_object::t_osm_id m_user_id;
+    const std::string m_way_url;
+    const std::string m_changeset_url;
+    const std::string m_user_url;
+    const double m_alignment_modification_rate;
+    const double m_min_square_modification_rate;
+    const std::vector<std::pair<double,double> > m_old_coordinates;
+    const std::vector<std::pair<double,double> > m_new_coordinates;
+    const double m_center_lat;
+    const double m_center_lon;
+  };
+
+  //----------------------------------------------------------------------------
+  alert_record::alert_record(const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                             const osm_api_data_types::osm_object::t_osm_id & p_changeset_id,
+                             const std::string & p_user_name,
+                             const osm_api_data_types::osm_object::t_osm_id & p_user_id,
+                             const std::string & p_way_url,
+                             const std::string & p_changeset_url,
+                             const std::string & p_user_url,
+                             const double & p_alignment_modification_rate,
+                             const double & p_min_square_modification_rate,
+                             const std::vector<std::pair<double,double> > & p_old_coordinates,
+                             const std::vector<std::pair<double,double> > & p_new_coordinates,
+                             const double & p_center_lat,
+                             const double & p_center_lon):
+    m_way_id(p_way_id),
+    m_changeset_id(p_changeset_id),
+    m_user_name(p_user_name),
+    m_user_id(p_user_id),
+    m_way_url(p_way_url),
+    m_changeset_url(p_changeset_url),
+    m_user_url(p_user_url),
+    m_alignment_modification_rate(p_alignment_modification_rate),
+    m_min_square_modification_rate(p_min_square_modification_rate),
+    m_old_coordinates(p_old_coordinates),
+    m_new_coordinates(p_new_coordinates),
+    m_center_lat(p_center_lat),
+    m_center_lon(p_center_lon)
+      {
+      }
+
+    //----------------------------------------------------------------------------
+    const osm_api_data_types::osm_object::t_osm_id & alert_record::get_way_id(void)const
+      {
+        return m_way_id;
+      }
+
+    //----------------------------------------------------------------------------
+    const osm_api_data_types::osm_object::t_osm_id & alert_record::get_changeset_id(void)const
+      {
+        return m_changeset_id;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::string & alert_record::get_user_name(void)const
+      {
+        return m_user_name;
+      }
+
+    //----------------------------------------------------------------------------
+    const osm_api_data_types::osm_object::t_osm_id & alert_record::get_user_id(void)const
+      {
+        return m_user_id;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::string & alert_record::get_way_url(void)const
+      {
+        return m_way_url;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::string & alert_record::get_changeset_url(void)const
+      {
+        return m_changeset_url;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::string & alert_record::get_user_url(void)const
+      {
+        return m_user_url;
+      }
+
+    //----------------------------------------------------------------------------
+    const double & alert_record::get_alignment_modification_rate(void)const
+      {
+        return m_alignment_modification_rate;
+      }
+
+    //----------------------------------------------------------------------------
+    const double & alert_record::get_min_square_modification_rate(void)const
+      {
+        return m_min_square_modification_rate;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::vector<std::pair<double,double> > & alert_record::get_old_coordinates(void)const
+      {
+        return m_old_coordinates;
+      }
+
+    //----------------------------------------------------------------------------
+    const std::vector<std::pair<double,double> > & alert_record::get_new_coordinates(void)const
+      {
+        return m_new_coordinates;
+      }
+
+    //----------------------------------------------------------------------------
+    const double & alert_record::get_center_lat(void)const
+      {
+        return m_center_lat;
+      }
+
+    //----------------------------------------------------------------------------
+    const double & alert_record::get_center_lon(void)const
+      {
+        return m_center_lon;
+      }
+}
+#endif // _ALERT_RECORD_H_
+//EOF
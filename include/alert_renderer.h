@@ -0,0 +1,58 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _ALERT_RENDERER_H_
+#define _ALERT_RENDERER_H_
+
+#include "alert_record.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Generation of the human readable views of an alert : SVG picture, GPX
+  // tracks and HTML fragments. Used by the report writer and by the
+  // standalone renderer working on alert streams
+  class alert_renderer
+  {
+  public:
+    // Prefix of the artifact names of an alert : way_<id>_c<changeset>
+    static std::string get_base_name(const alert_record & p_record);
+    static void render_svg(std::ostream & p_stream,
+                           const alert_record & p_record,
+                           bool p_compact,
+                           bool p_decimation);
+    static void render_gpx(std::ostream & p_stream,
+                           const std::string & p_way_name,
+                           const std::vector<std::pair<double,double> > & p_points);
+    static void render_html_header(std::ostream & p_stream,
+                                   const std::string & p_title);
+    static void render_html_footer(std::ostream & p_stream);
+    // Map and picture are omitted when their references are empty
+    static void render_html_alert(std::ostream & p_stream,
+                                  const alert_record & p_record,
+                                  const std::string & p_old_gpx_reference,
+                                  const std::string & p_new_gpx_reference,
+                                  const std::string & p_svg_reference);
+  };
+}
+#endif // _ALERT_RENDERER_H_
+//EOF
@@ -0,0 +1,106 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _ALERT_STREAM_H_
+#define _ALERT_STREAM_H_
+
+#include "alert_record.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Append only machine readable stream of alerts. Two formats are
+  // supported :
+  // - JSONL : one JSON object per line
+  // - BINARY : "NAAL" magic and uint32 format version at file start then
+  //   records prefixed by their uint32 length. Integers and doubles are
+  //   stored little endian, strings and coordinate arrays are prefixed by
+  //   their uint32 size. Version 2 adds way, changeset and user URLs after
+  //   user name
+  class alert_stream
+  {
+  public:
+    typedef enum {JSONL,BINARY} t_format;
+    alert_stream(void);
+    ~alert_stream(void);
+    void open(const std::string & p_file_name,
+              const t_format & p_format);
+    inline bool is_open(void)const;
+    void write(const alert_record & p_record);
+    void flush(void);
+    void close(void);
+    static const uint32_t m_binary_version;
+
+    // Binary stream reading. Header must be read first to know the version
+    static void read_header(std::istream & p_stream,
+                            uint32_t & p_version);
+    // Return NULL at end of stream. Caller takes ownership of record
+    static alert_record * read(std::istream & p_stream,
+                               const uint32_t & p_version);
+  private:
+    void write_json(const alert_record & p_record);
+    static void write_json_string(std::ostream & p_stream,
+                                  const std::string & p_string);
+    static void write_json_coordinates(std::ostream & p_stream,
+                                       const std::vector<std::pair<double,double> > & p_coordinates);
+    void write_binary(const alert_record & p_record);
+    static void append_uint32(std::string & p_buffer,
+                              const uint32_t & p_value);
+    static void append_uint64(std::string & p_buffer,
+                              const uint64_t & p_value);
+    static void append_double(std::string & p_buffer,
+                              const double & p_value);
+    static void append_string(std::string & p_buffer,
+                              const std::string & p_value);
+    static void append_coordinates(std::string & p_buffer,
+                                   const std::vector<std::pair<double,double> > & p_coordinates);
+
+    static uint32_t extract_uint32(const std::string & p_buffer,
+                                   size_t & p_offset);
+    static uint64_t extract_uint64(const std::string & p_buffer,
+                                   size_t & p_offset);
+    static double extract_double(const std::string & p_buffer,
+                                 size_t & p_offset);
+    static std::string extract_string(const std::string & p_buffer,
+                                      size_t & p_offset);
+    static void extract_coordinates(const std::string & p_buffer,
+                                    size_t & p_offset,
+                                    std::vector<std::pair<double,double> > & p_coordinates);
+    static void check_size(const std::string & p_buffer,
+                           const size_t & p_offset,
+                           const size_t & p_size);
+
+    std::ofstream m_file;
+    std::vector<char> m_buffer;
+    t_format m_format;
+    std::string m_record;
+  };
+
+  //----------------------------------------------------------------------------
+  bool alert_stream::is_open(void)const
+  {
+    return m_file.is_open();
+  }
+}
+#endif // _ALERT_STREAM_H_
+//EOF
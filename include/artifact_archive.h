@@ -0,0 +1,76 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _ARTIFACT_ARCHIVE_H_
+#define _ARTIFACT_ARCHIVE_H_
+
+#include <fstream>
+#include <string>
+#include <map>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Append only archive gathering report artifacts in a single data file.
+  // Each entry is referenced by a line "<offset> <size> <name>" appended to
+  // an index file named after the archive with ".idx" suffix. When a name
+  // is appended several times the last entry wins. Browsers cannot read an
+  // entry inside the archive so reports link to the directory in which
+  // node_alignment_renderer unpacks it
+  class artifact_archive
+  {
+  public:
+    artifact_archive(void);
+    ~artifact_archive(void);
+    void open(const std::string & p_file_name);
+    inline bool is_open(void)const;
+    inline const std::string & get_file_name(void)const;
+    void append(const std::string & p_name,
+                const std::string & p_content);
+    void flush(void);
+    void close(void);
+    static bool extract(const std::string & p_file_name,
+                        const std::string & p_name,
+                        std::string & p_content);
+    // Offset and size of each entry by name
+    static void read_index(const std::string & p_file_name,
+                           std::map<std::string,std::pair<uint64_t,uint64_t> > & p_entries);
+    // "<archive>_artifacts" where "<archive>" is file name without ".pack"
+    static std::string get_unpack_directory(const std::string & p_file_name);
+  private:
+    std::string m_file_name;
+    std::ofstream m_data_file;
+    std::ofstream m_index_file;
+    uint64_t m_offset;
+  };
+
+  //----------------------------------------------------------------------------
+  bool artifact_archive::is_open(void)const
+  {
+    return m_data_file.is_open();
+  }
+
+  //----------------------------------------------------------------------------
+  const std::string & artifact_archive::get_file_name(void)const
+  {
+    return m_file_name;
+  }
+}
+#endif // _ARTIFACT_ARCHIVE_H_
+//EOF
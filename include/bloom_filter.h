@@ -0,0 +1,57 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _BLOOM_FILTER_H_
+#define _BLOOM_FILTER_H_
+
+#include <vector>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Approximate membership filter working on 64 bits keys that are already hashed
+  // A negative answer is always right so it can be used as cheap front of a cache
+  class bloom_filter
+  {
+  public:
+    bloom_filter(const uint32_t & p_nb_bits,
+                 const uint32_t & p_nb_hash);
+    void insert(const uint64_t & p_key);
+    bool may_contain(const uint64_t & p_key)const;
+    void clear(void);
+  private:
+    inline uint32_t get_bit_index(const uint64_t & p_key,
+                                  const uint32_t & p_hash_index)const;
+    uint32_t m_nb_bits;
+    uint32_t m_nb_hash;
+    std::vector<uint32_t> m_bits;
+  };
+
+  //----------------------------------------------------------------------------
+  uint32_t bloom_filter::get_bit_index(const uint64_t & p_key,
+                                       const uint32_t & p_hash_index)const
+  {
+    // Double hashing : both halves of the key are used as independent hashes
+    uint32_t l_h1 = (uint32_t)p_key;
+    uint32_t l_h2 = (uint32_t)(p_key >> 32) | 1;
+    return (l_h1 + p_hash_index * l_h2) % m_nb_bits;
+  }
+}
+#endif // _BLOOM_FILTER_H_
+//EOF
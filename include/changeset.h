@@ -22,79 +22,176 @@
 
 #include "osm_api_data_types.h"
 #include "node_alignment_common_api.h"
+#include "checked_way_cache.h"
+#include "known_node_cache.h"
+#include "osm_id_map.h"
+#include "regression_moments.h"
 #include <string>
-#include <fstream>
 #include <set>
 #include <map>
+#include <vector>
 
 namespace osm_diff_analyzer_node_alignment
 {
   class node;
   class way;
   class node_alignment_analyzer;
+  class local_map;
+  class node_location_store;
   class changeset
   {
   public:
-    inline changeset(std::ofstream & p_report,
-                     node_alignment_analyzer & p_analyzer,
+    inline changeset(node_alignment_analyzer & p_analyzer,
                      const osm_api_data_types::osm_object::t_osm_id & p_id,
 		     const std::string & p_user_name,
 		     const osm_api_data_types::osm_object::t_osm_id & p_user_id);
     ~changeset(void);
     void add(const osm_api_data_types::osm_way & p_way);
     void add(const osm_api_data_types::osm_node & p_node);
-    void search_aligned_ways(std::ofstream & p_stream);
-    bool check_way(const osm_api_data_types::osm_object::t_osm_id & p_id,const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs);
+    void search_aligned_ways(void);
+    // False when changeset has not enough possibly moved nodes to make any
+    // way reach check_way thresholds : search can then be skipped
+    bool may_contain_alignment(void)const;
+    bool check_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                   const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                   const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs);
+    bool get_way_alignment_score(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                 double & p_score)const;
+    inline uint32_t get_nb_nodes(void)const;
+    inline const std::string & get_user_name(void)const;
+    // Sequence of the last diff in which changeset has been encountered
+    inline void set_last_seen_diff(const uint64_t & p_diff);
+    inline const uint64_t & get_last_seen_diff(void)const;
+    // Bytes used by changeset : nodes, ways, node references, id sets and
+    // strings. Computed by walking the whole content
+    uint64_t get_memory_footprint(void)const;
     inline static void set_api(node_alignment_common_api & p_api);
+    // Current coordinates of way nodes are taken from store when available
+    inline static void set_node_location_store(const node_location_store * p_store);
     inline static void set_modif_rate_min_level(const float & p_rate);
     inline static void set_min_alignment_modification_rate(const float & p_rate);
     inline static void set_min_way_node_nb(const float & p_rate);
     inline static const float & get_min_alignment_modification_rate(void);
     inline static const uint32_t & get_min_way_node_nb(void);
     inline static const float & get_modif_rate_min_level(void);
+    inline static checked_way_cache & get_checked_way_cache(void);
+    inline static known_node_cache & get_known_node_cache(void);
+    // Minimum number of moved nodes a way needs to pass check_way thresholds
+    static uint32_t get_min_moved_nodes(void);
+    // Moved nodes criterion of check_way : almost all nodes of the way moved
+    inline static bool has_enough_moved_nodes(const uint32_t & p_nb_moved_nodes,
+                                              const uint32_t & p_nb_way_nodes);
+    // Alignment criterion of check_way comparing way geometry before and
+    // after modification. Thread safe as it only depends on its parameters
+    static bool score_alignment(const regression_moments & p_old_moments,
+                                const regression_moments & p_new_moments,
+                                const std::vector<std::pair<double,double> > & p_old_coordinates,
+                                const std::vector<std::pair<double,double> > & p_new_coordinates,
+                                double & p_alignment_modification_rate,
+                                double & p_min_square_modification_rate,
+                                double & p_center_lat,
+                                double & p_center_lon);
+    inline static void set_get_map_max_area(const float & p_area);
+    inline static const float & get_get_map_max_area(void);
+    inline static void set_get_map_min_nodes(const uint32_t & p_nb);
+    inline static const uint32_t & get_get_map_min_nodes(void);
   private:
-    void create_svg(const osm_api_data_types::osm_object::t_osm_id & p_id,
-                    const std::vector<std::pair<double,double> > & p_old_list,
-                    const std::vector<std::pair<double,double> > & p_new_list);
-    void create_gpx(const std::string & p_file_name,
-                    const std::vector<std::pair<double,double> > & p_points);
-    
-    std::ofstream & m_report;
+    // Gather not yet checked parent ways of a node whatever their origin
+    class candidate_collector
+    {
+    public:
+      candidate_collector(const std::set<osm_api_data_types::osm_object::t_osm_id> & p_checked_ways,
+                          std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_candidate_ways);
+      void operator()(const osm_api_data_types::osm_way & p_way);
+      void operator()(const way & p_way);
+    private:
+      const std::set<osm_api_data_types::osm_object::t_osm_id> & m_checked_ways;
+      std::map<osm_api_data_types::osm_object::t_osm_id,way*> & m_candidate_ways;
+    };
+
+    void remove_way(const way & p_way);
+    void set_known_baseline(node & p_node);
+    void load_local_map(void);
+    // Check ways by decreasing number of nodes still to check they cover,
+    // ways covering none of them being optionally skipped
+    void check_by_coverage(const std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_ways,
+                           bool p_skip_uncovered);
+    static void delete_ways(std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_ways);
+    uint32_t count_nodes_to_check(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs)const;
+
     node_alignment_analyzer & m_analyzer;
     const osm_api_data_types::osm_object::t_osm_id m_id;
     const std::string m_user_name;
     const osm_api_data_types::osm_object::t_osm_id m_user_id;
     std::map<osm_api_data_types::osm_object::t_osm_id,way*> m_ways;
-    std::map<osm_api_data_types::osm_object::t_osm_id,node*> m_nodes;
+    osm_id_map<node*> m_nodes;
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<way*> > m_node_ways;
     std::set<osm_api_data_types::osm_object::t_osm_id> m_nodes_to_check;
     std::set<osm_api_data_types::osm_object::t_osm_id> m_checked_ways;
+    local_map * m_local_map;
+    uint64_t m_last_seen_diff;
 
     static node_alignment_common_api * m_api; 
+    static const node_location_store * m_node_location_store;
+    static checked_way_cache m_checked_way_cache;
+    static known_node_cache m_known_node_cache;
 
     static float m_modif_rate_min_level;
     static float m_min_alignment_modification_rate;
     static uint32_t m_min_way_node_nb;
+    static float m_get_map_max_area;
+    static uint32_t m_get_map_min_nodes;
   };
   //----------------------------------------------------------------------------
-  changeset::changeset(std::ofstream & p_report,
-                       node_alignment_analyzer & p_analyzer,
+  changeset::changeset(node_alignment_analyzer & p_analyzer,
                        const osm_api_data_types::osm_object::t_osm_id & p_id,
                        const std::string & p_user_name,
                        const osm_api_data_types::osm_object::t_osm_id & p_user_id):
-    m_report(p_report),
     m_analyzer(p_analyzer),
     m_id(p_id),
     m_user_name(p_user_name),
-    m_user_id(p_user_id)
+    m_user_id(p_user_id),
+    m_local_map(NULL),
+    m_last_seen_diff(0)
       {
       }
 
+   //----------------------------------------------------------------------------
+    uint32_t changeset::get_nb_nodes(void)const
+    {
+      return m_nodes.size();
+    }
+
+   //----------------------------------------------------------------------------
+    const std::string & changeset::get_user_name(void)const
+    {
+      return m_user_name;
+    }
+
+   //----------------------------------------------------------------------------
+    void changeset::set_last_seen_diff(const uint64_t & p_diff)
+    {
+      m_last_seen_diff = p_diff;
+    }
+
+   //----------------------------------------------------------------------------
+    const uint64_t & changeset::get_last_seen_diff(void)const
+    {
+      return m_last_seen_diff;
+    }
+
    //----------------------------------------------------------------------------
     void changeset::set_api(node_alignment_common_api & p_api)
     {
       m_api = & p_api;
     }
 
+   //----------------------------------------------------------------------------
+    void changeset::set_node_location_store(const node_location_store * p_store)
+    {
+      m_node_location_store = p_store;
+    }
+
    //----------------------------------------------------------------------------
     void changeset::set_min_alignment_modification_rate(const float & p_rate)
     {
@@ -131,5 +228,49 @@ namespace osm_diff_analyzer_node_alignment
       return m_modif_rate_min_level;
     }
 
+   //----------------------------------------------------------------------------
+    checked_way_cache & changeset::get_checked_way_cache(void)
+    {
+      return m_checked_way_cache;
+    }
+
+   //----------------------------------------------------------------------------
+    known_node_cache & changeset::get_known_node_cache(void)
+    {
+      return m_known_node_cache;
+    }
+
+   //----------------------------------------------------------------------------
+    bool changeset::has_enough_moved_nodes(const uint32_t & p_nb_moved_nodes,
+                                           const uint32_t & p_nb_way_nodes)
+    {
+      float l_modif_rate = ((float)(p_nb_moved_nodes)/((float)p_nb_way_nodes));
+      return l_modif_rate > m_modif_rate_min_level || p_nb_moved_nodes >= p_nb_way_nodes - 2;
+    }
+
+   //----------------------------------------------------------------------------
+    void changeset::set_get_map_max_area(const float & p_area)
+    {
+      m_get_map_max_area = p_area;
+    }
+
+   //----------------------------------------------------------------------------
+    const float & changeset::get_get_map_max_area(void)
+    {
+      return m_get_map_max_area;
+    }
+
+   //----------------------------------------------------------------------------
+    void changeset::set_get_map_min_nodes(const uint32_t & p_nb)
+    {
+      m_get_map_min_nodes = p_nb;
+    }
+
+   //----------------------------------------------------------------------------
+    const uint32_t & changeset::get_get_map_min_nodes(void)
+    {
+      return m_get_map_min_nodes;
+    }
+
 }
 #endif // _CHANGESET_H_
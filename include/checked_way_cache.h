@@ -0,0 +1,153 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _CHECKED_WAY_CACHE_H_
+#define _CHECKED_WAY_CACHE_H_
+
+#include "osm_core_element.h"
+#include "bloom_filter.h"
+#include <set>
+#include <deque>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Ways found not aligned, shared by all changesets. A way is identified by
+  // its id, its version and a hash of the baseline and current coordinates
+  // of its modified nodes, so that the same move found by another changeset,
+  // like a revert repeated during an edit war, is not checked again. Nodes
+  // left unmodified are not part of the key as fetching them is the cost
+  // saved. Aligned ways are not kept as their alert must be reported by each
+  // changeset finding them
+  class checked_way_cache
+  {
+  public:
+    class key
+    {
+    public:
+      inline key(const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                 const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                 const uint64_t & p_coordinates_hash);
+      inline bool operator<(const key & p_key)const;
+      inline uint64_t get_hash(void)const;
+    private:
+      osm_api_data_types::osm_object::t_osm_id m_way_id;
+      osm_api_data_types::osm_core_element::t_osm_version m_version;
+      uint64_t m_coordinates_hash;
+    };
+
+    checked_way_cache(const uint32_t & p_capacity);
+    void set_capacity(const uint32_t & p_capacity);
+    bool contains(const key & p_key);
+    void insert(const key & p_key);
+    inline const uint32_t & get_capacity(void)const;
+    inline const uint64_t & get_nb_hits(void)const;
+    inline const uint64_t & get_nb_misses(void)const;
+    inline const uint64_t & get_nb_filtered(void)const;
+
+    inline static uint64_t mix(const uint64_t & p_hash,const uint64_t & p_value);
+    inline static uint64_t mix(const uint64_t & p_hash,const float & p_value);
+  private:
+    void rebuild_filter(void);
+
+    uint32_t m_capacity;
+    uint32_t m_nb_evictions;
+    std::set<key> m_results;
+    std::deque<key> m_insertion_order;
+    bloom_filter m_filter;
+    uint64_t m_nb_hits;
+    uint64_t m_nb_misses;
+    uint64_t m_nb_filtered;
+  };
+
+  //----------------------------------------------------------------------------
+  checked_way_cache::key::key(const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                              const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                              const uint64_t & p_coordinates_hash):
+    m_way_id(p_way_id),
+    m_version(p_version),
+    m_coordinates_hash(p_coordinates_hash)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  bool checked_way_cache::key::operator<(const key & p_key)const
+  {
+    if(m_way_id != p_key.m_way_id) return m_way_id < p_key.m_way_id;
+    if(m_version != p_key.m_version) return m_version < p_key.m_version;
+    return m_coordinates_hash < p_key.m_coordinates_hash;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t checked_way_cache::key::get_hash(void)const
+  {
+    return mix(mix(m_coordinates_hash,(uint64_t)m_way_id),(uint64_t)m_version);
+  }
+
+  //----------------------------------------------------------------------------
+  const uint32_t & checked_way_cache::get_capacity(void)const
+  {
+    return m_capacity;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & checked_way_cache::get_nb_hits(void)const
+  {
+    return m_nb_hits;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & checked_way_cache::get_nb_misses(void)const
+  {
+    return m_nb_misses;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & checked_way_cache::get_nb_filtered(void)const
+  {
+    return m_nb_filtered;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t checked_way_cache::mix(const uint64_t & p_hash,const uint64_t & p_value)
+  {
+    // 64 bits finalizer of MurmurHash3 applied on combined value
+    uint64_t l_result = p_hash ^ (p_value + ((((uint64_t)0x9e3779b9) << 32) | 0x7f4a7c15) + (p_hash << 6) + (p_hash >> 2));
+    l_result ^= l_result >> 33;
+    l_result *= ((((uint64_t)0xff51afd7) << 32) | 0xed558ccd);
+    l_result ^= l_result >> 33;
+    l_result *= ((((uint64_t)0xc4ceb9fe) << 32) | 0x1a85ec53);
+    l_result ^= l_result >> 33;
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t checked_way_cache::mix(const uint64_t & p_hash,const float & p_value)
+  {
+    union
+    {
+      float m_float;
+      uint32_t m_int;
+    } l_value;
+    l_value.m_float = p_value;
+    return mix(p_hash,(uint64_t)l_value.m_int);
+  }
+}
+#endif // _CHECKED_WAY_CACHE_H_
+//EOF
@@ -0,0 +1,104 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _KNOWN_NODE_CACHE_H_
+#define _KNOWN_NODE_CACHE_H_
+
+#include "osm_core_element.h"
+#include "osm_id_map.h"
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Coordinates of the last version of nodes seen in diffs. It allows to know
+  // without API request that a node modification did not move it.
+  // Entries are kept in two generations : when current one is full the
+  // previous one is dropped so that memory stays bounded by capacity
+  class known_node_cache
+  {
+  public:
+    known_node_cache(const uint32_t & p_capacity);
+    void set_capacity(const uint32_t & p_capacity);
+    bool find(const osm_api_data_types::osm_object::t_osm_id & p_id,
+              const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+              float & p_lat,
+              float & p_lon)const;
+    void insert(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                const float & p_lat,
+                const float & p_lon);
+    inline const uint32_t & get_capacity(void)const;
+    inline uint32_t size(void)const;
+    inline uint64_t get_memory_footprint(void)const;
+  private:
+    class entry
+    {
+    public:
+      inline entry(void);
+      inline entry(const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                   const float & p_lat,
+                   const float & p_lon);
+      osm_api_data_types::osm_core_element::t_osm_version m_version;
+      float m_lat;
+      float m_lon;
+    };
+
+    uint32_t m_capacity;
+    osm_id_map<entry> m_current;
+    osm_id_map<entry> m_previous;
+  };
+
+  //----------------------------------------------------------------------------
+  known_node_cache::entry::entry(void):
+    m_version(0),
+    m_lat(0.0),
+    m_lon(0.0)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  known_node_cache::entry::entry(const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                 const float & p_lat,
+                                 const float & p_lon):
+    m_version(p_version),
+    m_lat(p_lat),
+    m_lon(p_lon)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  const uint32_t & known_node_cache::get_capacity(void)const
+  {
+    return m_capacity;
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t known_node_cache::size(void)const
+  {
+    return m_current.size() + m_previous.size();
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t known_node_cache::get_memory_footprint(void)const
+  {
+    return sizeof(known_node_cache) - 2 * sizeof(osm_id_map<entry>) + m_current.get_memory_footprint() + m_previous.get_memory_footprint();
+  }
+}
+#endif // _KNOWN_NODE_CACHE_H_
+//EOF
@@ -93,7 +93,7 @@ namespace osm_diff_analyzer_node_alignment
           l_iter != p_list.end();
           ++l_iter)
         {
-          l_num += (l_iter->first - m_average_x) * (l_iter->second - m_average_x);
+          l_num += (l_iter->first - m_average_x) * (l_iter->second - m_average_y);
           l_den += (l_iter->first - m_average_x) * (l_iter->first - m_average_x);
         }  
       if(l_den)
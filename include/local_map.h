@@ -0,0 +1,67 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _LOCAL_MAP_H_
+#define _LOCAL_MAP_H_
+
+#include "osm_api_data_types.h"
+#include <map>
+#include <vector>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  class way;
+
+  // Local snapshot of a map download used to answer node to ways and
+  // current coordinates questions without per node API requests
+  class local_map
+  {
+  public:
+    local_map(void);
+    ~local_map(void);
+    void load(const std::vector<osm_api_data_types::osm_node*> & p_nodes,
+              const std::vector<osm_api_data_types::osm_way*> & p_ways);
+    bool get_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                         float & p_lat,
+                         float & p_lon)const;
+    // Return NULL if node is not part of the snapshot
+    const std::vector<const way*> * get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id)const;
+    inline uint32_t get_nb_nodes(void)const;
+    inline uint32_t get_nb_ways(void)const;
+  private:
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<float,float> > m_nodes_coordinates;
+    std::map<osm_api_data_types::osm_object::t_osm_id,way*> m_ways;
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<const way*> > m_node_ways;
+    static const std::vector<const way*> m_no_way;
+  };
+
+  //----------------------------------------------------------------------------
+  uint32_t local_map::get_nb_nodes(void)const
+  {
+    return m_nodes_coordinates.size();
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t local_map::get_nb_ways(void)const
+  {
+    return m_ways.size();
+  }
+}
+#endif // _LOCAL_MAP_H_
+//EOF
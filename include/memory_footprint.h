@@ -0,0 +1,78 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _MEMORY_FOOTPRINT_H_
+#define _MEMORY_FOOTPRINT_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Heap bytes used by standard containers, assuming node based containers
+  // allocate a red-black tree node (colour and three links) per element and
+  // that short strings are stored inline. Allocator headers are not counted
+  class memory_footprint
+  {
+  public:
+    inline static uint64_t get(const std::string & p_string);
+    template <class T>
+    inline static uint64_t get(const std::vector<T> & p_vector);
+    template <class T>
+    inline static uint64_t get(const std::set<T> & p_set);
+    // Content of mapped values is not taken into account
+    template <class K,class T>
+    inline static uint64_t get(const std::map<K,T> & p_map);
+  private:
+    static const uint64_t m_tree_node_overhead = 4 * sizeof(void*);
+  };
+
+  //----------------------------------------------------------------------------
+  uint64_t memory_footprint::get(const std::string & p_string)
+  {
+    return p_string.capacity() >= sizeof(std::string) ? p_string.capacity() + 1 : 0;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint64_t memory_footprint::get(const std::vector<T> & p_vector)
+  {
+    return p_vector.capacity() * sizeof(T);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint64_t memory_footprint::get(const std::set<T> & p_set)
+  {
+    return p_set.size() * (m_tree_node_overhead + sizeof(T));
+  }
+
+  //----------------------------------------------------------------------------
+  template <class K,class T>
+  uint64_t memory_footprint::get(const std::map<K,T> & p_map)
+  {
+    return p_map.size() * (m_tree_node_overhead + sizeof(typename std::map<K,T>::value_type));
+  }
+}
+#endif // _MEMORY_FOOTPRINT_H_
+//EOF
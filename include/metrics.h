@@ -0,0 +1,174 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _METRICS_H_
+#define _METRICS_H_
+
+#include <string>
+#include <ostream>
+#include <inttypes.h>
+#include <time.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Counters, gauges and latency histograms of the module. When metrics are
+  // disabled each probe is reduced to the test of a boolean
+  class metrics
+  {
+  public:
+    typedef enum
+      {
+        API_GET_NODE=0,
+        API_GET_NODE_VERSION,
+        API_GET_NODE_WAYS,
+        API_GET_NODES,
+        API_GET_WAY,
+        API_GET_WAY_VERSION,
+        API_GET_WAY_FULL,
+        API_GET_MAP,
+        STAGE_MOVE_DETECTION,
+        STAGE_REBUILD,
+        STAGE_REGRESSION,
+        STAGE_REPORTING,
+        CHANGESET_CLOSE,
+        NB_HISTOGRAMS
+      } t_histogram;
+
+    typedef enum
+      {
+        CHECKED_WAYS=0,
+        ALERTS,
+        CLOSED_CHANGESETS,
+        PREFILTERED_NODES,
+        SKIPPED_CHANGESETS,
+        HISTORY_STORE_HITS,
+        NB_COUNTERS
+      } t_counter;
+
+    typedef enum
+      {
+        OPEN_CHANGESETS=0,
+        HELD_NODES,
+        HELD_BYTES,
+        NB_GAUGES
+      } t_gauge;
+
+    // Measure duration between its construction and its destruction
+    class scoped_timer
+    {
+    public:
+      inline scoped_timer(const t_histogram & p_histogram);
+      inline ~scoped_timer(void);
+    private:
+      const t_histogram m_histogram;
+      const uint64_t m_start;
+    };
+
+    inline static void set_enabled(bool p_enabled);
+    inline static bool is_enabled(void);
+    // Return 0 when metrics are disabled
+    inline static uint64_t start(void);
+    inline static void stop(const t_histogram & p_histogram,
+                            const uint64_t & p_start);
+    inline static void increment(const t_counter & p_counter);
+    inline static void set(const t_gauge & p_gauge,
+                           const uint64_t & p_value);
+
+    // Prometheus text format, written in a temporary file renamed at the end
+    // so that a collector never reads a partial file
+    static void write_prometheus(const std::string & p_file_name,
+                                 const std::string & p_analyzer_name);
+    // One line summary of non empty histograms, counters and gauges
+    static void write_summary(std::ostream & p_stream);
+  private:
+    static uint64_t get_time_us(void);
+    static void record(const t_histogram & p_histogram,
+                       const uint64_t & p_duration);
+
+    // Bucket i counts durations lower or equal to 2^i microseconds, last
+    // bucket collects longer durations
+    static const uint32_t m_nb_buckets = 25;
+    static bool m_enabled;
+    static uint64_t m_buckets[NB_HISTOGRAMS][m_nb_buckets + 1];
+    static uint64_t m_sums[NB_HISTOGRAMS];
+    static uint64_t m_counts[NB_HISTOGRAMS];
+    static uint64_t m_counters[NB_COUNTERS];
+    static uint64_t m_gauges[NB_GAUGES];
+  };
+
+  //----------------------------------------------------------------------------
+  metrics::scoped_timer::scoped_timer(const t_histogram & p_histogram):
+    m_histogram(p_histogram),
+    m_start(start())
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  metrics::scoped_timer::~scoped_timer(void)
+  {
+    stop(m_histogram,m_start);
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::set_enabled(bool p_enabled)
+  {
+    m_enabled = p_enabled;
+  }
+
+  //----------------------------------------------------------------------------
+  bool metrics::is_enabled(void)
+  {
+    return m_enabled;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t metrics::start(void)
+  {
+    return m_enabled ? get_time_us() : 0;
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::stop(const t_histogram & p_histogram,
+                     const uint64_t & p_start)
+  {
+    if(m_enabled && p_start)
+      {
+        record(p_histogram,get_time_us() - p_start);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::increment(const t_counter & p_counter)
+  {
+    if(m_enabled)
+      {
+        ++m_counters[p_counter];
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::set(const t_gauge & p_gauge,
+                    const uint64_t & p_value)
+  {
+    m_gauges[p_gauge] = p_value;
+  }
+}
+#endif // _METRICS_H_
+//EOF
@@ -0,0 +1,87 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _MODULE_LOG_H_
+#define _MODULE_LOG_H_
+
+#include <string>
+#include <vector>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Log level filter of the module. Callers test is_enabled before
+  // formatting a message so that disabled levels cost nothing. Deferred
+  // messages are gathered and sent to UI in one call at the end of a diff
+  class module_log
+  {
+  public:
+    typedef enum
+      {
+        ERROR_LEVEL=0,
+        WARNING_LEVEL,
+        INFO_LEVEL,
+        DEBUG_LEVEL
+      } t_level;
+
+    inline module_log(void);
+    inline void set_level(const t_level & p_level);
+    inline bool is_enabled(const t_level & p_level)const;
+    // Message is dropped if its level is disabled
+    inline void defer(const t_level & p_level,
+                      const std::string & p_text);
+    // Return false if there is no deferred message
+    bool flush(std::string & p_text);
+
+    static t_level get_level(const std::string & p_name);
+  private:
+    t_level m_level;
+    std::vector<std::string> m_deferred;
+  };
+
+  //----------------------------------------------------------------------------
+  module_log::module_log(void):
+    m_level(INFO_LEVEL)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void module_log::set_level(const t_level & p_level)
+  {
+    m_level = p_level;
+  }
+
+  //----------------------------------------------------------------------------
+  bool module_log::is_enabled(const t_level & p_level)const
+  {
+    return p_level <= m_level;
+  }
+
+  //----------------------------------------------------------------------------
+  void module_log::defer(const t_level & p_level,
+                         const std::string & p_text)
+  {
+    if(is_enabled(p_level))
+      {
+        m_deferred.push_back(p_text);
+      }
+  }
+}
+#endif // _MODULE_LOG_H_
+//EOF
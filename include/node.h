@@ -21,7 +21,8 @@
 #define _NODE_H_
 
 #include "osm_core_element.h"
-#include <map>
+#include "memory_footprint.h"
+#include <vector>
 
 namespace osm_diff_analyzer_node_alignment
 {
@@ -37,20 +38,43 @@ namespace osm_diff_analyzer_node_alignment
                 const float & p_lat,
                 const float & p_lon,
                 bool p_in_changeset);
-    void attach_to(const way & p_way);
+    void attach_to(way & p_way);
+    void detach_from(const way & p_way);
+    void set_coordinates(const float & p_lat,const float & p_lon);
+    void set_baseline(const float & p_lat,const float & p_lon);
+    // Forget baseline, node is considered as not moved until it is set again
+    void reset_baseline(void);
+    // Earlier version of the node found in the same changeset
+    inline void set_version(const osm_api_data_types::osm_core_element::t_osm_version & p_version);
+    inline void set_latest_version(const osm_api_data_types::osm_core_element::t_osm_version & p_version);
     inline const osm_api_data_types::osm_object::t_osm_id & get_id(void)const;
     inline const float & get_lat(void)const;
     inline const float & get_lon(void)const;
+    inline bool has_baseline(void)const;
+    inline const float & get_baseline_lat(void)const;
+    inline const float & get_baseline_lon(void)const;
+    // First version of the node in changeset : baseline is its previous version
     inline const osm_api_data_types::osm_core_element::t_osm_version & get_version(void)const;
+    // Version the current coordinates belong to
+    inline const osm_api_data_types::osm_core_element::t_osm_version & get_latest_version(void)const;
+    // True if node has moved compared to its baseline or if baseline is unknown
+    inline bool may_have_moved(void)const;
+    // Bytes used by node including its heap allocated members
+    inline uint64_t get_memory_footprint(void)const;
   private:
     const osm_api_data_types::osm_object::t_osm_id m_id;
     const std::string m_user_name;
     const osm_api_data_types::osm_object::t_osm_id m_user_id;
-    const osm_api_data_types::osm_core_element::t_osm_version m_version;
+    osm_api_data_types::osm_core_element::t_osm_version m_version;
+    osm_api_data_types::osm_core_element::t_osm_version m_latest_version;
     float m_lat;
     float m_lon;
+    bool m_has_baseline;
+    float m_baseline_lat;
+    float m_baseline_lon;
     bool m_in_changeset;
-    std::map<osm_api_data_types::osm_object::t_osm_id,const way*> m_ways;
+    // One entry per occurrence of the node in the way to keep way moments consistent
+    std::vector<way*> m_ways;
   };
   //----------------------------------------------------------------------------
   node::node(const osm_api_data_types::osm_object::t_osm_id & p_id,
@@ -64,8 +88,12 @@ namespace osm_diff_analyzer_node_alignment
     m_user_name(p_user_name),
     m_user_id(p_user_id),
     m_version(p_version),
+    m_latest_version(p_version),
     m_lat(p_lat),
     m_lon(p_lon),
+    m_has_baseline(false),
+    m_baseline_lat(0.0),
+    m_baseline_lon(0.0),
     m_in_changeset(p_in_changeset)
       {
       }
@@ -76,6 +104,30 @@ namespace osm_diff_analyzer_node_alignment
         return m_version;
       }
 
+    //----------------------------------------------------------------------------
+    void node::set_version(const osm_api_data_types::osm_core_element::t_osm_version & p_version)
+    {
+      m_version = p_version;
+    }
+
+    //----------------------------------------------------------------------------
+    const osm_api_data_types::osm_core_element::t_osm_version & node::get_latest_version(void)const
+      {
+        return m_latest_version;
+      }
+
+    //----------------------------------------------------------------------------
+    void node::set_latest_version(const osm_api_data_types::osm_core_element::t_osm_version & p_version)
+    {
+      m_latest_version = p_version;
+    }
+
+    //----------------------------------------------------------------------------
+    bool node::may_have_moved(void)const
+    {
+      return !m_has_baseline || m_baseline_lat != m_lat || m_baseline_lon != m_lon;
+    }
+
     //----------------------------------------------------------------------------
     const osm_api_data_types::osm_object::t_osm_id & node::get_id(void)const
       {
@@ -91,6 +143,26 @@ namespace osm_diff_analyzer_node_alignment
       {
         return m_lon;
       }
+    //----------------------------------------------------------------------------
+    bool node::has_baseline(void)const
+    {
+      return m_has_baseline;
+    }
+    //----------------------------------------------------------------------------
+    const float & node::get_baseline_lat(void)const
+      {
+        return m_baseline_lat;
+      }
+    //----------------------------------------------------------------------------
+    const float & node::get_baseline_lon(void)const
+      {
+        return m_baseline_lon;
+      }
+    //----------------------------------------------------------------------------
+    uint64_t node::get_memory_footprint(void)const
+    {
+      return sizeof(node) + memory_footprint::get(m_user_name) + memory_footprint::get(m_ways);
+    }
 }
 
 #endif // _NODE_H_
@@ -25,6 +25,12 @@
 #include "node_alignment_common_api.h"
 #include "module_configuration.h"
 #include "changeset.h"
+#include "report_writer.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "module_log.h"
+#include "node_location_store.h"
+#include "node_history_store.h"
 #include "quicky_exception.h"
 
 #include <inttypes.h>
@@ -34,6 +40,8 @@
 #include <sstream>
 #include <set>
 #include <iomanip>
+#include <ctime>
+#include <memory>
 
 namespace osm_diff_analyzer_node_alignment
 {
@@ -53,51 +61,85 @@ namespace osm_diff_analyzer_node_alignment
     const std::string & get_type(void)const;
     // End of inherited methods
     void create_report(void);
+    // Analyzer takes ownership of record
+    void report_alert(const alert_record * p_record);
   private:
     void analyze_current_changesets(void);
+    bool is_report_rotation_needed(void);
+    uint32_t get_next_report_number(void);
+    // Refresh gauges before their export
+    void update_metrics(void);
+    // Compute footprint of open changesets and log the largest ones
+    void log_memory_footprint(void);
+    // Offline comparison of two extracts reported like diff alerts
+    void run_snapshot_diff(const std::string & p_old_file_name,
+                           const std::string & p_new_file_name,
+                           const uint32_t & p_nb_threads);
+    // Keep node location and history stores up to date with diff content
+    void update_node_stores(const osm_api_data_types::osm_change & p_change);
     template <class T>
-      void generic_analyze(const osm_api_data_types::osm_core_element & p_object);
+      inline void generic_analyze(const T & p_object);
 
     node_alignment_common_api & m_api;
-    std::ofstream m_report;
-    std::map<osm_api_data_types::osm_object::t_osm_id,changeset *> m_changesets;
-    std::set<osm_api_data_types::osm_object::t_osm_id> m_encountered_changesets;
+    report_writer m_report_writer;
+    bool m_report_created;
+    bool m_html_report;
+    // Rotation limits, 0 meaning no limit
+    uint64_t m_report_max_size;
+    uint32_t m_report_max_alerts;
+    uint32_t m_report_max_age;
+    uint32_t m_report_nb_alerts;
+    time_t m_report_creation_time;
+    bool m_report_number_loaded;
+    uint32_t m_report_number;
+    bool m_metrics;
+    std::string m_metrics_file_name;
+    // Minimum delay in seconds between two exports of metrics file
+    uint32_t m_metrics_interval;
+    time_t m_metrics_export_time;
+    // Number of largest changesets logged at each diff, 0 to disable
+    uint32_t m_memory_top_changesets;
+    uint64_t m_changesets_footprint;
+    osm_id_map<changeset *> m_changesets;
+    // Incremented at each diff, changesets not stamped with current value
+    // at the beginning of next diff are considered as closed
+    uint64_t m_diff_number;
+    module_log m_log;
+    uint32_t m_nb_created_changesets;
+    // NULL when current coordinates are requested to API
+    std::auto_ptr<node_location_store> m_node_location_store;
+    // NULL when previous versions are requested to API
+    std::auto_ptr<node_history_store> m_node_history_store;
+    // Extracts compared by first diff, empty when there is no comparison
+    std::string m_snapshot_old_file_name;
+    std::string m_snapshot_new_file_name;
+    uint32_t m_snapshot_threads;
     static node_alignment_analyzer_description m_description;
   };
   //------------------------------------------------------------------------------
   template <class T>
-    void node_alignment_analyzer::generic_analyze(const osm_api_data_types::osm_core_element & p_object)
+    void node_alignment_analyzer::generic_analyze(const T & p_object)
   {
-
-#ifndef FORCE_USE_OF_REINTERPRET_CAST
-    const T * const l_casted_object = dynamic_cast<const T * const>(&p_object) != NULL ? dynamic_cast<const T * const>(&p_object) : reinterpret_cast<const T * const>(&p_object);
-#else
-    const T * const l_casted_object = reinterpret_cast<const T * const>(&p_object);
-#endif // FORCE_USE_OF_REINTERPRET_CAST
-
-    if(l_casted_object==NULL)
-      {
-	std::stringstream l_stream;
-        l_stream << "ERROR : invalid " << T::get_type_str() << " cast for object id " << p_object.get_id() ;
-	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
-      }
-
     // Extract changeset
-    osm_api_data_types::osm_object::t_osm_id l_changeset_id = l_casted_object->get_changeset();
-    osm_api_data_types::osm_object::t_osm_id l_user_id = l_casted_object->get_user_id();
-    const std::string & l_user_name = l_casted_object->get_user();
+    osm_api_data_types::osm_object::t_osm_id l_changeset_id = p_object.get_changeset();
     
-    // Mark changeset as encountered
-    m_encountered_changesets.insert(l_changeset_id);
-    std::map<osm_api_data_types::osm_object::t_osm_id,changeset *>::iterator l_changeset_iter = m_changesets.find(l_changeset_id);
+    osm_id_map<changeset *>::iterator l_changeset_iter = m_changesets.find(l_changeset_id);
     if(l_changeset_iter == m_changesets.end())
       {
-	std::stringstream l_stream;
-        l_stream << "Create changeset " << l_changeset_id ;
-	m_api.ui_append_log_text(*this,l_stream.str());
-        l_changeset_iter = m_changesets.insert(std::map<osm_api_data_types::osm_object::t_osm_id,changeset *>::value_type(l_changeset_id,new changeset(m_report,*this,l_changeset_id,l_user_name,l_user_id))).first;
+        // Creations are summarised once per diff, detail is only formatted
+        // in debug level
+        ++m_nb_created_changesets;
+        if(m_log.is_enabled(module_log::DEBUG_LEVEL))
+          {
+            std::stringstream l_stream;
+            l_stream << "Create changeset " << l_changeset_id ;
+            m_log.defer(module_log::DEBUG_LEVEL,l_stream.str());
+          }
+        l_changeset_iter = m_changesets.insert(osm_id_map<changeset *>::value_type(l_changeset_id,new changeset(*this,l_changeset_id,p_object.get_user(),p_object.get_user_id()))).first;
       }
-    l_changeset_iter->second->add(*l_casted_object);
+    // Mark changeset as encountered
+    l_changeset_iter->second->set_last_seen_diff(m_diff_number);
+    l_changeset_iter->second->add(p_object);
   }
 }
 #endif
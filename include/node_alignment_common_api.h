@@ -21,9 +21,27 @@
 #define _NODE_ALIGNMENT_COMMON_API_H_
 
 #include "common_api_if.h"
+#include "metrics.h"
+#include "tracer.h"
+#include "node_history_store.h"
 
 namespace osm_diff_analyzer_node_alignment
 {
+  // Take ownership of a vector of objects returned by the common API and
+  // release it with its content when going out of scope
+  template <class T>
+  class api_vector_holder
+  {
+  public:
+    inline api_vector_holder(const std::vector<T*> * const p_vector);
+    inline ~api_vector_holder(void);
+    inline const std::vector<T*> & get(void)const;
+  private:
+    api_vector_holder(const api_vector_holder & p_holder);
+    api_vector_holder & operator=(const api_vector_holder & p_holder);
+    const std::vector<T*> * const m_vector;
+  };
+
   class node_alignment_common_api
   {
   public:
@@ -37,12 +55,25 @@ namespace osm_diff_analyzer_node_alignment
     inline const osm_api_data_types::osm_node * get_node_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
 								 const osm_api_data_types::osm_core_element::t_osm_version & p_version=0,
 								 void * p_user_data=NULL);
+    // Read node coordinates without keeping the object allocated by host
+    inline bool get_node_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                     const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                     float & p_lat,
+                                     float & p_lon,
+                                     void * p_user_data=NULL);
     inline const std::vector<osm_api_data_types::osm_node*> * const get_node_history(const osm_api_data_types::osm_object::t_osm_id & p_id,
 										     void * p_user_data = NULL);
 
     inline const std::vector<osm_api_data_types::osm_way*> * const get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
                                                                                  void * p_user_data = NULL);
 
+    // Call p_visitor(const osm_api_data_types::osm_way &) for each way of
+    // node. Ways allocated by host are released when visit is done
+    template <class T>
+    inline void visit_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                T & p_visitor,
+                                void * p_user_data = NULL);
+
     inline const std::vector<osm_api_data_types::osm_relation*> * const get_node_relations(const osm_api_data_types::osm_object::t_osm_id & p_id,
 											   void * p_user_data = NULL);
 
@@ -137,6 +168,9 @@ namespace osm_diff_analyzer_node_alignment
     inline void ui_declare_html_report(const osm_diff_analyzer_if::analyzer_base & p_module,
 				       const std::string & p_name);
 
+    // Local history consulted before API for coordinates of node versions,
+    // NULL to disable
+    inline void set_node_history_store(const node_history_store * p_store);
 
   private:
     osm_diff_analyzer_if::common_api_if::t_get_user_subscription_date m_get_user_subscription_date;
@@ -174,10 +208,40 @@ namespace osm_diff_analyzer_node_alignment
     osm_diff_analyzer_if::common_api_if::t_ui_register_module m_ui_register_module;
     osm_diff_analyzer_if::common_api_if::t_ui_append_log_text m_ui_append_log_text;
     osm_diff_analyzer_if::common_api_if::t_ui_declare_html_report m_ui_declare_html_report;
+    const node_history_store * m_node_history_store;
   };
 
+  //----------------------------------------------------------------------------
+  template <class T>
+  api_vector_holder<T>::api_vector_holder(const std::vector<T*> * const p_vector):
+    m_vector(p_vector)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  api_vector_holder<T>::~api_vector_holder(void)
+  {
+    if(m_vector == NULL) return;
+    for(typename std::vector<T*>::const_iterator l_iter = m_vector->begin();
+        l_iter != m_vector->end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+    delete m_vector;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  const std::vector<T*> & api_vector_holder<T>::get(void)const
+  {
+    return *m_vector;
+  }
+
   //---------------------------------------------------------------------------- 
-  node_alignment_common_api::node_alignment_common_api(osm_diff_analyzer_if::module_library_if::t_register_function p_func) 
+  node_alignment_common_api::node_alignment_common_api(osm_diff_analyzer_if::module_library_if::t_register_function p_func):
+    m_node_history_store(NULL)
     {
       uintptr_t l_api_ptr[COMMON_API_IF_SIZE];
       for(uint32_t l_index = 0 ;l_index < COMMON_API_IF_SIZE ; ++l_index)
@@ -235,6 +299,8 @@ namespace osm_diff_analyzer_node_alignment
   const osm_api_data_types::osm_node * node_alignment_common_api::get_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
 								       void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_NODE);
+      tracer::scoped_span l_span("get_node");
       return m_get_node(p_id,p_user_data);
     }
   //----------------------------------------------------------------------------
@@ -242,8 +308,37 @@ namespace osm_diff_analyzer_node_alignment
 									       const osm_api_data_types::osm_core_element::t_osm_version & p_version,
 									       void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_NODE_VERSION);
+      tracer::scoped_span l_span("get_node_version");
       return m_get_node_version(p_id,p_version,p_user_data);
     }
+  //----------------------------------------------------------------------------
+  bool node_alignment_common_api::get_node_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                       const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                       float & p_lat,
+                                                       float & p_lon,
+                                                       void * p_user_data)
+  {
+    // Version 0 means current version which cannot be known from history
+    if(p_version && m_node_history_store != NULL && m_node_history_store->get(p_id,p_version,p_lat,p_lon))
+      {
+        metrics::increment(metrics::HISTORY_STORE_HITS);
+        return true;
+      }
+    tracer::scoped_span l_span("get_node_version");
+    uint64_t l_start = metrics::start();
+    const osm_api_data_types::osm_node * l_node = m_get_node_version(p_id,p_version,p_user_data);
+    metrics::stop(metrics::API_GET_NODE_VERSION,l_start);
+    if(l_node == NULL)
+      {
+        return false;
+      }
+    p_lat = l_node->get_lat();
+    p_lon = l_node->get_lon();
+    delete l_node;
+    return true;
+  }
+
   //----------------------------------------------------------------------------
   const std::vector<osm_api_data_types::osm_node*> * const node_alignment_common_api::get_node_history(const osm_api_data_types::osm_object::t_osm_id & p_id,
 												   void * p_user_data)
@@ -255,8 +350,28 @@ namespace osm_diff_analyzer_node_alignment
   const std::vector<osm_api_data_types::osm_way*> * const node_alignment_common_api::get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
 											       void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_NODE_WAYS);
+      tracer::scoped_span l_span("get_node_ways");
       return m_get_node_ways(p_id,p_user_data);
     }
+  //----------------------------------------------------------------------------
+  template <class T>
+  void node_alignment_common_api::visit_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                  T & p_visitor,
+                                                  void * p_user_data)
+  {
+    tracer::scoped_span l_span("get_node_ways");
+    uint64_t l_start = metrics::start();
+    api_vector_holder<osm_api_data_types::osm_way> l_ways(m_get_node_ways(p_id,p_user_data));
+    metrics::stop(metrics::API_GET_NODE_WAYS,l_start);
+    for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_iter = l_ways.get().begin();
+        l_iter != l_ways.get().end();
+        ++l_iter)
+      {
+        p_visitor(**l_iter);
+      }
+  }
+
   //----------------------------------------------------------------------------
   const std::vector<osm_api_data_types::osm_relation*> * const node_alignment_common_api::get_node_relations(const osm_api_data_types::osm_object::t_osm_id & p_id,
 													 void * p_user_data)
@@ -267,6 +382,8 @@ namespace osm_diff_analyzer_node_alignment
   const std::vector<osm_api_data_types::osm_node*> * const node_alignment_common_api::get_nodes(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_ids,
 											    void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_NODES);
+      tracer::scoped_span l_span("get_nodes");
       return m_get_nodes(p_ids,p_user_data);
     }
 
@@ -274,6 +391,8 @@ namespace osm_diff_analyzer_node_alignment
   const osm_api_data_types::osm_way * node_alignment_common_api::get_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
 								     void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_WAY);
+      tracer::scoped_span l_span("get_way");
       return m_get_way(p_id,p_user_data);
     }
   //----------------------------------------------------------------------------
@@ -281,6 +400,8 @@ namespace osm_diff_analyzer_node_alignment
 									     const osm_api_data_types::osm_core_element::t_osm_version & p_version,
 									     void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_WAY_VERSION);
+      tracer::scoped_span l_span("get_way_version");
       return m_get_way_version(p_id,p_version,p_user_data);
     }
   //----------------------------------------------------------------------------
@@ -300,6 +421,8 @@ namespace osm_diff_analyzer_node_alignment
 										std::vector<osm_api_data_types::osm_node*> & p_nodes,
 										void * p_user_data)
     {
+      metrics::scoped_timer l_timer(metrics::API_GET_WAY_FULL);
+      tracer::scoped_span l_span("get_way_full");
       return m_get_way_full(p_id,p_nodes,p_user_data);
     }
 
@@ -384,6 +507,8 @@ namespace osm_diff_analyzer_node_alignment
 				      std::vector<osm_api_data_types::osm_relation*> & p_relations,
 				      void *p_user_data)
   {
+    metrics::scoped_timer l_timer(metrics::API_GET_MAP);
+    tracer::scoped_span l_span("get_map");
     return m_get_map(p_bounding_box,p_nodes,p_ways,p_relations,p_user_data);
   }
 
@@ -473,6 +598,12 @@ namespace osm_diff_analyzer_node_alignment
     m_ui_declare_html_report(p_module,p_name);
   }
 
+  //----------------------------------------------------------------------------
+  void node_alignment_common_api::set_node_history_store(const node_history_store * p_store)
+  {
+    m_node_history_store = p_store;
+  }
+
 
 }
 #endif // _NODE_ALIGNMENT_COMMON_API_H_
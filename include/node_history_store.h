@@ -0,0 +1,235 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _NODE_HISTORY_STORE_H_
+#define _NODE_HISTORY_STORE_H_
+
+#include "node_location_store.h"
+#include "osm_core_element.h"
+#include <map>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Append only file giving coordinates of any node version from its id and
+  // version number without network access. File is a sequence of runs of
+  // records sorted by (id,version). A sparse index containing first key of
+  // each block of records is kept in memory for each run so that a lookup
+  // costs a search in index and a search in a single block of mapped file.
+  // New versions are buffered and appended as a new run when flushed, runs
+  // being merged when they become too numerous
+  class node_history_store
+  {
+  public:
+    // File is created if it does not exist
+    node_history_store(const std::string & p_file_name);
+    // Versions added since last flush are lost
+    ~node_history_store(void);
+    inline bool get(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                    const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                    float & p_lat,
+                    float & p_lon)const;
+    // Versions are only buffered, ids or versions out of key range are
+    // ignored
+    void add(const osm_api_data_types::osm_object::t_osm_id & p_id,
+             const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+             const float & p_lat,
+             const float & p_lon);
+    // Append buffered versions as a new run
+    void flush(void);
+    // Rewrite the whole file as a single run
+    void compact(void);
+    inline uint64_t get_nb_records(void)const;
+    inline uint32_t get_nb_runs(void)const;
+    inline uint64_t get_nb_pending(void)const;
+    inline const std::string & get_file_name(void)const;
+    // Number of buffered versions triggering an automatic flush
+    inline void set_max_pending(const uint64_t & p_max_pending);
+  private:
+    class record
+    {
+    public:
+      uint64_t m_key;
+      uint32_t m_lat;
+      uint32_t m_lon;
+    };
+    class run_header
+    {
+    public:
+      uint64_t m_nb_records;
+      // Non null when run content has been merged in a later run
+      uint64_t m_merged;
+    };
+    class run
+    {
+    public:
+      inline const record * find(const uint64_t & p_key)const;
+      uint64_t m_offset;
+      const record * m_records;
+      uint64_t m_nb_records;
+      uint64_t m_first_key;
+      uint64_t m_last_key;
+      // First key of each block, about 1/128 of run size
+      std::vector<uint64_t> m_index;
+    };
+    typedef std::pair<const record *,const record *> t_range;
+
+    inline static uint64_t get_key(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                   const osm_api_data_types::osm_core_element::t_osm_version & p_version);
+    inline static bool compare_key(const record & p_record,const uint64_t & p_key);
+
+    // Map the file and rebase records of already loaded runs on the mapping
+    void map(void);
+    void unmap(void);
+    // Load and index runs located from given offset to the end of file
+    void load_runs(const uint64_t & p_offset);
+    // Merge sorted ranges in a run written at given offset of file. When a key
+    // is present in several ranges the last range wins. Return run size
+    uint64_t write_run(int p_file,
+                       const uint64_t & p_offset,
+                       const std::vector<t_range> & p_ranges);
+    // Merge all runs following the first one in a new run
+    void merge_last_runs(void);
+    void write_header(int p_file);
+    void write(int p_file,
+               const void * p_data,
+               const uint64_t & p_size,
+               const uint64_t & p_offset);
+    void throw_error(const std::string & p_message)const;
+
+    static const char m_magic[8];
+    static const uint64_t m_header_size;
+    // Known at compile time to keep lookup arithmetic cheap
+    static const uint32_t m_block_size = 64;
+    static const uint32_t m_version_bits = 24;
+    static const uint32_t m_id_bits = 64 - m_version_bits;
+    static const uint32_t m_max_runs;
+
+    std::string m_file_name;
+    int m_file;
+    uint64_t m_file_size;
+    char * m_data;
+    uint64_t m_nb_records;
+    // Size occupied by runs merged in later runs
+    uint64_t m_merged_size;
+    uint64_t m_max_pending;
+    // Runs from the oldest to the newest
+    std::vector<run> m_runs;
+    std::map<uint64_t,std::pair<uint32_t,uint32_t> > m_pending;
+  };
+
+  //----------------------------------------------------------------------------
+  uint64_t node_history_store::get_key(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                       const osm_api_data_types::osm_core_element::t_osm_version & p_version)
+  {
+    return (((uint64_t)p_id) << m_version_bits) | p_version;
+  }
+
+  //----------------------------------------------------------------------------
+  bool node_history_store::compare_key(const record & p_record,const uint64_t & p_key)
+  {
+    return p_record.m_key < p_key;
+  }
+
+  //----------------------------------------------------------------------------
+  const node_history_store::record * node_history_store::run::find(const uint64_t & p_key)const
+  {
+    if(p_key < m_first_key || p_key > m_last_key)
+      {
+        return NULL;
+      }
+    // Block to search is the last one whose first key is not greater than key
+    uint64_t l_block = std::upper_bound(m_index.begin(),m_index.end(),p_key) - m_index.begin() - 1;
+    const record * l_begin = m_records + l_block * m_block_size;
+    const record * l_end = l_block + 1 < m_index.size() ? l_begin + m_block_size : m_records + m_nb_records;
+    const record * l_record = std::lower_bound(l_begin,l_end,p_key,compare_key);
+    return l_record != l_end && l_record->m_key == p_key ? l_record : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  bool node_history_store::get(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                               const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                               float & p_lat,
+                               float & p_lon)const
+  {
+    if((((uint64_t)p_id) >> m_id_bits) || (p_version >> m_version_bits))
+      {
+        return false;
+      }
+    uint64_t l_key = get_key(p_id,p_version);
+    if(m_pending.size())
+      {
+        std::map<uint64_t,std::pair<uint32_t,uint32_t> >::const_iterator l_iter = m_pending.find(l_key);
+        if(l_iter != m_pending.end())
+          {
+            p_lat = node_location_store::decode_lat(l_iter->second.first);
+            p_lon = node_location_store::decode_lon(l_iter->second.second);
+            return true;
+          }
+      }
+    for(std::vector<run>::const_reverse_iterator l_iter = m_runs.rbegin();
+        l_iter != m_runs.rend();
+        ++l_iter)
+      {
+        const record * l_record = l_iter->find(l_key);
+        if(l_record != NULL)
+          {
+            p_lat = node_location_store::decode_lat(l_record->m_lat);
+            p_lon = node_location_store::decode_lon(l_record->m_lon);
+            return true;
+          }
+      }
+    return false;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t node_history_store::get_nb_records(void)const
+  {
+    return m_nb_records;
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t node_history_store::get_nb_runs(void)const
+  {
+    return m_runs.size();
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t node_history_store::get_nb_pending(void)const
+  {
+    return m_pending.size();
+  }
+
+  //----------------------------------------------------------------------------
+  const std::string & node_history_store::get_file_name(void)const
+  {
+    return m_file_name;
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::set_max_pending(const uint64_t & p_max_pending)
+  {
+    m_max_pending = p_max_pending;
+  }
+}
+#endif // _NODE_HISTORY_STORE_H_
+//EOF
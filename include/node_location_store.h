@@ -0,0 +1,130 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _NODE_LOCATION_STORE_H_
+#define _NODE_LOCATION_STORE_H_
+
+#include "osm_object.h"
+#include <string>
+#include <cmath>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Dense memory mapped array giving current coordinates of a node from its
+  // id with a single index. Coordinates are stored as fixed point integers
+  // with OSM precision (1e-7 degree) shifted so that 0 means unknown node :
+  // never written parts of the file remain sparse on disk
+  class node_location_store
+  {
+  public:
+    // File is created if it does not exist
+    node_location_store(const std::string & p_file_name);
+    ~node_location_store(void);
+    inline bool get(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                    float & p_lat,
+                    float & p_lon)const;
+    void set(const osm_api_data_types::osm_object::t_osm_id & p_id,
+             const float & p_lat,
+             const float & p_lon);
+    void remove(const osm_api_data_types::osm_object::t_osm_id & p_id);
+    // Write modified pages to disk
+    void sync(void);
+    inline const uint64_t & get_capacity(void)const;
+    inline const std::string & get_file_name(void)const;
+
+    // Fixed point representation shared with node_history_store, never null
+    // for a valid coordinate
+    inline static uint32_t encode_lat(const float & p_lat);
+    inline static uint32_t encode_lon(const float & p_lon);
+    inline static float decode_lat(const uint32_t & p_lat);
+    inline static float decode_lon(const uint32_t & p_lon);
+  private:
+    class location
+    {
+    public:
+      uint32_t m_lat;
+      uint32_t m_lon;
+    };
+    void map(const uint64_t & p_capacity);
+    void unmap(void);
+
+    static const char m_magic[8];
+    static const uint64_t m_header_size;
+    static const uint64_t m_min_capacity;
+
+    std::string m_file_name;
+    int m_file;
+    uint64_t m_capacity;
+    char * m_data;
+    location * m_locations;
+  };
+
+  //----------------------------------------------------------------------------
+  bool node_location_store::get(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                float & p_lat,
+                                float & p_lon)const
+  {
+    if(p_id >= m_capacity || !m_locations[p_id].m_lat)
+      {
+        return false;
+      }
+    p_lat = decode_lat(m_locations[p_id].m_lat);
+    p_lon = decode_lon(m_locations[p_id].m_lon);
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t node_location_store::encode_lat(const float & p_lat)
+  {
+    return (uint32_t)floor((p_lat + 90.0) * 10000000.0 + 0.5) + 1;
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t node_location_store::encode_lon(const float & p_lon)
+  {
+    return (uint32_t)floor((p_lon + 180.0) * 10000000.0 + 0.5) + 1;
+  }
+
+  //----------------------------------------------------------------------------
+  float node_location_store::decode_lat(const uint32_t & p_lat)
+  {
+    return (float)(((double)(p_lat - 1)) / 10000000.0 - 90.0);
+  }
+
+  //----------------------------------------------------------------------------
+  float node_location_store::decode_lon(const uint32_t & p_lon)
+  {
+    return (float)(((double)(p_lon - 1)) / 10000000.0 - 180.0);
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & node_location_store::get_capacity(void)const
+  {
+    return m_capacity;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::string & node_location_store::get_file_name(void)const
+  {
+    return m_file_name;
+  }
+}
+#endif // _NODE_LOCATION_STORE_H_
+//EOF
@@ -0,0 +1,432 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _OSM_ID_MAP_H_
+#define _OSM_ID_MAP_H_
+
+#include "osm_object.h"
+#include <algorithm>
+#include <vector>
+#include <utility>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Open addressing hash map specialised for OSM ids with linear probing and
+  // backward shift deletion. Entries are stored contiguously so that a
+  // lookup usually touches a single cache line and inserting does not
+  // allocate once the table is large enough. Interface is the subset of
+  // std::map used by the module. Iteration order is unspecified and
+  // iterators are invalidated by insert and erase
+  template <class T>
+  class osm_id_map
+  {
+  public:
+    typedef osm_api_data_types::osm_object::t_osm_id key_type;
+    typedef std::pair<key_type,T> value_type;
+
+    template <class V,class M>
+    class base_iterator
+    {
+    public:
+      inline base_iterator(M * p_map,
+                           const uint32_t & p_index);
+      // Conversion from iterator to const_iterator
+      template <class V2,class M2>
+      inline base_iterator(const base_iterator<V2,M2> & p_iterator);
+      inline V & operator*(void)const;
+      inline V * operator->(void)const;
+      inline base_iterator & operator++(void);
+      inline bool operator==(const base_iterator & p_iterator)const;
+      inline bool operator!=(const base_iterator & p_iterator)const;
+      inline M * get_map(void)const;
+      inline const uint32_t & get_index(void)const;
+    private:
+      M * m_map;
+      uint32_t m_index;
+    };
+
+    typedef base_iterator<value_type,osm_id_map> iterator;
+    typedef base_iterator<const value_type,const osm_id_map> const_iterator;
+
+    inline osm_id_map(void);
+    inline iterator begin(void);
+    inline iterator end(void);
+    inline const_iterator begin(void)const;
+    inline const_iterator end(void)const;
+    inline iterator find(const key_type & p_key);
+    inline const_iterator find(const key_type & p_key)const;
+    inline std::pair<iterator,bool> insert(const value_type & p_value);
+    inline T & operator[](const key_type & p_key);
+    inline void erase(iterator p_iterator);
+    inline uint32_t erase(const key_type & p_key);
+    inline uint32_t size(void)const;
+    inline bool empty(void)const;
+    inline void clear(void);
+    inline void swap(osm_id_map & p_map);
+    inline uint64_t get_memory_footprint(void)const;
+  private:
+    inline static uint32_t hash(const key_type & p_key);
+    // Id 0 marks empty slots so it is stored in an extra slot after the table
+    inline bool is_used(const uint32_t & p_index)const;
+    inline uint32_t get_slot(const key_type & p_key)const;
+    inline void rehash(const uint32_t & p_capacity);
+    inline uint32_t get_zero_index(void)const;
+
+    std::vector<value_type> m_slots;
+    uint32_t m_mask;
+    uint32_t m_size;
+    bool m_has_zero;
+  };
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  osm_id_map<T>::base_iterator<V,M>::base_iterator(M * p_map,
+                                                   const uint32_t & p_index):
+    m_map(p_map),
+    m_index(p_index)
+  {
+    while(m_index < m_map->m_slots.size() && !m_map->is_used(m_index))
+      {
+        ++m_index;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  template <class V2,class M2>
+  osm_id_map<T>::base_iterator<V,M>::base_iterator(const base_iterator<V2,M2> & p_iterator):
+    m_map(p_iterator.get_map()),
+    m_index(p_iterator.get_index())
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  V & osm_id_map<T>::base_iterator<V,M>::operator*(void)const
+  {
+    return m_map->m_slots[m_index];
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  V * osm_id_map<T>::base_iterator<V,M>::operator->(void)const
+  {
+    return &(m_map->m_slots[m_index]);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  typename osm_id_map<T>::template base_iterator<V,M> & osm_id_map<T>::base_iterator<V,M>::operator++(void)
+  {
+    ++m_index;
+    while(m_index < m_map->m_slots.size() && !m_map->is_used(m_index))
+      {
+        ++m_index;
+      }
+    return *this;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  bool osm_id_map<T>::base_iterator<V,M>::operator==(const base_iterator & p_iterator)const
+  {
+    return m_index == p_iterator.m_index;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  bool osm_id_map<T>::base_iterator<V,M>::operator!=(const base_iterator & p_iterator)const
+  {
+    return m_index != p_iterator.m_index;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  M * osm_id_map<T>::base_iterator<V,M>::get_map(void)const
+  {
+    return m_map;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  template <class V,class M>
+  const uint32_t & osm_id_map<T>::base_iterator<V,M>::get_index(void)const
+  {
+    return m_index;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  osm_id_map<T>::osm_id_map(void):
+    m_mask(0),
+    m_size(0),
+    m_has_zero(false)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::iterator osm_id_map<T>::begin(void)
+  {
+    return iterator(this,0);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::iterator osm_id_map<T>::end(void)
+  {
+    return iterator(this,m_slots.size());
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::const_iterator osm_id_map<T>::begin(void)const
+  {
+    return const_iterator(this,0);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::const_iterator osm_id_map<T>::end(void)const
+  {
+    return const_iterator(this,m_slots.size());
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::iterator osm_id_map<T>::find(const key_type & p_key)
+  {
+    uint32_t l_index = get_slot(p_key);
+    return is_used(l_index) ? iterator(this,l_index) : end();
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  typename osm_id_map<T>::const_iterator osm_id_map<T>::find(const key_type & p_key)const
+  {
+    uint32_t l_index = get_slot(p_key);
+    return is_used(l_index) ? const_iterator(this,l_index) : end();
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  std::pair<typename osm_id_map<T>::iterator,bool> osm_id_map<T>::insert(const value_type & p_value)
+  {
+    // Load factor is kept under 3/4
+    if(m_slots.empty() || (m_size + 1) * 4 > (m_mask + 1) * 3)
+      {
+        rehash(m_slots.empty() ? 16 : 2 * (m_mask + 1));
+      }
+    uint32_t l_index = get_slot(p_value.first);
+    if(is_used(l_index))
+      {
+        return std::pair<iterator,bool>(iterator(this,l_index),false);
+      }
+    m_slots[l_index] = p_value;
+    if(!p_value.first)
+      {
+        m_has_zero = true;
+      }
+    ++m_size;
+    return std::pair<iterator,bool>(iterator(this,l_index),true);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  T & osm_id_map<T>::operator[](const key_type & p_key)
+  {
+    return insert(value_type(p_key,T())).first->second;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void osm_id_map<T>::erase(iterator p_iterator)
+  {
+    uint32_t l_index = p_iterator.get_index();
+    --m_size;
+    if(l_index == get_zero_index())
+      {
+        m_has_zero = false;
+        m_slots[l_index] = value_type(0,T());
+        return;
+      }
+    // Move back following entries whose probe sequence crosses the freed
+    // slot so that no tombstone is needed
+    uint32_t l_next = l_index;
+    while(true)
+      {
+        l_next = (l_next + 1) & m_mask;
+        if(!m_slots[l_next].first)
+          {
+            break;
+          }
+        uint32_t l_home = hash(m_slots[l_next].first) & m_mask;
+        bool l_movable = l_next > l_index ? (l_home <= l_index || l_home > l_next) : (l_home <= l_index && l_home > l_next);
+        if(l_movable)
+          {
+            m_slots[l_index] = m_slots[l_next];
+            l_index = l_next;
+          }
+      }
+    m_slots[l_index] = value_type(0,T());
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint32_t osm_id_map<T>::erase(const key_type & p_key)
+  {
+    iterator l_iter = find(p_key);
+    if(l_iter == end())
+      {
+        return 0;
+      }
+    erase(l_iter);
+    return 1;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint32_t osm_id_map<T>::size(void)const
+  {
+    return m_size;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  bool osm_id_map<T>::empty(void)const
+  {
+    return !m_size;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void osm_id_map<T>::clear(void)
+  {
+    // Capacity is kept as tables are usually filled again to the same size
+    for(typename std::vector<value_type>::iterator l_iter = m_slots.begin();
+        l_iter != m_slots.end();
+        ++l_iter)
+      {
+        *l_iter = value_type(0,T());
+      }
+    m_size = 0;
+    m_has_zero = false;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void osm_id_map<T>::swap(osm_id_map & p_map)
+  {
+    m_slots.swap(p_map.m_slots);
+    std::swap(m_mask,p_map.m_mask);
+    std::swap(m_size,p_map.m_size);
+    std::swap(m_has_zero,p_map.m_has_zero);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint64_t osm_id_map<T>::get_memory_footprint(void)const
+  {
+    return m_slots.capacity() * sizeof(value_type);
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint32_t osm_id_map<T>::hash(const key_type & p_key)
+  {
+    // 64 bits finalizer of MurmurHash3
+    uint64_t l_result = p_key;
+    l_result ^= l_result >> 33;
+    l_result *= ((((uint64_t)0xff51afd7) << 32) | 0xed558ccd);
+    l_result ^= l_result >> 33;
+    return (uint32_t)l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  bool osm_id_map<T>::is_used(const uint32_t & p_index)const
+  {
+    return p_index < m_slots.size() && (m_slots[p_index].first || (m_has_zero && p_index == get_zero_index()));
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint32_t osm_id_map<T>::get_slot(const key_type & p_key)const
+  {
+    if(m_slots.empty())
+      {
+        return 0;
+      }
+    if(!p_key)
+      {
+        return get_zero_index();
+      }
+    uint32_t l_index = hash(p_key) & m_mask;
+    while(m_slots[l_index].first && m_slots[l_index].first != p_key)
+      {
+        l_index = (l_index + 1) & m_mask;
+      }
+    return l_index;
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  void osm_id_map<T>::rehash(const uint32_t & p_capacity)
+  {
+    std::vector<value_type> l_old_slots(p_capacity + 1,value_type(0,T()));
+    l_old_slots.swap(m_slots);
+    m_mask = p_capacity - 1;
+    m_size = 0;
+    bool l_had_zero = m_has_zero;
+    m_has_zero = false;
+    for(uint32_t l_index = 0 ; l_index + 1 < l_old_slots.size() ; ++l_index)
+      {
+        if(l_old_slots[l_index].first)
+          {
+            m_slots[get_slot(l_old_slots[l_index].first)] = l_old_slots[l_index];
+            ++m_size;
+          }
+      }
+    if(l_had_zero)
+      {
+        m_slots[get_zero_index()] = l_old_slots.back();
+        m_has_zero = true;
+        ++m_size;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  template <class T>
+  uint32_t osm_id_map<T>::get_zero_index(void)const
+  {
+    return m_mask + 1;
+  }
+}
+#endif // _OSM_ID_MAP_H_
+//EOF
@@ -0,0 +1,143 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _REGRESSION_MOMENTS_H_
+#define _REGRESSION_MOMENTS_H_
+
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Accumulated moments of a point cloud allowing to get the least square
+  // residual sum in O(1) and to add, remove or move a point in O(1)
+  // Points are stored relatively to the first point ever added to limit
+  // cancellation errors as coordinates are big compared to their variations
+  class regression_moments
+  {
+  public:
+    inline regression_moments(void);
+    inline void add(const double & p_x,const double & p_y);
+    inline void remove(const double & p_x,const double & p_y);
+    inline void move(const double & p_old_x,const double & p_old_y,
+                     const double & p_new_x,const double & p_new_y);
+    inline const uint32_t & get_nb_points(void)const;
+    inline double get_residual_sum(void)const;
+    inline double get_average_x(void)const;
+    inline double get_average_y(void)const;
+  private:
+    bool m_origin_set;
+    double m_origin_x;
+    double m_origin_y;
+    uint32_t m_nb_points;
+    double m_sum_x;
+    double m_sum_y;
+    double m_sum_xx;
+    double m_sum_xy;
+    double m_sum_yy;
+  };
+
+  //----------------------------------------------------------------------------
+  regression_moments::regression_moments(void):
+    m_origin_set(false),
+    m_origin_x(0.0),
+    m_origin_y(0.0),
+    m_nb_points(0),
+    m_sum_x(0.0),
+    m_sum_y(0.0),
+    m_sum_xx(0.0),
+    m_sum_xy(0.0),
+    m_sum_yy(0.0)
+      {
+      }
+
+    //----------------------------------------------------------------------------
+    void regression_moments::add(const double & p_x,const double & p_y)
+    {
+      if(!m_origin_set)
+        {
+          m_origin_x = p_x;
+          m_origin_y = p_y;
+          m_origin_set = true;
+        }
+      double l_x = p_x - m_origin_x;
+      double l_y = p_y - m_origin_y;
+      ++m_nb_points;
+      m_sum_x += l_x;
+      m_sum_y += l_y;
+      m_sum_xx += l_x * l_x;
+      m_sum_xy += l_x * l_y;
+      m_sum_yy += l_y * l_y;
+    }
+
+    //----------------------------------------------------------------------------
+    void regression_moments::remove(const double & p_x,const double & p_y)
+    {
+      double l_x = p_x - m_origin_x;
+      double l_y = p_y - m_origin_y;
+      --m_nb_points;
+      m_sum_x -= l_x;
+      m_sum_y -= l_y;
+      m_sum_xx -= l_x * l_x;
+      m_sum_xy -= l_x * l_y;
+      m_sum_yy -= l_y * l_y;
+    }
+
+    //----------------------------------------------------------------------------
+    void regression_moments::move(const double & p_old_x,const double & p_old_y,
+                                  const double & p_new_x,const double & p_new_y)
+    {
+      remove(p_old_x,p_old_y);
+      add(p_new_x,p_new_y);
+    }
+
+    //----------------------------------------------------------------------------
+    const uint32_t & regression_moments::get_nb_points(void)const
+      {
+        return m_nb_points;
+      }
+
+    //----------------------------------------------------------------------------
+    double regression_moments::get_residual_sum(void)const
+    {
+      if(!m_nb_points) return 0.0;
+      double l_sxx = m_sum_xx - m_sum_x * m_sum_x / m_nb_points;
+      double l_sxy = m_sum_xy - m_sum_x * m_sum_y / m_nb_points;
+      double l_syy = m_sum_yy - m_sum_y * m_sum_y / m_nb_points;
+      // Same convention than linear_regression : when all X are equal the
+      // line is vertical and the residual sum is null
+      if(l_sxx <= 0.0) return 0.0;
+      double l_result = l_syy - l_sxy * l_sxy / l_sxx;
+      return l_result > 0.0 ? l_result : 0.0;
+    }
+
+    //----------------------------------------------------------------------------
+    double regression_moments::get_average_x(void)const
+    {
+      return m_nb_points ? m_origin_x + m_sum_x / m_nb_points : 0.0;
+    }
+
+    //----------------------------------------------------------------------------
+    double regression_moments::get_average_y(void)const
+    {
+      return m_nb_points ? m_origin_y + m_sum_y / m_nb_points : 0.0;
+    }
+}
+#endif // _REGRESSION_MOMENTS_H_
+//EOF
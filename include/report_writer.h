@@ -0,0 +1,157 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _REPORT_WRITER_H_
+#define _REPORT_WRITER_H_
+
+#include "alert_record.h"
+#include "artifact_archive.h"
+#include "alert_stream.h"
+#include <pthread.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Generate HTML report, SVG and GPX files of alerts. When started the
+  // generation is done by a dedicated thread fed through a bounded queue
+  // so that slow report directories do not stall the analysis. Otherwise
+  // commands are processed immediatly by the calling thread
+  class report_writer
+  {
+  public:
+    // LAZY mode does not generate artifacts : they are rendered on demand from
+    // the binary alert stream
+    typedef enum {FILES,ARCHIVE,LAZY} t_artifact_mode;
+    report_writer(void);
+    ~report_writer(void);
+    void start(const uint32_t & p_queue_size,
+               bool p_drop_when_full,
+               const uint32_t & p_flush_interval);
+    // Wait for queued commands to be processed and throw the error raised
+    // by last ones if any
+    void stop(void);
+    // Must be set before opening report
+    void set_artifact_mode(const t_artifact_mode & p_mode);
+    void set_svg_options(bool p_compact,
+                         bool p_decimation);
+    // Alerts are also written in this stream. It is opened with first alert
+    void set_alert_stream(const std::string & p_file_name,
+                          const alert_stream::t_format & p_format);
+    void open_report(const std::string & p_file_name,
+                     const std::string & p_title);
+    // Writer takes ownership of record
+    void report_alert(const alert_record * p_record);
+    void flush(void);
+    void close_report(void);
+
+    void get_statistics(uint64_t & p_nb_alerts,
+                        uint64_t & p_nb_dropped,
+                        uint64_t & p_nb_blocked,
+                        uint32_t & p_max_queue_depth);
+    // Size of the current report as written by the writer. Alerts still
+    // queued are not taken into account
+    uint64_t get_report_size(void);
+  private:
+    class command
+    {
+    public:
+      typedef enum {OPEN_REPORT,ALERT,FLUSH,CLOSE_REPORT} t_command_type;
+      inline command(const t_command_type & p_type,
+                     const std::string & p_file_name="",
+                     const std::string & p_title="",
+                     const alert_record * p_record=NULL);
+      inline ~command(void);
+      const t_command_type m_type;
+      const std::string m_file_name;
+      const std::string m_title;
+      const alert_record * const m_record;
+    };
+
+    void submit(command * p_command);
+    void process(const command & p_command);
+    void run(void);
+    static void * thread_entry(void * p_writer);
+    void join(void);
+    void check_error(void);
+
+    void flush_outputs(void);
+    void write_header(const std::string & p_title);
+    void write_footer(void);
+    void write_alert(const alert_record & p_record);
+    void store_artifact(const std::string & p_name,
+                        const std::string & p_content);
+    std::string get_artifact_reference(const std::string & p_name)const;
+
+    std::ofstream m_report;
+    std::vector<char> m_report_buffer;
+    t_artifact_mode m_artifact_mode;
+    artifact_archive m_archive;
+    bool m_svg_compact;
+    bool m_svg_decimation;
+    std::string m_alert_stream_file_name;
+    alert_stream::t_format m_alert_stream_format;
+    alert_stream m_alert_stream;
+    uint32_t m_flush_interval;
+    uint32_t m_nb_unflushed_alerts;
+    uint64_t m_report_size;
+    // Used to ignore the size of a previous report still being written
+    uint32_t m_nb_submitted_open;
+    uint32_t m_nb_processed_open;
+
+    bool m_started;
+    bool m_stop_requested;
+    pthread_t m_thread;
+    pthread_mutex_t m_mutex;
+    pthread_cond_t m_not_empty;
+    pthread_cond_t m_not_full;
+    std::deque<command*> m_queue;
+    uint32_t m_queue_size;
+    bool m_drop_when_full;
+    std::string m_error;
+
+    uint64_t m_nb_alerts;
+    uint64_t m_nb_dropped;
+    uint64_t m_nb_blocked;
+    uint32_t m_max_queue_depth;
+  };
+
+  //----------------------------------------------------------------------------
+  report_writer::command::command(const t_command_type & p_type,
+                                  const std::string & p_file_name,
+                                  const std::string & p_title,
+                                  const alert_record * p_record):
+    m_type(p_type),
+    m_file_name(p_file_name),
+    m_title(p_title),
+    m_record(p_record)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  report_writer::command::~command(void)
+  {
+    delete m_record;
+  }
+}
+#endif // _REPORT_WRITER_H_
+//EOF
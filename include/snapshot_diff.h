@@ -0,0 +1,166 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+#ifndef _SNAPSHOT_DIFF_H_
+#define _SNAPSHOT_DIFF_H_
+
+#include "osm_api_data_types.h"
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  class node_alignment_common_api;
+  class node_alignment_analyzer;
+
+  // Offline comparison of two dated OSM extracts. Node coordinates of both
+  // extracts are indexed in compact sorted arrays, ways of the new extract
+  // whose nodes moved are scored in parallel with check_way criteria and
+  // aligned ones are reported through analyzer. No API request is done
+  // except for browse URLs of reported objects
+  class snapshot_diff
+  {
+  public:
+    snapshot_diff(node_alignment_common_api & p_api,
+                  node_alignment_analyzer & p_analyzer,
+                  const uint32_t & p_nb_threads);
+    ~snapshot_diff(void);
+    void run(const std::string & p_old_file_name,
+             const std::string & p_new_file_name);
+    inline const uint64_t & get_nb_old_nodes(void)const;
+    inline const uint64_t & get_nb_new_nodes(void)const;
+    inline const uint64_t & get_nb_ways(void)const;
+    inline uint64_t get_nb_candidate_ways(void)const;
+    inline const uint64_t & get_nb_alerts(void)const;
+  private:
+    // Node coordinates sorted by id
+    class coordinates_index
+    {
+    public:
+      void add(const osm_api_data_types::osm_object::t_osm_id & p_id,
+               const float & p_lat,
+               const float & p_lon);
+      void sort(void);
+      bool find(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                float & p_lat,
+                float & p_lon)const;
+      inline uint64_t size(void)const;
+    private:
+      class entry
+      {
+      public:
+        inline bool operator<(const entry & p_entry)const;
+        osm_api_data_types::osm_object::t_osm_id m_id;
+        float m_lat;
+        float m_lon;
+      };
+      std::vector<entry> m_entries;
+    };
+
+    // Way of new extract with enough moved nodes to be scored
+    class candidate_way
+    {
+    public:
+      candidate_way(const osm_api_data_types::osm_way & p_way);
+      osm_api_data_types::osm_object::t_osm_id m_id;
+      osm_api_data_types::osm_object::t_osm_id m_changeset_id;
+      osm_api_data_types::osm_object::t_osm_id m_user_id;
+      std::string m_user_name;
+      std::vector<osm_api_data_types::osm_object::t_osm_id> m_node_refs;
+      // Filled by workers
+      bool m_aligned;
+      double m_alignment_modification_rate;
+      double m_min_square_modification_rate;
+      double m_center_lat;
+      double m_center_lon;
+      std::vector<std::pair<double,double> > m_old_coordinates;
+      std::vector<std::pair<double,double> > m_new_coordinates;
+    };
+
+    void load(const std::string & p_file_name,
+              coordinates_index & p_index,
+              bool p_keep_ways);
+    void score(candidate_way & p_way)const;
+    void work(void);
+    void report(const candidate_way & p_way);
+    static bool compare_candidates(const candidate_way * p_way1,
+                                   const candidate_way * p_way2);
+    static void * thread_entry(void * p_snapshot_diff);
+
+    node_alignment_common_api & m_api;
+    node_alignment_analyzer & m_analyzer;
+    uint32_t m_nb_threads;
+    coordinates_index m_old_nodes;
+    coordinates_index m_new_nodes;
+    std::vector<candidate_way*> m_candidates;
+    // Index of next candidate to be scored by a worker
+    uint64_t m_next_candidate;
+    pthread_mutex_t m_mutex;
+    uint64_t m_nb_old_nodes;
+    uint64_t m_nb_new_nodes;
+    uint64_t m_nb_ways;
+    uint64_t m_nb_alerts;
+  };
+
+  //----------------------------------------------------------------------------
+  const uint64_t & snapshot_diff::get_nb_old_nodes(void)const
+  {
+    return m_nb_old_nodes;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & snapshot_diff::get_nb_new_nodes(void)const
+  {
+    return m_nb_new_nodes;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & snapshot_diff::get_nb_ways(void)const
+  {
+    return m_nb_ways;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t snapshot_diff::get_nb_candidate_ways(void)const
+  {
+    return m_candidates.size();
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & snapshot_diff::get_nb_alerts(void)const
+  {
+    return m_nb_alerts;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t snapshot_diff::coordinates_index::size(void)const
+  {
+    return m_entries.size();
+  }
+
+  //----------------------------------------------------------------------------
+  bool snapshot_diff::coordinates_index::entry::operator<(const entry & p_entry)const
+  {
+    return m_id < p_entry.m_id;
+  }
+}
+#endif // _SNAPSHOT_DIFF_H_
+//EOF
@@ -20,8 +20,10 @@
 #ifndef _SVG_REPORT_H_
 #define _SVG_REPORT_H_
 
-#include <fstream>
+#include <ostream>
+#include <string>
 #include <vector>
+#include <map>
 #include <inttypes.h>
 
 namespace osm_diff_analyzer_node_alignment
@@ -30,14 +32,28 @@ namespace osm_diff_analyzer_node_alignment
   {
   public:
     svg_report(void);
+    // Compact mode draws each geometry as a single polyline with integer
+    // coordinates and vertex markers shared between polylines
+    void set_compact(bool p_compact);
+    // Drop consecutive vertices falling on the same pixel. Only used in
+    // compact mode
+    void set_decimation(bool p_decimation);
     void update_xtrem_coordinates(const std::vector<std::pair<double,double> > & p_list);
     void adjust_xtrem_coordinates(const double & p_coef);
-    void open(const std::string & p_file_name);
+    void open(std::ostream & p_stream);
     void draw_polyline(const std::vector<std::pair<double,double> > & p_list,
                        const std::string & p_color,
                        const uint32_t & p_supp);
     void close(void);
   private:
+    void draw_compact_polyline(const std::vector<std::pair<double,double> > & p_list,
+                               const std::string & p_color,
+                               const uint32_t & p_supp);
+    const std::string & get_marker(const std::string & p_color,
+                                   const uint32_t & p_radius);
+    inline int32_t get_x(const std::pair<double,double> & p_coord)const;
+    inline int32_t get_y(const std::pair<double,double> & p_coord)const;
+
     uint32_t m_width;
     uint32_t m_height;
     uint32_t m_circle_size;
@@ -45,8 +61,25 @@ namespace osm_diff_analyzer_node_alignment
     double m_max_lat;
     double m_min_lon;
     double m_max_lon;
-    std::ofstream m_svg_file;
+    std::ostream * m_svg_file;
+    bool m_compact;
+    bool m_decimation;
+    std::map<std::pair<std::string,uint32_t>,std::string> m_markers;
   };
+
+  //----------------------------------------------------------------------------
+  int32_t svg_report::get_x(const std::pair<double,double> & p_coord)const
+  {
+    if(m_max_lon <= m_min_lon) return (int32_t)(m_width / 2);
+    return (int32_t)((( m_width - 1.0) * (p_coord.second - m_min_lon ))/ (m_max_lon - m_min_lon) + 0.5);
+  }
+
+  //----------------------------------------------------------------------------
+  int32_t svg_report::get_y(const std::pair<double,double> & p_coord)const
+  {
+    if(m_max_lat <= m_min_lat) return (int32_t)(m_height / 2);
+    return (int32_t)((( m_height - 1.0) * (m_max_lat - p_coord.first ))/ (m_max_lat - m_min_lat) + 0.5);
+  }
 }
 #endif // _SVG_REPORT_H_
 //EOF
@@ -0,0 +1,140 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _TRACER_H_
+#define _TRACER_H_
+
+#include "osm_object.h"
+#include <string>
+#include <vector>
+#include <fstream>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Recording of spans in Chrome trace event format (chrome://tracing,
+  // Perfetto). In ALL mode every span is written. In SLOW mode spans of a
+  // changeset are kept in a ring buffer and only written if the changeset
+  // analyze lasted more than a threshold. When tracing is off a span costs
+  // the test of its start time
+  class tracer
+  {
+  public:
+    typedef enum
+      {
+        NONE=0,
+        ALL,
+        SLOW
+      } t_mode;
+
+    class scoped_span
+    {
+    public:
+      inline scoped_span(const char * p_name);
+      // Way id is also given to the spans opened while this one is alive
+      inline scoped_span(const char * p_name,
+                         const osm_api_data_types::osm_object::t_osm_id & p_way_id);
+      inline ~scoped_span(void);
+    private:
+      const char * const m_name;
+      const uint64_t m_start;
+      osm_api_data_types::osm_object::t_osm_id m_previous_way_id;
+    };
+
+    // Trace file is created when tracing is enabled so that failures are
+    // reported here and never by a span
+    static void configure(const t_mode & p_mode,
+                          const std::string & p_file_name,
+                          const uint32_t & p_slow_threshold_ms,
+                          const uint32_t & p_buffer_size);
+    inline static bool is_enabled(void);
+    // Spans recorded between these calls are tagged with changeset id
+    static void begin_changeset(const osm_api_data_types::osm_object::t_osm_id & p_id);
+    static void end_changeset(void);
+    static void flush(void);
+    static void close(void);
+  private:
+    class span
+    {
+    public:
+      const char * m_name;
+      uint64_t m_start;
+      uint64_t m_duration;
+      osm_api_data_types::osm_object::t_osm_id m_changeset_id;
+      osm_api_data_types::osm_object::t_osm_id m_way_id;
+    };
+
+    static uint64_t get_time_us(void);
+    static void end_span(const char * p_name,
+                         const uint64_t & p_start);
+    static void write(const span & p_span);
+
+    static t_mode m_mode;
+    static std::string m_file_name;
+    static std::ofstream m_file;
+    static bool m_first_event;
+    static uint64_t m_origin;
+    static uint64_t m_slow_threshold;
+    static osm_api_data_types::osm_object::t_osm_id m_changeset_id;
+    static osm_api_data_types::osm_object::t_osm_id m_way_id;
+    static uint64_t m_changeset_start;
+    // Ring buffer of SLOW mode
+    static std::vector<span> m_ring;
+    static uint32_t m_ring_start;
+    static uint32_t m_ring_size;
+    static uint64_t m_nb_overwritten;
+  };
+
+  //----------------------------------------------------------------------------
+  tracer::scoped_span::scoped_span(const char * p_name):
+    m_name(p_name),
+    m_start(m_mode != NONE ? get_time_us() : 0),
+    m_previous_way_id(m_way_id)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  tracer::scoped_span::scoped_span(const char * p_name,
+                                   const osm_api_data_types::osm_object::t_osm_id & p_way_id):
+    m_name(p_name),
+    m_start(m_mode != NONE ? get_time_us() : 0),
+    m_previous_way_id(m_way_id)
+  {
+    m_way_id = p_way_id;
+  }
+
+  //----------------------------------------------------------------------------
+  tracer::scoped_span::~scoped_span(void)
+  {
+    if(m_start)
+      {
+        end_span(m_name,m_start);
+      }
+    m_way_id = m_previous_way_id;
+  }
+
+  //----------------------------------------------------------------------------
+  bool tracer::is_enabled(void)
+  {
+    return m_mode != NONE;
+  }
+}
+#endif // _TRACER_H_
+//EOF
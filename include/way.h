@@ -21,13 +21,15 @@
 #define _WAY_H_
 
 #include "osm_core_element.h"
+#include "regression_moments.h"
+#include "node.h"
+#include "memory_footprint.h"
 #include <map>
 #include <vector>
+#include <limits>
 
 namespace osm_diff_analyzer_node_alignment
 {
-  class node;
-
   class way
   {
   public:
@@ -39,8 +41,25 @@ namespace osm_diff_analyzer_node_alignment
     inline void set_node_refs(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs);
     inline const std::vector<osm_api_data_types::osm_object::t_osm_id> & get_node_refs(void)const;
     inline const osm_api_data_types::osm_object::t_osm_id & get_id(void)const;
+    inline const osm_api_data_types::osm_core_element::t_osm_version & get_version(void)const;
     inline bool is_checked(void)const;
+    // Bytes used by way including its heap allocated members
+    inline uint64_t get_memory_footprint(void)const;
     inline void set_checked(void);
+
+    // Moments of the nodes of the way known by the changeset. They are
+    // updated each time one of those nodes is moved so that the alignment
+    // score is available without walking the way nodes
+    inline void add_node(const node & p_node);
+    inline void move_node(const node & p_node,
+                          const float & p_new_lat,
+                          const float & p_new_lon);
+    inline void set_node_baseline(const node & p_node,
+                                  const float & p_lat,
+                                  const float & p_lon);
+    inline const regression_moments & get_moments(void)const;
+    inline const regression_moments & get_baseline_moments(void)const;
+    inline double get_alignment_score(void)const;
   private:
     const osm_api_data_types::osm_object::t_osm_id m_id;
     const std::string m_user_name;
@@ -50,7 +69,8 @@ namespace osm_diff_analyzer_node_alignment
     bool m_checked;
     std::map<osm_api_data_types::osm_object::t_osm_id,node*> m_nodes;
     std::vector<osm_api_data_types::osm_object::t_osm_id> m_ordered_nodes;
-      
+    regression_moments m_moments;
+    regression_moments m_baseline_moments;
   };
   //----------------------------------------------------------------------------
   const std::vector<osm_api_data_types::osm_object::t_osm_id> & way::get_node_refs(void)const
@@ -85,17 +105,90 @@ namespace osm_diff_analyzer_node_alignment
         return m_id;
       }
 
+    //----------------------------------------------------------------------------
+    const osm_api_data_types::osm_core_element::t_osm_version & way::get_version(void)const
+      {
+        return m_version;
+      }
+
     //----------------------------------------------------------------------------
     bool way::is_checked(void)const
     {
       return m_checked;
     }
 
+    //----------------------------------------------------------------------------
+    uint64_t way::get_memory_footprint(void)const
+    {
+      return sizeof(way) + memory_footprint::get(m_user_name) + memory_footprint::get(m_nodes) + memory_footprint::get(m_ordered_nodes);
+    }
+
     //----------------------------------------------------------------------------
     void way::set_checked(void)
     {
       m_checked = true;
     }
+
+    //----------------------------------------------------------------------------
+    void way::add_node(const node & p_node)
+    {
+      m_moments.add(p_node.get_lat(),p_node.get_lon());
+      if(p_node.has_baseline())
+        {
+          m_baseline_moments.add(p_node.get_baseline_lat(),p_node.get_baseline_lon());
+        }
+      else
+        {
+          m_baseline_moments.add(p_node.get_lat(),p_node.get_lon());
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    void way::move_node(const node & p_node,
+                        const float & p_new_lat,
+                        const float & p_new_lon)
+    {
+      m_moments.move(p_node.get_lat(),p_node.get_lon(),p_new_lat,p_new_lon);
+      // Until its previous version is known a node is considered as not moved
+      if(!p_node.has_baseline())
+        {
+          m_baseline_moments.move(p_node.get_lat(),p_node.get_lon(),p_new_lat,p_new_lon);
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    void way::set_node_baseline(const node & p_node,
+                                const float & p_lat,
+                                const float & p_lon)
+    {
+      if(p_node.has_baseline())
+        {
+          m_baseline_moments.move(p_node.get_baseline_lat(),p_node.get_baseline_lon(),p_lat,p_lon);
+        }
+      else
+        {
+          m_baseline_moments.move(p_node.get_lat(),p_node.get_lon(),p_lat,p_lon);
+        }
+    }
+
+    //----------------------------------------------------------------------------
+    const regression_moments & way::get_moments(void)const
+      {
+        return m_moments;
+      }
+
+    //----------------------------------------------------------------------------
+    const regression_moments & way::get_baseline_moments(void)const
+      {
+        return m_baseline_moments;
+      }
+
+    //----------------------------------------------------------------------------
+    double way::get_alignment_score(void)const
+    {
+      double l_new_result = m_moments.get_residual_sum();
+      return l_new_result ? m_baseline_moments.get_residual_sum() / l_new_result : std::numeric_limits<double>::max();
+    }
 }
 
 #endif // _WAY_H_
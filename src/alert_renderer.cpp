@@ -0,0 +1,179 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "alert_renderer.h"
+#include "svg_report.h"
+#include <sstream>
+#include <iomanip>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  std::string alert_renderer::get_base_name(const alert_record & p_record)
+  {
+    std::stringstream l_stream;
+    l_stream << "way_" << p_record.get_way_id() << "_c" << p_record.get_changeset_id();
+    return l_stream.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_renderer::render_svg(std::ostream & p_stream,
+                                  const alert_record & p_record,
+                                  bool p_compact,
+                                  bool p_decimation)
+  {
+    svg_report l_svg_report;
+    l_svg_report.set_compact(p_compact);
+    l_svg_report.set_decimation(p_decimation);
+    l_svg_report.update_xtrem_coordinates(p_record.get_old_coordinates());
+    l_svg_report.update_xtrem_coordinates(p_record.get_new_coordinates());
+    l_svg_report.adjust_xtrem_coordinates(0.1);
+  
+    l_svg_report.open(p_stream);
+    l_svg_report.draw_polyline(p_record.get_old_coordinates(),"blue",1);
+    l_svg_report.draw_polyline(p_record.get_new_coordinates(),"red",0);
+    l_svg_report.close();
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_renderer::render_gpx(std::ostream & p_stream,
+                                  const std::string & p_way_name,
+                                  const std::vector<std::pair<double,double> > & p_points)
+  {
+    p_stream << "<?xml version=\"1.0\"?>" << "\n" ;
+    p_stream << "<gpx version=\"1.0\""  << "\n" ;
+    p_stream << "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""  << "\n" ;
+    p_stream << "xmlns=\"http://www.topografix.com/GPX/1/0\""  << "\n" ;
+    p_stream << "xsi:schemaLocation=\"http://www.topografix.com/GPX/1/0 http://www.topografix.com/GPX/1/0/gpx.xsd\">"  << "\n" ;
+    p_stream << "<trk>" << "\n" ;
+    p_stream << "<name>" << p_way_name << "</name>" << "\n" ;
+    p_stream << "<trkseg>" << "\n" ;
+    for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_points.begin();
+        l_iter != p_points.end();
+        ++l_iter)
+      {
+        p_stream << "<trkpt lat=\""<< std::setprecision(15) << l_iter->first << "\" lon=\"" << l_iter->second << "\">" << "\n" ;
+        p_stream << "</trkpt>" << "\n" ;
+     }
+    p_stream << "</trkseg>" << "\n" ;
+    p_stream << "</trk>" << "\n" ;
+    p_stream << "</gpx>" << "\n" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_renderer::render_html_header(std::ostream & p_stream,
+                                          const std::string & p_title)
+  {
+    p_stream << "<html>" << "\n" ;
+    p_stream << "\t<head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">" << "\n" ;
+    p_stream << "\t\t<title>" << p_title << " Node Alignement Report </title>" << "\n" ;
+
+    p_stream << "<script src=\"http://openlayers.org/api/OpenLayers.js\"></script>" << "\n" ;
+    p_stream << "<script type=\"text/javascript\">" << "\n" ;
+    p_stream << "var zoom=15;" << "\n" ;
+    p_stream << "var map;" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "function init(name,old_file_name,new_file_name,lat,lon){" << "\n" ;
+    p_stream << "  var my_map = document.getElementById(name)" << "\n" ;
+    p_stream << "    my_map = new OpenLayers.Map (name, {" << "\n" ;
+    p_stream << "      controls:[" << "\n" ;
+    p_stream << "                new OpenLayers.Control.Navigation()," << "\n" ;
+    p_stream << "                new OpenLayers.Control.PanZoomBar()," << "\n" ;
+    p_stream << "                new OpenLayers.Control.LayerSwitcher()," << "\n" ;
+    p_stream << "                new OpenLayers.Control.Attribution()]," << "\n" ;
+    p_stream << "                                     maxExtent: new OpenLayers.Bounds(-20037508.34,-20037508.34,20037508.34,20037508.34)," << "\n" ;
+    p_stream << "                                     maxResolution: 156543.0399," << "\n" ;
+    p_stream << "                                     numZoomLevels: 19," << "\n" ;
+    p_stream << "                                     units: 'm'," << "\n" ;
+    p_stream << "                                     projection: new OpenLayers.Projection(\"EPSG:900913\")," << "\n" ;
+    p_stream << "                                     displayProjection: new OpenLayers.Projection(\"EPSG:4326\")" << "\n" ;
+    p_stream << "                                     } );" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  my_map.addLayer(new OpenLayers.Layer.OSM());" << "\n" ;
+    //   p_stream << "  my_map.size = new OpenLayers.Size(300,200);" << "\n" ;
+    p_stream << "  var lonLat = new OpenLayers.LonLat(lon, lat).transform(new OpenLayers.Projection(\"EPSG:4326\"), new OpenLayers.Projection(\"EPSG:900913\"));" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  my_map.setCenter (lonLat, zoom);" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  //Initialise the vector layer using OpenLayers.Format.OSM" << "\n" ;
+    p_stream << "  var layer = new OpenLayers.Layer.Vector(old_file_name, {" << "\n" ;
+    p_stream << "    strategies: [new OpenLayers.Strategy.Fixed()]," << "\n" ;
+    p_stream << "                                              protocol: new OpenLayers.Protocol.HTTP({" << "\n" ;
+    p_stream << "                                                url: old_file_name,   //<-- relative or absolute URL to your .osm file" << "\n" ;
+    p_stream << "                                                    format: new OpenLayers.Format.GPX()" << "\n" ;
+    p_stream << "                                                    })," << "\n" ;
+    p_stream << "                                              style: {strokeColor: \"blue\", strokeWidth: 6, strokeOpacity: 1}," << "\n" ;
+    p_stream << "                                              projection: new OpenLayers.Projection(\"EPSG:4326\")" << "\n" ;
+    p_stream << "                                              });" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  my_map.addLayers([layer]);" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  //Initialise the vector layer using OpenLayers.Format.OSM" << "\n" ;
+    p_stream << "  var layer2 = new OpenLayers.Layer.Vector(new_file_name, {" << "\n" ;
+    p_stream << "    strategies: [new OpenLayers.Strategy.Fixed()]," << "\n" ;
+    p_stream << "                                               protocol: new OpenLayers.Protocol.HTTP({" << "\n" ;
+    p_stream << "                                                 url: new_file_name,   //<-- relative or absolute URL to your .osm file" << "\n" ;
+    p_stream << "                                                     format: new OpenLayers.Format.GPX()" << "\n" ;
+    p_stream << "                                                     })," << "\n" ;
+    p_stream << "                                               style: {strokeColor: \"red\", strokeWidth: 6, strokeOpacity: 1}," << "\n" ;
+    p_stream << "                                               projection: new OpenLayers.Projection(\"EPSG:4326\")" << "\n" ;
+    p_stream << "                                               });" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "  my_map.addLayers([layer2]);" << "\n" ;
+    p_stream << "\n" ;
+    p_stream << "}" << "\n" ;
+    p_stream << "</script>" << "\n" ;
+
+    p_stream << "\t</head>" << "\n" ;
+    p_stream << "\t<body><H1>" << p_title << " Node alignement Report</H1>" << "\n" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_renderer::render_html_footer(std::ostream & p_stream)
+  {
+    p_stream << "</body>" << "\n" ;
+    p_stream << "</html>" << "\n" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_renderer::render_html_alert(std::ostream & p_stream,
+                                         const alert_record & p_record,
+                                         const std::string & p_old_gpx_reference,
+                                         const std::string & p_new_gpx_reference,
+                                         const std::string & p_svg_reference)
+  {
+    std::string l_base_name = get_base_name(p_record);
+    p_stream << "<A HREF=\"" << p_record.get_way_url() << "\">Way " << p_record.get_way_id() << "</A> has been aligned by <A HREF=\"" << p_record.get_user_url() << "\">" << p_record.get_user_name() << "</A> in <A HREF=\"" << p_record.get_changeset_url() << "\">Changeset " << p_record.get_changeset_id() << "</A><BR>" << "\n" ;
+    p_stream << "With <B>alignment modification rate = " << p_record.get_alignment_modification_rate() << "</B> and <B>Min square modification rate = " << p_record.get_min_square_modification_rate() << "</B><BR>"  << "\n" ;
+    if(p_old_gpx_reference != "" && p_new_gpx_reference != "")
+      {
+        std::string l_map_name = "map_"+l_base_name;
+        p_stream << "<button type=\"button\" onclick=\"init('" << l_map_name << "','" << p_old_gpx_reference << "','" << p_new_gpx_reference << "'," << p_record.get_center_lat() << "," << p_record.get_center_lon() << ")\">Display Map</button>" << "\n" ;
+        p_stream << "<div id=\"" << l_map_name << "\" class=\"smallmap\">" << "\n" ;
+        p_stream << "</div>" << "\n" ;
+      }
+    if(p_svg_reference != "")
+      {
+        p_stream << "<IMG SRC=\"" << p_svg_reference << "\" ALT=\"" << l_base_name << ".svg\" TITLE=\"Way " << p_record.get_way_id() << "\" ALIGN=\"MIDDLE\" /><BR>" << "\n" ;
+      }
+    p_stream << "<HR/>" << "\n" ;
+  }
+}
+//EOF
@@ -0,0 +1,416 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "alert_stream.h"
+#include "quicky_exception.h"
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <cstdio>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  alert_stream::alert_stream(void):
+    m_buffer(64 * 1024),
+    m_format(JSONL)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  alert_stream::~alert_stream(void)
+  {
+    close();
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::open(const std::string & p_file_name,
+                          const t_format & p_format)
+  {
+    close();
+    m_format = p_format;
+
+    std::ifstream l_existing_file(p_file_name.c_str(),std::ios::in | std::ios::binary | std::ios::ate);
+    bool l_empty = !l_existing_file.is_open() || l_existing_file.tellg() == (std::streampos)0;
+    if(BINARY == m_format && !l_empty)
+      {
+        // Records of different versions cannot be mixed in the same stream
+        l_existing_file.seekg(0);
+        uint32_t l_version;
+        read_header(l_existing_file,l_version);
+        if(l_version != m_binary_version)
+          {
+	    std::stringstream l_stream;
+	    l_stream << "Alert stream \"" << p_file_name << "\" has version " << l_version << " whereas version " << m_binary_version << " is generated" ;
+	    throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+          }
+      }
+    l_existing_file.close();
+
+    m_file.rdbuf()->pubsetbuf(&m_buffer[0],m_buffer.size());
+    m_file.open(p_file_name.c_str(),std::ios::out | std::ios::binary | std::ios::app);
+    if(!m_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when opening alert stream \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    if(BINARY == m_format && l_empty)
+      {
+        std::string l_header("NAAL");
+        append_uint32(l_header,m_binary_version);
+        m_file.write(l_header.data(),l_header.size());
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::write(const alert_record & p_record)
+  {
+    if(JSONL == m_format)
+      {
+        write_json(p_record);
+      }
+    else
+      {
+        write_binary(p_record);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::flush(void)
+  {
+    m_file.flush();
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::close(void)
+  {
+    if(m_file.is_open())
+      {
+        m_file.close();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::write_json(const alert_record & p_record)
+  {
+    m_file << "{\"way_id\":" << p_record.get_way_id() ;
+    m_file << ",\"changeset_id\":" << p_record.get_changeset_id() ;
+    m_file << ",\"user_id\":" << p_record.get_user_id() ;
+    m_file << ",\"user_name\":" ;
+    write_json_string(m_file,p_record.get_user_name());
+    m_file << std::setprecision(15) ;
+    m_file << ",\"alignment_modification_rate\":" << p_record.get_alignment_modification_rate() ;
+    m_file << ",\"min_square_modification_rate\":" << p_record.get_min_square_modification_rate() ;
+    m_file << ",\"center\":[" << p_record.get_center_lat() << "," << p_record.get_center_lon() << "]" ;
+    m_file << ",\"old_coordinates\":" ;
+    write_json_coordinates(m_file,p_record.get_old_coordinates());
+    m_file << ",\"new_coordinates\":" ;
+    write_json_coordinates(m_file,p_record.get_new_coordinates());
+    m_file << "}" << "\n" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::write_json_string(std::ostream & p_stream,
+                                       const std::string & p_string)
+  {
+    p_stream << "\"" ;
+    for(std::string::const_iterator l_iter = p_string.begin();
+        l_iter != p_string.end();
+        ++l_iter)
+      {
+        unsigned char l_char = *l_iter;
+        switch(l_char)
+          {
+          case '"':
+            p_stream << "\\\"" ;
+            break;
+          case '\\':
+            p_stream << "\\\\" ;
+            break;
+          case '\n':
+            p_stream << "\\n" ;
+            break;
+          case '\r':
+            p_stream << "\\r" ;
+            break;
+          case '\t':
+            p_stream << "\\t" ;
+            break;
+          default:
+            if(l_char < 0x20)
+              {
+                // Other control characters. UTF-8 bytes are kept as is
+                char l_escaped[8];
+                sprintf(l_escaped,"\\u%04x",l_char);
+                p_stream << l_escaped ;
+              }
+            else
+              {
+                p_stream << *l_iter ;
+              }
+          }
+      }
+    p_stream << "\"" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::write_json_coordinates(std::ostream & p_stream,
+                                            const std::vector<std::pair<double,double> > & p_coordinates)
+  {
+    p_stream << "[" ;
+    for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_coordinates.begin();
+        l_iter != p_coordinates.end();
+        ++l_iter)
+      {
+        if(l_iter != p_coordinates.begin())
+          {
+            p_stream << "," ;
+          }
+        p_stream << "[" << l_iter->first << "," << l_iter->second << "]" ;
+      }
+    p_stream << "]" ;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::write_binary(const alert_record & p_record)
+  {
+    // Record is built in memory to know its length before writing it
+    m_record.clear();
+    append_uint64(m_record,p_record.get_way_id());
+    append_uint64(m_record,p_record.get_changeset_id());
+    append_uint64(m_record,p_record.get_user_id());
+    append_string(m_record,p_record.get_user_name());
+    append_string(m_record,p_record.get_way_url());
+    append_string(m_record,p_record.get_changeset_url());
+    append_string(m_record,p_record.get_user_url());
+    append_double(m_record,p_record.get_alignment_modification_rate());
+    append_double(m_record,p_record.get_min_square_modification_rate());
+    append_double(m_record,p_record.get_center_lat());
+    append_double(m_record,p_record.get_center_lon());
+    append_coordinates(m_record,p_record.get_old_coordinates());
+    append_coordinates(m_record,p_record.get_new_coordinates());
+
+    std::string l_length;
+    append_uint32(l_length,m_record.size());
+    m_file.write(l_length.data(),l_length.size());
+    m_file.write(m_record.data(),m_record.size());
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::append_uint32(std::string & p_buffer,
+                                   const uint32_t & p_value)
+  {
+    for(uint32_t l_index = 0 ; l_index < 4 ; ++l_index)
+      {
+        p_buffer.push_back((char)((p_value >> (8 * l_index)) & 0xFF));
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::append_uint64(std::string & p_buffer,
+                                   const uint64_t & p_value)
+  {
+    append_uint32(p_buffer,(uint32_t)(p_value & 0xFFFFFFFF));
+    append_uint32(p_buffer,(uint32_t)(p_value >> 32));
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::append_double(std::string & p_buffer,
+                                   const double & p_value)
+  {
+    uint64_t l_bits;
+    memcpy(&l_bits,&p_value,sizeof(l_bits));
+    append_uint64(p_buffer,l_bits);
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::append_string(std::string & p_buffer,
+                                   const std::string & p_value)
+  {
+    append_uint32(p_buffer,p_value.size());
+    p_buffer.append(p_value);
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::append_coordinates(std::string & p_buffer,
+                                        const std::vector<std::pair<double,double> > & p_coordinates)
+  {
+    append_uint32(p_buffer,p_coordinates.size());
+    for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_coordinates.begin();
+        l_iter != p_coordinates.end();
+        ++l_iter)
+      {
+        append_double(p_buffer,l_iter->first);
+        append_double(p_buffer,l_iter->second);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::read_header(std::istream & p_stream,
+                                 uint32_t & p_version)
+  {
+    char l_header[8];
+    if(!p_stream.read(l_header,sizeof(l_header)) || std::string(l_header,4) != "NAAL")
+      {
+	throw quicky_exception::quicky_runtime_exception("Not a binary alert stream",__LINE__,__FILE__);
+      }
+    size_t l_offset = 0;
+    p_version = extract_uint32(std::string(l_header + 4,4),l_offset);
+    if(!p_version || p_version > m_binary_version)
+      {
+	std::stringstream l_stream;
+	l_stream << "Unsupported binary alert stream version " << p_version ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  alert_record * alert_stream::read(std::istream & p_stream,
+                                    const uint32_t & p_version)
+  {
+    char l_length_buffer[4];
+    if(!p_stream.read(l_length_buffer,sizeof(l_length_buffer)))
+      {
+        if(p_stream.gcount())
+          {
+	    throw quicky_exception::quicky_runtime_exception("Truncated record length in binary alert stream",__LINE__,__FILE__);
+          }
+        return NULL;
+      }
+    size_t l_offset = 0;
+    uint32_t l_length = extract_uint32(std::string(l_length_buffer,4),l_offset);
+    std::string l_record(l_length,'\0');
+    if(l_length && !p_stream.read(&l_record[0],l_length))
+      {
+	throw quicky_exception::quicky_runtime_exception("Truncated record in binary alert stream",__LINE__,__FILE__);
+      }
+
+    l_offset = 0;
+    uint64_t l_way_id = extract_uint64(l_record,l_offset);
+    uint64_t l_changeset_id = extract_uint64(l_record,l_offset);
+    uint64_t l_user_id = extract_uint64(l_record,l_offset);
+    std::string l_user_name = extract_string(l_record,l_offset);
+    std::string l_way_url;
+    std::string l_changeset_url;
+    std::string l_user_url;
+    if(p_version >= 2)
+      {
+        l_way_url = extract_string(l_record,l_offset);
+        l_changeset_url = extract_string(l_record,l_offset);
+        l_user_url = extract_string(l_record,l_offset);
+      }
+    double l_alignment_modification_rate = extract_double(l_record,l_offset);
+    double l_min_square_modification_rate = extract_double(l_record,l_offset);
+    double l_center_lat = extract_double(l_record,l_offset);
+    double l_center_lon = extract_double(l_record,l_offset);
+    std::vector<std::pair<double,double> > l_old_coordinates;
+    extract_coordinates(l_record,l_offset,l_old_coordinates);
+    std::vector<std::pair<double,double> > l_new_coordinates;
+    extract_coordinates(l_record,l_offset,l_new_coordinates);
+    return new alert_record(l_way_id,
+                            l_changeset_id,
+                            l_user_name,
+                            l_user_id,
+                            l_way_url,
+                            l_changeset_url,
+                            l_user_url,
+                            l_alignment_modification_rate,
+                            l_min_square_modification_rate,
+                            l_old_coordinates,
+                            l_new_coordinates,
+                            l_center_lat,
+                            l_center_lon);
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::check_size(const std::string & p_buffer,
+                                const size_t & p_offset,
+                                const size_t & p_size)
+  {
+    if(p_offset + p_size > p_buffer.size())
+      {
+	throw quicky_exception::quicky_runtime_exception("Corrupted record in binary alert stream",__LINE__,__FILE__);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t alert_stream::extract_uint32(const std::string & p_buffer,
+                                        size_t & p_offset)
+  {
+    check_size(p_buffer,p_offset,4);
+    uint32_t l_result = 0;
+    for(uint32_t l_index = 0 ; l_index < 4 ; ++l_index)
+      {
+        l_result |= ((uint32_t)(unsigned char)p_buffer[p_offset + l_index]) << (8 * l_index);
+      }
+    p_offset += 4;
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t alert_stream::extract_uint64(const std::string & p_buffer,
+                                        size_t & p_offset)
+  {
+    uint64_t l_low = extract_uint32(p_buffer,p_offset);
+    uint64_t l_high = extract_uint32(p_buffer,p_offset);
+    return l_low | (l_high << 32);
+  }
+
+  //----------------------------------------------------------------------------
+  double alert_stream::extract_double(const std::string & p_buffer,
+                                      size_t & p_offset)
+  {
+    uint64_t l_bits = extract_uint64(p_buffer,p_offset);
+    double l_result;
+    memcpy(&l_result,&l_bits,sizeof(l_result));
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  std::string alert_stream::extract_string(const std::string & p_buffer,
+                                           size_t & p_offset)
+  {
+    uint32_t l_size = extract_uint32(p_buffer,p_offset);
+    check_size(p_buffer,p_offset,l_size);
+    std::string l_result = p_buffer.substr(p_offset,l_size);
+    p_offset += l_size;
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  void alert_stream::extract_coordinates(const std::string & p_buffer,
+                                         size_t & p_offset,
+                                         std::vector<std::pair<double,double> > & p_coordinates)
+  {
+    uint32_t l_size = extract_uint32(p_buffer,p_offset);
+    check_size(p_buffer,p_offset,16 * (size_t)l_size);
+    p_coordinates.reserve(l_size);
+    for(uint32_t l_index = 0 ; l_index < l_size ; ++l_index)
+      {
+        double l_lat = extract_double(p_buffer,p_offset);
+        double l_lon = extract_double(p_buffer,p_offset);
+        p_coordinates.push_back(std::make_pair(l_lat,l_lon));
+      }
+  }
+
+  const uint32_t alert_stream::m_binary_version = 2;
+}
+//EOF
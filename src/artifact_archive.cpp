@@ -0,0 +1,163 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "artifact_archive.h"
+#include "quicky_exception.h"
+#include <sstream>
+#include <vector>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  artifact_archive::artifact_archive(void):
+    m_offset(0)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  artifact_archive::~artifact_archive(void)
+  {
+    close();
+  }
+
+  //----------------------------------------------------------------------------
+  void artifact_archive::open(const std::string & p_file_name)
+  {
+    close();
+    m_file_name = p_file_name;
+
+    // Archive may already exist : new entries are added after existing ones
+    std::ifstream l_existing_file(p_file_name.c_str(),std::ios::in | std::ios::binary | std::ios::ate);
+    m_offset = l_existing_file.is_open() ? (uint64_t)l_existing_file.tellg() : 0;
+    l_existing_file.close();
+
+    m_data_file.open(p_file_name.c_str(),std::ios::out | std::ios::binary | std::ios::app);
+    if(!m_data_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when opening archive \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    std::string l_index_file_name = p_file_name + ".idx";
+    m_index_file.open(l_index_file_name.c_str(),std::ios::out | std::ios::app);
+    if(!m_index_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when opening archive index \"" << l_index_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void artifact_archive::append(const std::string & p_name,
+                                const std::string & p_content)
+  {
+    m_data_file.write(p_content.data(),p_content.size());
+    m_index_file << m_offset << " " << p_content.size() << " " << p_name << "\n" ;
+    m_offset += p_content.size();
+  }
+
+  //----------------------------------------------------------------------------
+  void artifact_archive::flush(void)
+  {
+    // Data is flushed first so that index never references missing bytes
+    m_data_file.flush();
+    m_index_file.flush();
+  }
+
+  //----------------------------------------------------------------------------
+  void artifact_archive::close(void)
+  {
+    if(m_data_file.is_open())
+      {
+        flush();
+        m_data_file.close();
+        m_index_file.close();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool artifact_archive::extract(const std::string & p_file_name,
+                                 const std::string & p_name,
+                                 std::string & p_content)
+  {
+    std::map<std::string,std::pair<uint64_t,uint64_t> > l_entries;
+    read_index(p_file_name,l_entries);
+    std::map<std::string,std::pair<uint64_t,uint64_t> >::const_iterator l_iter = l_entries.find(p_name);
+    if(l_iter == l_entries.end())
+      {
+        return false;
+      }
+    uint64_t l_offset = l_iter->second.first;
+    uint64_t l_size = l_iter->second.second;
+
+    std::ifstream l_data_file(p_file_name.c_str(),std::ios::in | std::ios::binary);
+    if(!l_data_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when opening archive \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    l_data_file.seekg(l_offset);
+    std::vector<char> l_buffer(l_size);
+    if(l_size && !l_data_file.read(&l_buffer[0],l_size))
+      {
+	std::stringstream l_stream;
+	l_stream << "Truncated entry \"" << p_name << "\" in archive \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    p_content.assign(l_buffer.begin(),l_buffer.end());
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void artifact_archive::read_index(const std::string & p_file_name,
+                                    std::map<std::string,std::pair<uint64_t,uint64_t> > & p_entries)
+  {
+    std::string l_index_file_name = p_file_name + ".idx";
+    std::ifstream l_index_file(l_index_file_name.c_str());
+    if(!l_index_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when opening archive index \"" << l_index_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    uint64_t l_entry_offset;
+    uint64_t l_entry_size;
+    std::string l_entry_name;
+    while(l_index_file >> l_entry_offset >> l_entry_size >> l_entry_name)
+      {
+        p_entries[l_entry_name] = std::pair<uint64_t,uint64_t>(l_entry_offset,l_entry_size);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  std::string artifact_archive::get_unpack_directory(const std::string & p_file_name)
+  {
+    std::string l_result = p_file_name;
+    std::string::size_type l_pos = l_result.rfind(".pack");
+    if(l_pos != std::string::npos && l_pos + 5 == l_result.size())
+      {
+        l_result = l_result.substr(0,l_pos);
+      }
+    return l_result + "_artifacts";
+  }
+}
+//EOF
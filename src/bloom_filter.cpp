@@ -0,0 +1,69 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "bloom_filter.h"
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  bloom_filter::bloom_filter(const uint32_t & p_nb_bits,
+                             const uint32_t & p_nb_hash):
+    m_nb_bits(p_nb_bits ? p_nb_bits : 1),
+    m_nb_hash(p_nb_hash ? p_nb_hash : 1),
+    m_bits((m_nb_bits + 31) / 32,0)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void bloom_filter::insert(const uint64_t & p_key)
+  {
+    for(uint32_t l_index = 0 ; l_index < m_nb_hash ; ++l_index)
+      {
+        uint32_t l_bit = get_bit_index(p_key,l_index);
+        m_bits[l_bit / 32] |= ((uint32_t)1) << (l_bit % 32);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool bloom_filter::may_contain(const uint64_t & p_key)const
+  {
+    for(uint32_t l_index = 0 ; l_index < m_nb_hash ; ++l_index)
+      {
+        uint32_t l_bit = get_bit_index(p_key,l_index);
+        if(!(m_bits[l_bit / 32] & (((uint32_t)1) << (l_bit % 32))))
+          {
+            return false;
+          }
+      }
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void bloom_filter::clear(void)
+  {
+    for(std::vector<uint32_t>::iterator l_iter = m_bits.begin();
+        l_iter != m_bits.end();
+        ++l_iter)
+      {
+        *l_iter = 0;
+      }
+  }
+}
+//EOF
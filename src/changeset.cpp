@@ -22,33 +22,250 @@
 #include "way.h"
 #include "node.h"
 #include "osm_way.h"
-#include "svg_report.h"
+#include "alert_record.h"
 #include "linear_regression.h"
+#include "regression_moments.h"
+#include "local_map.h"
+#include "node_location_store.h"
+#include "metrics.h"
+#include "tracer.h"
 #include "node_alignment_analyzer.h"
 #include "quicky_exception.h"
 #include <sstream>
 #include <limits>
 #include <cmath>
 #include <iomanip>
+#include <queue>
+#include <algorithm>
+#include <iterator>
 
 namespace osm_diff_analyzer_node_alignment
 {
   //----------------------------------------------------------------------------
   void changeset::add(const osm_api_data_types::osm_way & p_way)
   {
+    // A way modified twice in the same changeset replaces its previous representation
+    std::map<osm_api_data_types::osm_object::t_osm_id,way*>::iterator l_existing_iter = m_ways.find(p_way.get_id());
+    if(l_existing_iter != m_ways.end())
+      {
+        remove_way(*(l_existing_iter->second));
+        delete l_existing_iter->second;
+        m_ways.erase(l_existing_iter);
+      }
 
     // Create a simplified representation of way that will survive to diff end of life
     way * l_way = new way(p_way.get_id(),p_way.get_user(),p_way.get_user_id(),p_way.get_version(),true);
     m_ways.insert(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::value_type(p_way.get_id(),l_way));
     const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_node_refs = p_way.get_node_refs();
     l_way->set_node_refs(l_node_refs);
+
+    // Index way by its nodes and take into account nodes already known
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_node_refs.begin();
+        l_iter != l_node_refs.end();
+        ++l_iter)
+      {
+        m_node_ways[*l_iter].push_back(l_way);
+        osm_id_map<node*>::iterator l_node_iter = m_nodes.find(*l_iter);
+        if(l_node_iter != m_nodes.end())
+          {
+            l_node_iter->second->attach_to(*l_way);
+          }
+      }
   }
+
   //----------------------------------------------------------------------------
   void changeset::add(const osm_api_data_types::osm_node & p_node)
   {
+    osm_id_map<node*>::iterator l_node_iter = m_nodes.find(p_node.get_id());
+    if(l_node_iter != m_nodes.end())
+      {
+        // Node modified several times in changeset : only the latest
+        // coordinates and the version preceding the first one are relevant
+        node & l_existing_node = *(l_node_iter->second);
+        if(p_node.get_version() > l_existing_node.get_latest_version())
+          {
+            // Moments of ways containing it are updated in O(1)
+            l_existing_node.set_coordinates(p_node.get_lat(),p_node.get_lon());
+            l_existing_node.set_latest_version(p_node.get_version());
+          }
+        else if(p_node.get_version() < l_existing_node.get_version())
+          {
+            // Versions were not received in order : baseline has to be the
+            // version preceding this one
+            l_existing_node.set_version(p_node.get_version());
+            l_existing_node.reset_baseline();
+            set_known_baseline(l_existing_node);
+          }
+        else
+          {
+            return;
+          }
+        m_known_node_cache.insert(p_node.get_id(),p_node.get_version(),p_node.get_lat(),p_node.get_lon());
+        if(l_existing_node.may_have_moved())
+          {
+            m_nodes_to_check.insert(p_node.get_id());
+          }
+        else
+          {
+            m_nodes_to_check.erase(p_node.get_id());
+          }
+        return;
+      }
     node * l_node = new node(p_node.get_id(),p_node.get_user(),p_node.get_user_id(),p_node.get_version(),p_node.get_lat(),p_node.get_lon(),true);
-    m_nodes.insert(std::map<osm_api_data_types::osm_object::t_osm_id,node*>::value_type(p_node.get_id(),l_node));
-    m_nodes_to_check.insert(p_node.get_id());
+    m_nodes.insert(osm_id_map<node*>::value_type(p_node.get_id(),l_node));
+
+    // A node that did not move cannot be the reason of an alignment so it is
+    // not looked up for candidate ways
+    set_known_baseline(*l_node);
+    m_known_node_cache.insert(p_node.get_id(),p_node.get_version(),p_node.get_lat(),p_node.get_lon());
+    if(l_node->may_have_moved())
+      {
+        m_nodes_to_check.insert(p_node.get_id());
+      }
+    else
+      {
+        metrics::increment(metrics::PREFILTERED_NODES);
+      }
+
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<way*> >::const_iterator l_ways_iter = m_node_ways.find(p_node.get_id());
+    if(l_ways_iter != m_node_ways.end())
+      {
+        for(std::vector<way*>::const_iterator l_iter = l_ways_iter->second.begin();
+            l_iter != l_ways_iter->second.end();
+            ++l_iter)
+          {
+            l_node->attach_to(**l_iter);
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::set_known_baseline(node & p_node)
+  {
+    // Version preceding changeset may have been seen in an earlier diff : no
+    // need to request it
+    float l_previous_lat;
+    float l_previous_lon;
+    if(m_known_node_cache.find(p_node.get_id(),p_node.get_version() - 1,l_previous_lat,l_previous_lon))
+      {
+        p_node.set_baseline(l_previous_lat,l_previous_lon);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::remove_way(const way & p_way)
+  {
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_node_refs = p_way.get_node_refs();
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_node_refs.begin();
+        l_iter != l_node_refs.end();
+        ++l_iter)
+      {
+        std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<way*> >::iterator l_ways_iter = m_node_ways.find(*l_iter);
+        if(l_ways_iter != m_node_ways.end())
+          {
+            std::vector<way*> & l_ways = l_ways_iter->second;
+            for(std::vector<way*>::iterator l_way_iter = l_ways.begin();
+                l_way_iter != l_ways.end();
+                ++l_way_iter)
+              {
+                if(*l_way_iter == &p_way)
+                  {
+                    l_ways.erase(l_way_iter);
+                    break;
+                  }
+              }
+            if(l_ways.empty())
+              {
+                m_node_ways.erase(l_ways_iter);
+              }
+          }
+        osm_id_map<node*>::iterator l_node_iter = m_nodes.find(*l_iter);
+        if(l_node_iter != m_nodes.end())
+          {
+            l_node_iter->second->detach_from(p_way);
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool changeset::get_way_alignment_score(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                          double & p_score)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,way*>::const_iterator l_iter = m_ways.find(p_id);
+    if(l_iter == m_ways.end())
+      {
+        return false;
+      }
+    p_score = l_iter->second->get_alignment_score();
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t changeset::get_memory_footprint(void)const
+  {
+    uint64_t l_result = sizeof(changeset) + memory_footprint::get(m_user_name);
+    l_result += memory_footprint::get(m_ways);
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::const_iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        l_result += l_iter->second->get_memory_footprint();
+      }
+    l_result += m_nodes.get_memory_footprint();
+    for(osm_id_map<node*>::const_iterator l_iter = m_nodes.begin();
+        l_iter != m_nodes.end();
+        ++l_iter)
+      {
+        l_result += l_iter->second->get_memory_footprint();
+      }
+    l_result += memory_footprint::get(m_node_ways);
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<way*> >::const_iterator l_iter = m_node_ways.begin();
+        l_iter != m_node_ways.end();
+        ++l_iter)
+      {
+        l_result += memory_footprint::get(l_iter->second);
+      }
+    l_result += memory_footprint::get(m_nodes_to_check);
+    l_result += memory_footprint::get(m_checked_ways);
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  bool changeset::may_contain_alignment(void)const
+  {
+    uint32_t l_min_moved_nodes = get_min_moved_nodes();
+    uint32_t l_nb_movable_nodes = 0;
+    for(osm_id_map<node*>::const_iterator l_iter = m_nodes.begin();
+        l_iter != m_nodes.end() && l_nb_movable_nodes < l_min_moved_nodes;
+        ++l_iter)
+      {
+        if(l_iter->second->may_have_moved())
+          {
+            ++l_nb_movable_nodes;
+          }
+      }
+    return l_nb_movable_nodes >= l_min_moved_nodes;
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t changeset::get_min_moved_nodes(void)
+  {
+    // Ways are checked when they have more than m_min_way_node_nb nodes. Both
+    // criteria of has_enough_moved_nodes need more moved nodes when the way
+    // has more nodes (rate above a level, all nodes but two) so the smallest
+    // checked way gives the bound. A 2 nodes way passes with no moved node
+    // as "all nodes but two" is then reached, so the bound is null when
+    // such ways are checked. The way size is therefore at least 2, which
+    // also keeps the "all nodes but two" count from wrapping around
+    uint32_t l_nb_way_nodes = m_min_way_node_nb + 1 < 2 ? 2 : m_min_way_node_nb + 1;
+    uint32_t l_result = 0;
+    // Exact float evaluation of check_way is reused rather than inverting the
+    // rate formula. Loop ends at worst with all nodes but two
+    while(!has_enough_moved_nodes(l_result,l_nb_way_nodes))
+      {
+        ++l_result;
+      }
+    return l_result;
   }
 
   //----------------------------------------------------------------------------
@@ -60,65 +277,245 @@ namespace osm_diff_analyzer_node_alignment
       {
         delete l_iter->second;
       }
-    for(std::map<osm_api_data_types::osm_object::t_osm_id,node*>::iterator l_iter = m_nodes.begin();
+    for(osm_id_map<node*>::iterator l_iter = m_nodes.begin();
         l_iter != m_nodes.end();
         ++l_iter)
       {
         delete l_iter->second;
       }
+    delete m_local_map;
   }
   //----------------------------------------------------------------------------
-  void changeset::search_aligned_ways(std::ofstream & p_stream)
+  void changeset::search_aligned_ways(void)
   {
+    tracer::scoped_span l_span("search_aligned_ways");
+    load_local_map();
+
     // First check if modified ways has been aligned to eliminate a maximum of nodes to limite API
     // call that will be done later for each node to determine to which way it belongs
     // If a way has been aligned all its nodes will be removed and no more analyzed
-    for(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::iterator l_iter_way = m_ways.begin();
-        l_iter_way != m_ways.end();
-        ++l_iter_way)
-      {
-        check_way(l_iter_way->second->get_id(),l_iter_way->second->get_node_refs());
-      }
+    // Ways covering the biggest number of modified nodes are checked first
+    check_by_coverage(m_ways,false);
 
-
-    // For each node get ways
-    while(m_nodes_to_check.size())
+    if(m_local_map != NULL)
       {
-        std::set<osm_api_data_types::osm_object::t_osm_id>::iterator l_iter_id = m_nodes_to_check.begin();
-        std::map<osm_api_data_types::osm_object::t_osm_id,node*>::iterator l_iter_node = m_nodes.find(*l_iter_id);
-
-        bool l_aligned = false;
-        const std::vector<osm_api_data_types::osm_way*> * const l_ways = m_api->get_node_ways(l_iter_node->second->get_id());
-        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_iter_way = l_ways->begin();
-            l_iter_way != l_ways->end() && !l_aligned;
-            ++l_iter_way)
+        // Parent ways of nodes known by local map are got without API call
+        // so they can be collected at once and scored globally
+        std::map<osm_api_data_types::osm_object::t_osm_id,way*> l_candidate_ways;
+        candidate_collector l_collector(m_checked_ways,l_candidate_ways);
+        std::set<osm_api_data_types::osm_object::t_osm_id> l_unknown_nodes;
+        for(std::set<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter_id = m_nodes_to_check.begin();
+            l_iter_id != m_nodes_to_check.end();
+            ++l_iter_id)
           {
-            if(!l_aligned && m_checked_ways.find((*l_iter_way)->get_id()) == m_checked_ways.end())
+            const std::vector<const way*> * l_local_ways = m_local_map->get_node_ways(*l_iter_id);
+            if(l_local_ways != NULL)
               {
-                l_aligned = check_way((*l_iter_way)->get_id(),(*l_iter_way)->get_node_refs());
-                m_checked_ways.insert((*l_iter_way)->get_id());
+                for(std::vector<const way*>::const_iterator l_iter_way = l_local_ways->begin();
+                    l_iter_way != l_local_ways->end();
+                    ++l_iter_way)
+                  {
+                    l_collector(**l_iter_way);
+                  }
+              }
+            else
+              {
+                l_unknown_nodes.insert(*l_iter_id);
               }
           }
-        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_iter_way = l_ways->begin();
-            l_iter_way != l_ways->end();
-            ++l_iter_way)
+        check_by_coverage(l_candidate_ways,true);
+        delete_ways(l_candidate_ways);
+
+        // All parent ways of known nodes have been checked
+        std::set<osm_api_data_types::osm_object::t_osm_id> l_remaining_nodes;
+        std::set_intersection(m_nodes_to_check.begin(),m_nodes_to_check.end(),
+                              l_unknown_nodes.begin(),l_unknown_nodes.end(),
+                              std::inserter(l_remaining_nodes,l_remaining_nodes.begin()));
+        m_nodes_to_check.swap(l_remaining_nodes);
+      }
+
+    // Each parent ways request costs an API call : they are requested node
+    // by node so that nodes eliminated by an alignment found with a previous
+    // node are never requested
+    while(m_nodes_to_check.size())
+      {
+        osm_api_data_types::osm_object::t_osm_id l_node_id = *(m_nodes_to_check.begin());
+        std::map<osm_api_data_types::osm_object::t_osm_id,way*> l_candidate_ways;
+        candidate_collector l_collector(m_checked_ways,l_candidate_ways);
+        m_api->visit_node_ways(l_node_id,l_collector);
+        check_by_coverage(l_candidate_ways,true);
+        delete_ways(l_candidate_ways);
+        m_nodes_to_check.erase(l_node_id);
+      }
+    m_nodes_to_check.clear();
+    delete m_local_map;
+    m_local_map = NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::check_by_coverage(const std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_ways,
+                                    bool p_skip_uncovered)
+  {
+    // Scores are lazily refreshed when a previous alignment eliminated some
+    // nodes
+    std::priority_queue<std::pair<uint32_t,osm_api_data_types::osm_object::t_osm_id> > l_queue;
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::const_iterator l_iter_way = p_ways.begin();
+        l_iter_way != p_ways.end();
+        ++l_iter_way)
+      {
+        l_queue.push(std::pair<uint32_t,osm_api_data_types::osm_object::t_osm_id>(count_nodes_to_check(l_iter_way->second->get_node_refs()),l_iter_way->first));
+      }
+    while(l_queue.size())
+      {
+        std::pair<uint32_t,osm_api_data_types::osm_object::t_osm_id> l_candidate = l_queue.top();
+        l_queue.pop();
+        const way & l_way = *(p_ways.find(l_candidate.second)->second);
+        uint32_t l_coverage = count_nodes_to_check(l_way.get_node_refs());
+        if(!l_coverage && p_skip_uncovered)
           {
-            delete *l_iter_way;
+            continue;
           }
-        delete l_ways;
-        if(!l_aligned)
+        if(l_coverage < l_candidate.first)
           {
-            m_nodes_to_check.erase(l_iter_id);
+            l_queue.push(std::pair<uint32_t,osm_api_data_types::osm_object::t_osm_id>(l_coverage,l_candidate.second));
+            continue;
           }
+        check_way(l_way.get_id(),l_way.get_version(),l_way.get_node_refs());
+        m_checked_ways.insert(l_way.get_id());
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::delete_ways(std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_ways)
+  {
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::iterator l_iter_way = p_ways.begin();
+        l_iter_way != p_ways.end();
+        ++l_iter_way)
+      {
+        delete l_iter_way->second;
+      }
+    p_ways.clear();
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::load_local_map(void)
+  {
+    if(!m_get_map_max_area || m_nodes.size() < m_get_map_min_nodes)
+      {
+        return;
+      }
+
+    // Compute changeset bounding box
+    float l_min_lat = 90.0;
+    float l_max_lat = -90.0;
+    float l_min_lon = 180.0;
+    float l_max_lon = -180.0;
+    for(osm_id_map<node*>::const_iterator l_iter = m_nodes.begin();
+        l_iter != m_nodes.end();
+        ++l_iter)
+      {
+        const node & l_node = *(l_iter->second);
+        if(l_node.get_lat() < l_min_lat) l_min_lat = l_node.get_lat();
+        if(l_node.get_lat() > l_max_lat) l_max_lat = l_node.get_lat();
+        if(l_node.get_lon() < l_min_lon) l_min_lon = l_node.get_lon();
+        if(l_node.get_lon() > l_max_lon) l_max_lon = l_node.get_lon();
+      }
+    // Large boxes would download too much data : keep per node API requests
+    if((l_max_lat - l_min_lat) * (l_max_lon - l_min_lon) > m_get_map_max_area)
+      {
+        return;
+      }
 
+    std::vector<osm_api_data_types::osm_node*> l_nodes;
+    std::vector<osm_api_data_types::osm_way*> l_ways;
+    std::vector<osm_api_data_types::osm_relation*> l_relations;
+    try
+      {
+        m_api->get_map(osm_api_data_types::osm_bounding_box(l_min_lat,l_min_lon,l_max_lat,l_max_lon),l_nodes,l_ways,l_relations);
+        m_local_map = new local_map();
+        m_local_map->load(l_nodes,l_ways);
+      }
+    catch(quicky_exception::quicky_runtime_exception & e)
+      {
+        // Server refused the map request : fallback on per node requests
+        delete m_local_map;
+        m_local_map = NULL;
       }
 
+    for(std::vector<osm_api_data_types::osm_node*>::iterator l_iter = l_nodes.begin();
+        l_iter != l_nodes.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+    for(std::vector<osm_api_data_types::osm_way*>::iterator l_iter = l_ways.begin();
+        l_iter != l_ways.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+    for(std::vector<osm_api_data_types::osm_relation*>::iterator l_iter = l_relations.begin();
+        l_iter != l_relations.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
   }
 
   //----------------------------------------------------------------------------
-  bool changeset::check_way(const osm_api_data_types::osm_object::t_osm_id & p_id,const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs)
+  changeset::candidate_collector::candidate_collector(const std::set<osm_api_data_types::osm_object::t_osm_id> & p_checked_ways,
+                                                      std::map<osm_api_data_types::osm_object::t_osm_id,way*> & p_candidate_ways):
+    m_checked_ways(p_checked_ways),
+    m_candidate_ways(p_candidate_ways)
   {
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::candidate_collector::operator()(const osm_api_data_types::osm_way & p_way)
+  {
+    if(m_checked_ways.find(p_way.get_id()) == m_checked_ways.end() && m_candidate_ways.find(p_way.get_id()) == m_candidate_ways.end())
+      {
+        way * l_way = new way(p_way.get_id(),p_way.get_user(),p_way.get_user_id(),p_way.get_version(),false);
+        l_way->set_node_refs(p_way.get_node_refs());
+        m_candidate_ways.insert(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::value_type(l_way->get_id(),l_way));
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void changeset::candidate_collector::operator()(const way & p_way)
+  {
+    if(m_checked_ways.find(p_way.get_id()) == m_checked_ways.end() && m_candidate_ways.find(p_way.get_id()) == m_candidate_ways.end())
+      {
+        way * l_way = new way(p_way.get_id(),"",0,p_way.get_version(),false);
+        l_way->set_node_refs(p_way.get_node_refs());
+        m_candidate_ways.insert(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::value_type(l_way->get_id(),l_way));
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t changeset::count_nodes_to_check(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs)const
+  {
+    uint32_t l_result = 0;
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = p_node_refs.begin();
+        l_iter != p_node_refs.end();
+        ++l_iter)
+      {
+        if(m_nodes_to_check.find(*l_iter) != m_nodes_to_check.end())
+          {
+            ++l_result;
+          }
+      }
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  bool changeset::check_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                            const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                            const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_node_refs)
+  {
+    tracer::scoped_span l_span("check_way",p_id);
     bool l_result = false;
+    metrics::increment(metrics::CHECKED_WAYS);
     if(p_node_refs.size()> m_min_way_node_nb)
       {
         std::vector<node*> l_modified_nodes;
@@ -129,7 +526,7 @@ namespace osm_diff_analyzer_node_alignment
             l_way_node != p_node_refs.end();
             ++l_way_node)
           {
-            std::map<osm_api_data_types::osm_object::t_osm_id,node*>::iterator l_node_iter = m_nodes.find(*l_way_node);
+            osm_id_map<node*>::iterator l_node_iter = m_nodes.find(*l_way_node);
             if(l_node_iter != m_nodes.end())
               {
                 l_modified_nodes.push_back(l_node_iter->second);
@@ -141,28 +538,68 @@ namespace osm_diff_analyzer_node_alignment
           {
             // Check how many nodes has been moved by comparing with previous version of node
             // The check stop if the number of unmoved node is sufficiant to be sure that the modification rate will not be reached
+            uint64_t l_stage_start = metrics::start();
             uint32_t l_nb_moved_node = l_modified_nodes.size();
-            l_modif_rate = ((float)(l_nb_moved_node)/((float)p_node_refs.size()));
             for(std::vector<node*>::const_iterator l_iter_node = l_modified_nodes.begin();
-                l_iter_node != l_modified_nodes.end() && ( l_modif_rate > m_modif_rate_min_level || l_nb_moved_node >= p_node_refs.size() - 2 );
+                l_iter_node != l_modified_nodes.end() && has_enough_moved_nodes(l_nb_moved_node,p_node_refs.size());
                 ++l_iter_node)
               {
-                const osm_api_data_types::osm_node * l_previous_node = m_api->get_node_version((*l_iter_node)->get_id(),(*l_iter_node)->get_version()-1);
-		if(l_previous_node == NULL) throw quicky_exception::quicky_runtime_exception("l_previous_node should not be NULL",__LINE__,__FILE__);
-                if(l_previous_node->get_lat() == (*l_iter_node)->get_lat() && l_previous_node->get_lon() == (*l_iter_node)->get_lon())
+                // Previous version may be known from ingestion or from the check of another way
+                if(!(*l_iter_node)->has_baseline())
+                  {
+                    float l_baseline_lat;
+                    float l_baseline_lon;
+                    if(!m_api->get_node_coordinates((*l_iter_node)->get_id(),(*l_iter_node)->get_version()-1,l_baseline_lat,l_baseline_lon)) throw quicky_exception::quicky_runtime_exception("l_previous_node should not be NULL",__LINE__,__FILE__);
+                    (*l_iter_node)->set_baseline(l_baseline_lat,l_baseline_lon);
+                  }
+                float l_previous_lat = (*l_iter_node)->get_baseline_lat();
+                float l_previous_lon = (*l_iter_node)->get_baseline_lon();
+                if(l_previous_lat == (*l_iter_node)->get_lat() && l_previous_lon == (*l_iter_node)->get_lon())
                   {
                     --l_nb_moved_node;
-                    l_modif_rate = ((float)(l_nb_moved_node)/((float)p_node_refs.size()));
                   }
                 else
                   {
-                    m_old_nodes_coordinates.insert(std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<double,double> >::value_type((*l_iter_node)->get_id(),std::pair<double,double>(l_previous_node->get_lat(),l_previous_node->get_lon())));
+                    m_old_nodes_coordinates.insert(std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<double,double> >::value_type((*l_iter_node)->get_id(),std::pair<double,double>(l_previous_lat,l_previous_lon)));
                   }
-                delete l_previous_node;
               }
+            metrics::stop(metrics::STAGE_MOVE_DETECTION,l_stage_start);
             // Check if verification has been completed : sign of complete aligned way
-            if(l_modif_rate > m_modif_rate_min_level || l_nb_moved_node >= p_node_refs.size() - 2 )
+            if(has_enough_moved_nodes(l_nb_moved_node,p_node_refs.size()))
               {
+                // Baselines of all modified nodes are known at this point.
+                // The same move may have been found not aligned for another
+                // changeset, typically when an edit is reverted again
+                uint64_t l_coordinates_hash = 0;
+                for(std::vector<node*>::const_iterator l_iter_node = l_modified_nodes.begin();
+                    l_iter_node != l_modified_nodes.end();
+                    ++l_iter_node)
+                  {
+                    l_coordinates_hash = checked_way_cache::mix(l_coordinates_hash,(uint64_t)(*l_iter_node)->get_id());
+                    l_coordinates_hash = checked_way_cache::mix(l_coordinates_hash,(*l_iter_node)->get_baseline_lat());
+                    l_coordinates_hash = checked_way_cache::mix(l_coordinates_hash,(*l_iter_node)->get_baseline_lon());
+                    l_coordinates_hash = checked_way_cache::mix(l_coordinates_hash,(*l_iter_node)->get_lat());
+                    l_coordinates_hash = checked_way_cache::mix(l_coordinates_hash,(*l_iter_node)->get_lon());
+                  }
+                checked_way_cache::key l_cache_key(p_id,p_version,l_coordinates_hash);
+                if(m_checked_way_cache.contains(l_cache_key))
+                  {
+                    return false;
+                  }
+
+                l_stage_start = metrics::start();
+
+                // Moments of nodes known by the changeset are already accumulated
+                // for modified ways so only remaining nodes have to be added
+                std::map<osm_api_data_types::osm_object::t_osm_id,way*>::const_iterator l_tracked_way_iter = m_ways.find(p_id);
+                bool l_tracked = l_tracked_way_iter != m_ways.end() && l_tracked_way_iter->second->get_node_refs() == p_node_refs;
+                regression_moments l_old_moments;
+                regression_moments l_new_moments;
+                if(l_tracked)
+                  {
+                    l_old_moments = l_tracked_way_iter->second->get_baseline_moments();
+                    l_new_moments = l_tracked_way_iter->second->get_moments();
+                  }
 
                 //Reconstitute ways
                 std::vector<std::pair<double,double> > l_old_coordinates2;
@@ -172,86 +609,96 @@ namespace osm_diff_analyzer_node_alignment
                     ++l_way_node)
                   {
                     std::pair<double,double> l_current_coordinates;
-                    std::map<osm_api_data_types::osm_object::t_osm_id,node*>::iterator l_node_iter = m_nodes.find(*l_way_node);
+                    float l_lat;
+                    float l_lon;
+                    osm_id_map<node*>::iterator l_node_iter = m_nodes.find(*l_way_node);
                     bool l_bad_coordinates = false;
                     if(l_node_iter != m_nodes.end())
                       {
                         l_current_coordinates = std::pair<double,double>(l_node_iter->second->get_lat(),l_node_iter->second->get_lon());
                       }
+                    else if((m_node_location_store != NULL && m_node_location_store->get(*l_way_node,l_lat,l_lon)) ||
+                            (m_local_map != NULL && m_local_map->get_coordinates(*l_way_node,l_lat,l_lon)) ||
+                            m_api->get_node_coordinates(*l_way_node,0,l_lat,l_lon))
+                      {
+                        l_current_coordinates = std::pair<double,double>(l_lat,l_lon);
+                      }
                     else 
                       {
-                        const osm_api_data_types::osm_node * l_node = m_api->get_node_version(*l_way_node);
-                        if(l_node != NULL)
-                          {
-                            l_current_coordinates = std::pair<double,double>(l_node->get_lat(),l_node->get_lon());
-                            delete l_node;
-                          }
-                        else
-                          {
-                            l_bad_coordinates = true;
-                          }
+                        l_bad_coordinates = true;
                       }
                     
                     if(!l_bad_coordinates)
                       {
                         l_new_coordinates2.push_back(l_current_coordinates);
+                        if(!l_tracked || l_node_iter == m_nodes.end())
+                          {
+                            l_new_moments.add(l_current_coordinates.first,l_current_coordinates.second);
+                          }
                       }
 
                     std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<double,double> >::const_iterator l_iter_coordinates = m_old_nodes_coordinates.find(*l_way_node);
                     if(l_iter_coordinates != m_old_nodes_coordinates.end())
                       {
                         l_old_coordinates2.push_back(l_iter_coordinates->second);
+                        if(!l_tracked)
+                          {
+                            l_old_moments.add(l_iter_coordinates->second.first,l_iter_coordinates->second.second);
+                          }
                       }
                     else if(!l_bad_coordinates)
                       {
                         l_old_coordinates2.push_back(l_current_coordinates);
+                        if(!l_tracked || l_node_iter == m_nodes.end())
+                          {
+                            l_old_moments.add(l_current_coordinates.first,l_current_coordinates.second);
+                          }
                       }
                   }
 
+                metrics::stop(metrics::STAGE_REBUILD,l_stage_start);
 
-                linear_regression l_regress_old;
-                double l_old_result = l_regress_old.compute(l_old_coordinates2);
-                linear_regression l_regress_new;
-                double l_new_result = l_regress_new.compute(l_new_coordinates2);
-
-                double l_alignment_modification_rate = ( l_new_result ? l_old_result / l_new_result : std::numeric_limits<double>::max());
-                double l_old_max_diff_square = l_regress_old.get_max_alignment_square();
-                double l_new_max_diff_square = l_regress_new.get_max_alignment_square();
-                double l_min_square_modification_rate = ( l_new_max_diff_square ? l_old_max_diff_square / l_new_max_diff_square : std::numeric_limits<double>::max());
+                l_stage_start = metrics::start();
+                double l_alignment_modification_rate;
+                double l_min_square_modification_rate;
+                double l_center_lat;
+                double l_center_lon;
+                bool l_aligned = score_alignment(l_old_moments,
+                                                 l_new_moments,
+                                                 l_old_coordinates2,
+                                                 l_new_coordinates2,
+                                                 l_alignment_modification_rate,
+                                                 l_min_square_modification_rate,
+                                                 l_center_lat,
+                                                 l_center_lon);
+                metrics::stop(metrics::STAGE_REGRESSION,l_stage_start);
 
                 // Way has been aligned, remove node form analyzis queue to reduce API requests
-                if(l_alignment_modification_rate > m_min_alignment_modification_rate && l_min_square_modification_rate  > m_min_alignment_modification_rate)
+                if(l_aligned)
                   {
-		    create_svg(p_id,l_old_coordinates2,l_new_coordinates2);
+                    metrics::scoped_timer l_timer(metrics::STAGE_REPORTING);
+                    tracer::scoped_span l_report_span("report_alert");
+                    metrics::increment(metrics::ALERTS);
                     l_result = true;
-                    std::stringstream l_id_stream;
-                    l_id_stream << m_id;
-                    std::stringstream l_way_id_stream;
-                    l_way_id_stream << p_id;
-
-                    std::string l_old_gpx = "way_"+l_way_id_stream.str()+"_c"+l_id_stream.str()+"_old";
-                    create_gpx(l_old_gpx,l_old_coordinates2);
-                    std::string l_new_gpx = "way_"+l_way_id_stream.str()+"_c"+l_id_stream.str()+"_new";
-                    create_gpx(l_new_gpx,l_new_coordinates2);
-
                     std::string l_object_url;
                     m_api->get_object_browse_url(l_object_url,"way",p_id); 
                     std::string l_changeset_url;
                     m_api->get_object_browse_url(l_changeset_url,"changeset",m_id);
                     std::string l_user_url;
                     m_api->get_user_browse_url(l_user_url,m_user_id,m_user_name);
-                    if(!m_report.is_open())
-                      {
-                        m_analyzer.create_report();
-                      }
-                    m_report << "<A HREF=\"" << l_object_url << "\">Way " << l_way_id_stream.str() << "</A> has been aligned by <A HREF=\"" << l_user_url << "\">" << m_user_name << "</A> in <A HREF=\"" << l_changeset_url << "\">Changeset " << l_id_stream.str() << "</A><BR>" << std::endl ;
-                    m_report << "With <B>alignment modification rate = " << l_alignment_modification_rate << "</B> and <B>Min square modification rate = " << l_min_square_modification_rate << "</B><BR>"  << std::endl ;
-                    std::string l_map_name = "map_"+l_way_id_stream.str()+"_c"+l_id_stream.str();
-                    m_report << "<button type=\"button\" onclick=\"init('" << l_map_name << "','" << l_old_gpx << ".gpx','" << l_new_gpx << ".gpx'," << l_regress_new.get_average_x() << "," << l_regress_new.get_average_y() << ")\">Display Map</button>" << std::endl;
-                    m_report << "<div id=\"" << l_map_name << "\" class=\"smallmap\">" <<std::endl ;
-                    m_report << "</div>" << std::endl ;
-                    m_report << "<IMG SRC=\"./way_" << l_way_id_stream.str() << ".svg\" ALT=\"Way_" << l_way_id_stream.str() << ".svg\" TITLE=\"Way " << l_way_id_stream.str() << "\" ALIGN=\"MIDDLE\" /><BR>" << std::endl ;
-                    m_report << "<HR/>" << std::endl ;
+                    m_analyzer.report_alert(new alert_record(p_id,
+                                                             m_id,
+                                                             m_user_name,
+                                                             m_user_id,
+                                                             l_object_url,
+                                                             l_changeset_url,
+                                                             l_user_url,
+                                                             l_alignment_modification_rate,
+                                                             l_min_square_modification_rate,
+                                                             l_old_coordinates2,
+                                                             l_new_coordinates2,
+                                                             l_center_lat,
+                                                             l_center_lon));
                   for(std::vector<node*>::iterator l_iter = l_modified_nodes.begin();
                         l_iter != l_modified_nodes.end();
                         ++l_iter)
@@ -259,6 +706,10 @@ namespace osm_diff_analyzer_node_alignment
                         m_nodes_to_check.erase((*l_iter)->get_id());
                       }
                   }
+                else
+                  {
+                    m_checked_way_cache.insert(l_cache_key);
+                  }
               }
           }
       }
@@ -266,63 +717,48 @@ namespace osm_diff_analyzer_node_alignment
   }
 
   //----------------------------------------------------------------------------
-  void changeset::create_gpx(const std::string & p_way_name,
-                             const std::vector<std::pair<double,double> > & p_points)
+  bool changeset::score_alignment(const regression_moments & p_old_moments,
+                                  const regression_moments & p_new_moments,
+                                  const std::vector<std::pair<double,double> > & p_old_coordinates,
+                                  const std::vector<std::pair<double,double> > & p_new_coordinates,
+                                  double & p_alignment_modification_rate,
+                                  double & p_min_square_modification_rate,
+                                  double & p_center_lat,
+                                  double & p_center_lon)
   {
-    std::string l_file_name = p_way_name + ".gpx";
-    std::ofstream l_gpx_file(l_file_name.c_str());
-    if(!l_gpx_file.is_open())
-      {
-	std::stringstream l_stream;
-	l_stream << "Error when creating GPX file \"" << l_file_name << "\"" ;
-	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
-      }
-    
-    l_gpx_file << "<?xml version=\"1.0\"?>" << std::endl ;
-    l_gpx_file << "<gpx version=\"1.0\""  << std::endl ;
-    l_gpx_file << "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\""  << std::endl ;
-    l_gpx_file << "xmlns=\"http://www.topografix.com/GPX/1/0\""  << std::endl ;
-    l_gpx_file << "xsi:schemaLocation=\"http://www.topografix.com/GPX/1/0 http://www.topografix.com/GPX/1/0/gpx.xsd\">"  << std::endl ;
-    l_gpx_file << "<trk>" << std::endl ;
-    l_gpx_file << "<name>" << p_way_name << "</name>" << std::endl ;
-    l_gpx_file << "<trkseg>" << std::endl ;
-    for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_points.begin();
-        l_iter != p_points.end();
-        ++l_iter)
-      {
-        l_gpx_file << "<trkpt lat=\""<< std::setprecision(15) << l_iter->first << "\" lon=\"" << l_iter->second << "\">" << std::endl ;
-        l_gpx_file << "</trkpt>" << std::endl ;
-     }
-    l_gpx_file << "</trkseg>" << std::endl ;
-    l_gpx_file << "</trk>" << std::endl ;
-    l_gpx_file << "</gpx>" << std::endl ;
-    l_gpx_file.close();
-  }
-
-  void changeset::create_svg(const osm_api_data_types::osm_object::t_osm_id & p_id,
-                             const std::vector<std::pair<double,double> > & p_old_list,
-                             const std::vector<std::pair<double,double> > & p_new_list)
-  {
-    std::stringstream l_id_stream;
-    l_id_stream << p_id;
-    std::string l_file_name = "way_"+l_id_stream.str()+".svg";
-
-    svg_report l_svg_report;
-    l_svg_report.update_xtrem_coordinates(p_old_list);
-    l_svg_report.update_xtrem_coordinates(p_new_list);
-    l_svg_report.adjust_xtrem_coordinates(0.1);
-  
-    l_svg_report.open(l_file_name);
-    l_svg_report.draw_polyline(p_old_list,"blue",1);
-    l_svg_report.draw_polyline(p_new_list,"red",0);
-    l_svg_report.close();
+    double l_old_result = p_old_moments.get_residual_sum();
+    double l_new_result = p_new_moments.get_residual_sum();
+    p_alignment_modification_rate = ( l_new_result ? l_old_result / l_new_result : std::numeric_limits<double>::max());
+    p_min_square_modification_rate = 0.0;
+    p_center_lat = 0.0;
+    p_center_lon = 0.0;
 
+    // Max square deviation needs the whole geometry so it is only
+    // computed when residual sums are compatible with an alignment
+    if(p_alignment_modification_rate <= m_min_alignment_modification_rate)
+      {
+        return false;
+      }
+    linear_regression l_regress_old;
+    linear_regression l_regress_new;
+    l_regress_old.compute(p_old_coordinates);
+    l_regress_new.compute(p_new_coordinates);
+    double l_old_max_diff_square = l_regress_old.get_max_alignment_square();
+    double l_new_max_diff_square = l_regress_new.get_max_alignment_square();
+    p_min_square_modification_rate = ( l_new_max_diff_square ? l_old_max_diff_square / l_new_max_diff_square : std::numeric_limits<double>::max());
+    p_center_lat = l_regress_new.get_average_x();
+    p_center_lon = l_regress_new.get_average_y();
+    return p_min_square_modification_rate > m_min_alignment_modification_rate;
   }
 
-
   float changeset::m_modif_rate_min_level = 0.9;
   float changeset::m_min_alignment_modification_rate = 100;
   node_alignment_common_api * changeset::m_api = NULL;
+  const node_location_store * changeset::m_node_location_store = NULL;
+  checked_way_cache changeset::m_checked_way_cache(100000);
+  known_node_cache changeset::m_known_node_cache(200000);
+  float changeset::m_get_map_max_area = 0.0;
+  uint32_t changeset::m_get_map_min_nodes = 10;
   uint32_t changeset::m_min_way_node_nb = 2;
 }
 //EOF
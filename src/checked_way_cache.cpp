@@ -0,0 +1,103 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "checked_way_cache.h"
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  checked_way_cache::checked_way_cache(const uint32_t & p_capacity):
+    m_capacity(p_capacity),
+    m_nb_evictions(0),
+    m_filter(8 * p_capacity,4),
+    m_nb_hits(0),
+    m_nb_misses(0),
+    m_nb_filtered(0)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void checked_way_cache::set_capacity(const uint32_t & p_capacity)
+  {
+    m_capacity = p_capacity;
+    while(m_results.size() > m_capacity)
+      {
+        m_results.erase(m_insertion_order.front());
+        m_insertion_order.pop_front();
+      }
+    m_filter = bloom_filter(8 * m_capacity,4);
+    rebuild_filter();
+  }
+
+  //----------------------------------------------------------------------------
+  bool checked_way_cache::contains(const key & p_key)
+  {
+    if(!m_filter.may_contain(p_key.get_hash()))
+      {
+        ++m_nb_filtered;
+        return false;
+      }
+    if(m_results.find(p_key) == m_results.end())
+      {
+        ++m_nb_misses;
+        return false;
+      }
+    ++m_nb_hits;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void checked_way_cache::insert(const key & p_key)
+  {
+    if(!m_capacity) return;
+    if(!m_results.insert(p_key).second)
+      {
+        return;
+      }
+    m_insertion_order.push_back(p_key);
+    m_filter.insert(p_key.get_hash());
+    if(m_results.size() > m_capacity)
+      {
+        m_results.erase(m_insertion_order.front());
+        m_insertion_order.pop_front();
+        // Evicted keys cannot be removed from filter so it is rebuilt once
+        // the whole cache content has been renewed
+        ++m_nb_evictions;
+        if(m_nb_evictions >= m_capacity)
+          {
+            rebuild_filter();
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void checked_way_cache::rebuild_filter(void)
+  {
+    m_filter.clear();
+    for(std::set<key>::const_iterator l_iter = m_results.begin();
+        l_iter != m_results.end();
+        ++l_iter)
+      {
+        m_filter.insert(l_iter->get_hash());
+      }
+    m_nb_evictions = 0;
+  }
+}
+//EOF
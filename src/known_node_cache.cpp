@@ -0,0 +1,86 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "known_node_cache.h"
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  known_node_cache::known_node_cache(const uint32_t & p_capacity):
+    m_capacity(p_capacity)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void known_node_cache::set_capacity(const uint32_t & p_capacity)
+  {
+    m_capacity = p_capacity;
+    if(size() > m_capacity)
+      {
+        m_previous.clear();
+        m_current.clear();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool known_node_cache::find(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                              const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                              float & p_lat,
+                              float & p_lon)const
+  {
+    osm_id_map<entry>::const_iterator l_iter = m_current.find(p_id);
+    if(l_iter == m_current.end())
+      {
+        l_iter = m_previous.find(p_id);
+        if(l_iter == m_previous.end())
+          {
+            return false;
+          }
+      }
+    if(l_iter->second.m_version != p_version)
+      {
+        return false;
+      }
+    p_lat = l_iter->second.m_lat;
+    p_lon = l_iter->second.m_lon;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  void known_node_cache::insert(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                const float & p_lat,
+                                const float & p_lon)
+  {
+    if(!m_capacity) return;
+    entry & l_entry = m_current[p_id];
+    // An older version may remain in previous generation but current one is
+    // always looked up first
+    if(l_entry.m_version > p_version) return;
+    l_entry = entry(p_version,p_lat,p_lon);
+    if(2 * m_current.size() >= m_capacity)
+      {
+        // Oldest generation is dropped in a single step
+        m_previous.clear();
+        m_previous.swap(m_current);
+      }
+  }
+}
+//EOF
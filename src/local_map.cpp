@@ -0,0 +1,106 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "local_map.h"
+#include "way.h"
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  local_map::local_map(void)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  local_map::~local_map(void)
+  {
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        delete l_iter->second;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void local_map::load(const std::vector<osm_api_data_types::osm_node*> & p_nodes,
+                       const std::vector<osm_api_data_types::osm_way*> & p_ways)
+  {
+    for(std::vector<osm_api_data_types::osm_node*>::const_iterator l_iter = p_nodes.begin();
+        l_iter != p_nodes.end();
+        ++l_iter)
+      {
+        m_nodes_coordinates.insert(std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<float,float> >::value_type((*l_iter)->get_id(),std::pair<float,float>((*l_iter)->get_lat(),(*l_iter)->get_lon())));
+      }
+    for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_iter = p_ways.begin();
+        l_iter != p_ways.end();
+        ++l_iter)
+      {
+        way * l_way = new way((*l_iter)->get_id(),(*l_iter)->get_user(),(*l_iter)->get_user_id(),(*l_iter)->get_version(),false);
+        l_way->set_node_refs((*l_iter)->get_node_refs());
+        if(!m_ways.insert(std::map<osm_api_data_types::osm_object::t_osm_id,way*>::value_type(l_way->get_id(),l_way)).second)
+          {
+            delete l_way;
+            continue;
+          }
+        const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_node_refs = l_way->get_node_refs();
+        for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter_ref = l_node_refs.begin();
+            l_iter_ref != l_node_refs.end();
+            ++l_iter_ref)
+          {
+            std::vector<const way*> & l_node_ways = m_node_ways[*l_iter_ref];
+            // Closed ways reference their first node twice
+            if(l_node_ways.empty() || l_node_ways.back() != l_way)
+              {
+                l_node_ways.push_back(l_way);
+              }
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool local_map::get_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                  float & p_lat,
+                                  float & p_lon)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::pair<float,float> >::const_iterator l_iter = m_nodes_coordinates.find(p_id);
+    if(l_iter == m_nodes_coordinates.end())
+      {
+        return false;
+      }
+    p_lat = l_iter->second.first;
+    p_lon = l_iter->second.second;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<const way*> * local_map::get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id)const
+  {
+    if(m_nodes_coordinates.find(p_id) == m_nodes_coordinates.end())
+      {
+        return NULL;
+      }
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<const way*> >::const_iterator l_iter = m_node_ways.find(p_id);
+    return l_iter != m_node_ways.end() ? &(l_iter->second) : &m_no_way;
+  }
+
+  const std::vector<const way*> local_map::m_no_way;
+}
+//EOF
@@ -0,0 +1,165 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "metrics.h"
+#include "quicky_exception.h"
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Histogram families exported : metric name, label name and label value
+  static const char * const g_histogram_names[metrics::NB_HISTOGRAMS][3] =
+    {
+      {"node_alignment_api_call_duration_seconds","call","get_node"},
+      {"node_alignment_api_call_duration_seconds","call","get_node_version"},
+      {"node_alignment_api_call_duration_seconds","call","get_node_ways"},
+      {"node_alignment_api_call_duration_seconds","call","get_nodes"},
+      {"node_alignment_api_call_duration_seconds","call","get_way"},
+      {"node_alignment_api_call_duration_seconds","call","get_way_version"},
+      {"node_alignment_api_call_duration_seconds","call","get_way_full"},
+      {"node_alignment_api_call_duration_seconds","call","get_map"},
+      {"node_alignment_check_way_stage_duration_seconds","stage","move_detection"},
+      {"node_alignment_check_way_stage_duration_seconds","stage","rebuild"},
+      {"node_alignment_check_way_stage_duration_seconds","stage","regression"},
+      {"node_alignment_check_way_stage_duration_seconds","stage","reporting"},
+      {"node_alignment_changeset_close_duration_seconds","",""}
+    };
+
+  static const char * const g_counter_names[metrics::NB_COUNTERS] =
+    {
+      "node_alignment_checked_ways_total",
+      "node_alignment_alerts_total",
+      "node_alignment_closed_changesets_total",
+      "node_alignment_prefiltered_nodes_total",
+      "node_alignment_skipped_changesets_total",
+      "node_alignment_history_store_hits_total"
+    };
+
+  static const char * const g_gauge_names[metrics::NB_GAUGES] =
+    {
+      "node_alignment_open_changesets",
+      "node_alignment_held_nodes",
+      "node_alignment_held_bytes"
+    };
+
+  //----------------------------------------------------------------------------
+  uint64_t metrics::get_time_us(void)
+  {
+    struct timespec l_time;
+    clock_gettime(CLOCK_MONOTONIC,&l_time);
+    return ((uint64_t)l_time.tv_sec) * 1000000 + l_time.tv_nsec / 1000;
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::record(const t_histogram & p_histogram,
+                       const uint64_t & p_duration)
+  {
+    uint32_t l_bucket = 0;
+    while(l_bucket < m_nb_buckets && (((uint64_t)1) << l_bucket) < p_duration)
+      {
+        ++l_bucket;
+      }
+    ++m_buckets[p_histogram][l_bucket];
+    m_sums[p_histogram] += p_duration;
+    ++m_counts[p_histogram];
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::write_prometheus(const std::string & p_file_name,
+                                 const std::string & p_analyzer_name)
+  {
+    std::string l_tmp_file_name = p_file_name + ".tmp";
+    std::ofstream l_file(l_tmp_file_name.c_str());
+    if(!l_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to create metrics file \"" << l_tmp_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    std::string l_analyzer_label = "analyzer=\"" + p_analyzer_name + "\"";
+
+    std::string l_previous_name;
+    for(uint32_t l_histogram = 0 ; l_histogram < NB_HISTOGRAMS ; ++l_histogram)
+      {
+        const std::string l_name = g_histogram_names[l_histogram][0];
+        if(l_name != l_previous_name)
+          {
+            l_file << "# TYPE " << l_name << " histogram\n" ;
+            l_previous_name = l_name;
+          }
+        std::string l_labels = l_analyzer_label;
+        if(*g_histogram_names[l_histogram][1])
+          {
+            l_labels += std::string(",") + g_histogram_names[l_histogram][1] + "=\"" + g_histogram_names[l_histogram][2] + "\"";
+          }
+        uint64_t l_cumulated = 0;
+        for(uint32_t l_bucket = 0 ; l_bucket < m_nb_buckets ; ++l_bucket)
+          {
+            l_cumulated += m_buckets[l_histogram][l_bucket];
+            l_file << l_name << "_bucket{" << l_labels << ",le=\"" << ((double)(((uint64_t)1) << l_bucket)) / 1000000.0 << "\"} " << l_cumulated << "\n" ;
+          }
+        l_file << l_name << "_bucket{" << l_labels << ",le=\"+Inf\"} " << m_counts[l_histogram] << "\n" ;
+        l_file << l_name << "_sum{" << l_labels << "} " << ((double)m_sums[l_histogram]) / 1000000.0 << "\n" ;
+        l_file << l_name << "_count{" << l_labels << "} " << m_counts[l_histogram] << "\n" ;
+      }
+    for(uint32_t l_counter = 0 ; l_counter < NB_COUNTERS ; ++l_counter)
+      {
+        l_file << "# TYPE " << g_counter_names[l_counter] << " counter\n" ;
+        l_file << g_counter_names[l_counter] << "{" << l_analyzer_label << "} " << m_counters[l_counter] << "\n" ;
+      }
+    for(uint32_t l_gauge = 0 ; l_gauge < NB_GAUGES ; ++l_gauge)
+      {
+        l_file << "# TYPE " << g_gauge_names[l_gauge] << " gauge\n" ;
+        l_file << g_gauge_names[l_gauge] << "{" << l_analyzer_label << "} " << m_gauges[l_gauge] << "\n" ;
+      }
+    l_file.close();
+    if(rename(l_tmp_file_name.c_str(),p_file_name.c_str()))
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to rename metrics file \"" << l_tmp_file_name << "\" to \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void metrics::write_summary(std::ostream & p_stream)
+  {
+    p_stream << "Metrics :" ;
+    for(uint32_t l_histogram = 0 ; l_histogram < NB_HISTOGRAMS ; ++l_histogram)
+      {
+        if(m_counts[l_histogram])
+          {
+            p_stream << " " << (*g_histogram_names[l_histogram][2] ? g_histogram_names[l_histogram][2] : "changeset_close") << "=" << m_counts[l_histogram] << "/" << m_sums[l_histogram] / m_counts[l_histogram] << "us" ;
+          }
+      }
+    p_stream << " checked_ways=" << m_counters[CHECKED_WAYS] << " alerts=" << m_counters[ALERTS] << " closed_changesets=" << m_counters[CLOSED_CHANGESETS] << " prefiltered_nodes=" << m_counters[PREFILTERED_NODES] << " skipped_changesets=" << m_counters[SKIPPED_CHANGESETS] << " history_store_hits=" << m_counters[HISTORY_STORE_HITS] ;
+    p_stream << " open_changesets=" << m_gauges[OPEN_CHANGESETS] << " held_nodes=" << m_gauges[HELD_NODES] << " held_bytes=" << m_gauges[HELD_BYTES] ;
+  }
+
+  bool metrics::m_enabled = false;
+  uint64_t metrics::m_buckets[metrics::NB_HISTOGRAMS][metrics::m_nb_buckets + 1];
+  uint64_t metrics::m_sums[metrics::NB_HISTOGRAMS];
+  uint64_t metrics::m_counts[metrics::NB_HISTOGRAMS];
+  uint64_t metrics::m_counters[metrics::NB_COUNTERS];
+  uint64_t metrics::m_gauges[metrics::NB_GAUGES];
+}
+//EOF
@@ -0,0 +1,61 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "module_log.h"
+#include "quicky_exception.h"
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  bool module_log::flush(std::string & p_text)
+  {
+    if(m_deferred.empty())
+      {
+        return false;
+      }
+    p_text = "";
+    for(std::vector<std::string>::const_iterator l_iter = m_deferred.begin();
+        l_iter != m_deferred.end();
+        ++l_iter)
+      {
+        if(l_iter != m_deferred.begin())
+          {
+            p_text += "\n";
+          }
+        p_text += *l_iter;
+      }
+    m_deferred.clear();
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  module_log::t_level module_log::get_level(const std::string & p_name)
+  {
+    if(p_name == "error") return ERROR_LEVEL;
+    if(p_name == "warning") return WARNING_LEVEL;
+    if(p_name == "info") return INFO_LEVEL;
+    if(p_name == "debug") return DEBUG_LEVEL;
+    std::stringstream l_stream;
+    l_stream << "ERROR : unsupported log level \"" << p_name << "\". Supported values are \"error\", \"warning\", \"info\" and \"debug\"" ;
+    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+  }
+}
+//EOF
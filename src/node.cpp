@@ -23,9 +23,64 @@
 
 namespace osm_diff_analyzer_node_alignment
 {
-  void node::attach_to(const way & p_way)
+  //----------------------------------------------------------------------------
+  void node::attach_to(way & p_way)
   {
-    m_ways.insert(std::map<osm_api_data_types::osm_object::t_osm_id,const way*>::value_type(p_way.get_id(),&p_way));
+    m_ways.push_back(&p_way);
+    p_way.add_node(*this);
+  }
+
+  //----------------------------------------------------------------------------
+  void node::detach_from(const way & p_way)
+  {
+    std::vector<way*>::iterator l_iter = m_ways.begin();
+    while(l_iter != m_ways.end())
+      {
+        if(*l_iter == &p_way)
+          {
+            l_iter = m_ways.erase(l_iter);
+          }
+        else
+          {
+            ++l_iter;
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node::set_coordinates(const float & p_lat,const float & p_lon)
+  {
+    for(std::vector<way*>::iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        (*l_iter)->move_node(*this,p_lat,p_lon);
+      }
+    m_lat = p_lat;
+    m_lon = p_lon;
+  }
+
+  //----------------------------------------------------------------------------
+  void node::set_baseline(const float & p_lat,const float & p_lon)
+  {
+    for(std::vector<way*>::iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        (*l_iter)->set_node_baseline(*this,p_lat,p_lon);
+      }
+    m_baseline_lat = p_lat;
+    m_baseline_lon = p_lon;
+    m_has_baseline = true;
+  }
+
+  //----------------------------------------------------------------------------
+  void node::reset_baseline(void)
+  {
+    if(!m_has_baseline) return;
+    // Without baseline ways consider current coordinates as previous ones
+    set_baseline(m_lat,m_lon);
+    m_has_baseline = false;
   }
 
 }
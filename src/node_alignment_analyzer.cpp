@@ -19,12 +19,16 @@
 */
 #include "node_alignment_analyzer.h"
 #include "node_alignment_common_api.h"
+#include "snapshot_diff.h"
 #include "quicky_exception.h"
 #include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <cstring>
 #include <cassert>
+#include <algorithm>
+#include <functional>
+#include <unistd.h>
 
 namespace osm_diff_analyzer_node_alignment
 {
@@ -33,13 +37,45 @@ namespace osm_diff_analyzer_node_alignment
                                                    node_alignment_common_api & p_api):
     osm_diff_analyzer_cpp_if::cpp_analyzer_base("node_alignment_analyser",p_conf->get_name(),""),
     m_api(p_api),
-    m_report()
+    m_report_created(false),
+    m_html_report(true),
+    m_report_max_size(0),
+    m_report_max_alerts(0),
+    m_report_max_age(0),
+    m_report_nb_alerts(0),
+    m_report_creation_time(0),
+    m_report_number_loaded(false),
+    m_report_number(0),
+    m_metrics(false),
+    m_metrics_file_name(p_conf->get_name()+"_node_alignment_metrics.prom"),
+    m_metrics_interval(60),
+    m_metrics_export_time(0),
+    m_memory_top_changesets(5),
+    m_changesets_footprint(0),
+    m_diff_number(0),
+    m_nb_created_changesets(0),
+    m_snapshot_threads(1)
   {
      // Register module to be able to use User Interface
     m_api.ui_register_module(*this,get_name());
 
    const std::map<std::string,std::string> & l_conf_parameters = p_conf->get_parameters();
 
+    std::map<std::string,std::string>::const_iterator l_log_iter = l_conf_parameters.find("log_level");
+    if(l_log_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"log_level\" : info";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_log.set_level(module_log::get_level(l_log_iter->second));
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_log_iter->second << " for parameter \"log_level\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
     std::map<std::string,std::string>::const_iterator l_iter = l_conf_parameters.find("min_way_node_nb");
     if(l_iter == l_conf_parameters.end())
     {
@@ -92,155 +128,872 @@ namespace osm_diff_analyzer_node_alignment
 	changeset::set_min_alignment_modification_rate(l_min_alignment_modification_rate);
       }
 
-    changeset::set_api(m_api);
+    l_iter = l_conf_parameters.find("checked_way_cache_size");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"checked_way_cache_size\" : " << changeset::get_checked_way_cache().get_capacity();
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	uint32_t l_checked_way_cache_size = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_checked_way_cache_size << " for parameter \"checked_way_cache_size\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+	changeset::get_checked_way_cache().set_capacity(l_checked_way_cache_size);
+      }
+
+    l_iter = l_conf_parameters.find("known_node_cache_size");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"known_node_cache_size\" : " << changeset::get_known_node_cache().get_capacity();
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	uint32_t l_known_node_cache_size = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_known_node_cache_size << " for parameter \"known_node_cache_size\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+	changeset::get_known_node_cache().set_capacity(l_known_node_cache_size);
+      }
+
+    l_iter = l_conf_parameters.find("get_map_max_area");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"get_map_max_area\" : " << changeset::get_get_map_max_area();
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	float l_get_map_max_area = strtof(l_iter->second.c_str(),NULL);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_get_map_max_area << " for parameter \"get_map_max_area\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+	changeset::set_get_map_max_area(l_get_map_max_area);
+      }
+
+    l_iter = l_conf_parameters.find("get_map_min_nodes");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"get_map_min_nodes\" : " << changeset::get_get_map_min_nodes();
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	uint32_t l_get_map_min_nodes = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_get_map_min_nodes << " for parameter \"get_map_min_nodes\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+	changeset::set_get_map_min_nodes(l_get_map_min_nodes);
+      }
+
+    uint32_t l_report_queue_size = 1024;
+    l_iter = l_conf_parameters.find("report_queue_size");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_queue_size\" : " << l_report_queue_size;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	l_report_queue_size = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_report_queue_size << " for parameter \"report_queue_size\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    bool l_drop_when_full = false;
+    l_iter = l_conf_parameters.find("report_queue_policy");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_queue_policy\" : block";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second != "block" && l_iter->second != "drop")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"report_queue_policy\". Supported values are \"block\" and \"drop\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	l_drop_when_full = l_iter->second == "drop";
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"report_queue_policy\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    uint32_t l_report_flush_interval = 16;
+    l_iter = l_conf_parameters.find("report_flush_interval");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_flush_interval\" : " << l_report_flush_interval;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	l_report_flush_interval = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_report_flush_interval << " for parameter \"report_flush_interval\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+    bool l_lazy_artifacts = false;
+    l_iter = l_conf_parameters.find("artifact_mode");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"artifact_mode\" : files";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second == "files")
+	  {
+	    m_report_writer.set_artifact_mode(report_writer::FILES);
+	  }
+	else if(l_iter->second == "archive")
+	  {
+	    m_report_writer.set_artifact_mode(report_writer::ARCHIVE);
+	  }
+	else if(l_iter->second == "lazy")
+	  {
+	    m_report_writer.set_artifact_mode(report_writer::LAZY);
+	    l_lazy_artifacts = true;
+	  }
+	else
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"artifact_mode\". Supported values are \"files\", \"archive\" and \"lazy\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"artifact_mode\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    bool l_svg_compact = true;
+    l_iter = l_conf_parameters.find("svg_compact");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"svg_compact\" : yes";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second != "yes" && l_iter->second != "no")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"svg_compact\". Supported values are \"yes\" and \"no\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	l_svg_compact = l_iter->second == "yes";
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"svg_compact\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    bool l_svg_decimation = false;
+    l_iter = l_conf_parameters.find("svg_decimation");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"svg_decimation\" : no";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second != "yes" && l_iter->second != "no")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"svg_decimation\". Supported values are \"yes\" and \"no\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	l_svg_decimation = l_iter->second == "yes";
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"svg_decimation\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    m_report_writer.set_svg_options(l_svg_compact,l_svg_decimation);
+
+    l_iter = l_conf_parameters.find("report_max_size");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_max_size\" : " << m_report_max_size << " (no limit)";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_report_max_size = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_report_max_size << " bytes for parameter \"report_max_size\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("report_max_alerts");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_max_alerts\" : " << m_report_max_alerts << " (no limit)";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_report_max_alerts = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_report_max_alerts << " alerts for parameter \"report_max_alerts\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("report_max_age");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"report_max_age\" : " << m_report_max_age << " (no limit)";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_report_max_age = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_report_max_age << " seconds for parameter \"report_max_age\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    bool l_binary_alert_stream = false;
+    l_iter = l_conf_parameters.find("alert_stream_format");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"alert_stream_format\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	std::string l_alert_stream_file_name = this->get_name()+"_node_alignment_alerts";
+	if(l_iter->second == "jsonl")
+	  {
+	    m_report_writer.set_alert_stream(l_alert_stream_file_name + ".jsonl",alert_stream::JSONL);
+	  }
+	else if(l_iter->second == "binary")
+	  {
+	    m_report_writer.set_alert_stream(l_alert_stream_file_name + ".bin",alert_stream::BINARY);
+	    l_binary_alert_stream = true;
+	  }
+	else if(l_iter->second != "none")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"alert_stream_format\". Supported values are \"none\", \"jsonl\" and \"binary\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"alert_stream_format\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    // Lazy artifacts are rendered from alert stream so it must be available
+    if(l_lazy_artifacts && !l_binary_alert_stream)
+      {
+	throw quicky_exception::quicky_logic_exception("ERROR : \"artifact_mode\" \"lazy\" requires \"alert_stream_format\" \"binary\"",__LINE__,__FILE__);
+      }
+
+    l_iter = l_conf_parameters.find("html_report");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"html_report\" : yes";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second != "yes" && l_iter->second != "no")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"html_report\". Supported values are \"yes\" and \"no\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	m_html_report = l_iter->second == "yes";
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"html_report\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("metrics");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"metrics\" : no";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second != "yes" && l_iter->second != "no")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"metrics\". Supported values are \"yes\" and \"no\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	m_metrics = l_iter->second == "yes";
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"metrics\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+    metrics::set_enabled(m_metrics);
+
+    tracer::t_mode l_trace_mode = tracer::NONE;
+    l_iter = l_conf_parameters.find("trace");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"trace\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	if(l_iter->second == "all")
+	  {
+	    l_trace_mode = tracer::ALL;
+	  }
+	else if(l_iter->second == "slow")
+	  {
+	    l_trace_mode = tracer::SLOW;
+	  }
+	else if(l_iter->second != "none")
+	  {
+	    std::stringstream l_stream;
+	    l_stream << "ERROR : unsupported value \"" << l_iter->second << "\" for parameter \"trace\". Supported values are \"none\", \"all\" and \"slow\"" ;
+	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+	  }
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"trace\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    std::string l_trace_file_name = this->get_name()+"_node_alignment_trace.json";
+    l_iter = l_conf_parameters.find("trace_file");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"trace_file\" : " << l_trace_file_name ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	l_trace_file_name = l_iter->second;
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_trace_file_name << " for parameter \"trace_file\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    uint32_t l_trace_slow_threshold = 1000;
+    l_iter = l_conf_parameters.find("trace_slow_threshold");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"trace_slow_threshold\" : " << l_trace_slow_threshold << "ms" ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	l_trace_slow_threshold = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_trace_slow_threshold << "ms for parameter \"trace_slow_threshold\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    uint32_t l_trace_buffer_size = 65536;
+    l_iter = l_conf_parameters.find("trace_buffer_size");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"trace_buffer_size\" : " << l_trace_buffer_size ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	l_trace_buffer_size = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_trace_buffer_size << " for parameter \"trace_buffer_size\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+    tracer::configure(l_trace_mode,l_trace_file_name,l_trace_slow_threshold,l_trace_buffer_size);
 
+    l_iter = l_conf_parameters.find("metrics_file");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"metrics_file\" : " << m_metrics_file_name ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_metrics_file_name = l_iter->second;
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_metrics_file_name << " for parameter \"metrics_file\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("metrics_interval");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"metrics_interval\" : " << m_metrics_interval << "s" ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_metrics_interval = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_metrics_interval << "s for parameter \"metrics_interval\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("memory_top_changesets");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"memory_top_changesets\" : " << m_memory_top_changesets ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_memory_top_changesets = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_memory_top_changesets << " for parameter \"memory_top_changesets\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("snapshot_old_file");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"snapshot_old_file\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_snapshot_old_file_name = l_iter->second;
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_snapshot_old_file_name << " for parameter \"snapshot_old_file\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("snapshot_new_file");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"snapshot_new_file\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_snapshot_new_file_name = l_iter->second;
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_snapshot_new_file_name << " for parameter \"snapshot_new_file\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    if((m_snapshot_old_file_name == "") != (m_snapshot_new_file_name == ""))
+      {
+	throw quicky_exception::quicky_logic_exception("ERROR : \"snapshot_old_file\" and \"snapshot_new_file\" must be defined together",__LINE__,__FILE__);
+      }
+
+    long l_nb_processors = sysconf(_SC_NPROCESSORS_ONLN);
+    m_snapshot_threads = l_nb_processors > 0 ? l_nb_processors : 1;
+    l_iter = l_conf_parameters.find("snapshot_threads");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"snapshot_threads\" : " << m_snapshot_threads ;
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_snapshot_threads = strtoul(l_iter->second.c_str(),NULL,10);
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << m_snapshot_threads << " for parameter \"snapshot_threads\"" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("node_location_store");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"node_location_store\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_node_location_store.reset(new node_location_store(l_iter->second));
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"node_location_store\" (capacity " << m_node_location_store->get_capacity() << " nodes)" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    l_iter = l_conf_parameters.find("node_history_store");
+    if(l_iter == l_conf_parameters.end())
+    {
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using default value for parameter \"node_history_store\" : none";
+	m_api.ui_append_log_text(*this,l_stream.str());	
+    }
+    else
+      {
+	m_node_history_store.reset(new node_history_store(l_iter->second));
+	std::stringstream l_stream;
+	l_stream << this->get_name() << " : Using value " << l_iter->second << " for parameter \"node_history_store\" (" << m_node_history_store->get_nb_records() << " node versions in " << m_node_history_store->get_nb_runs() << " runs)" ;
+	m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    // A null queue size means that reports are written synchronously
+    m_report_writer.start(l_report_queue_size,l_drop_when_full,l_report_flush_interval);
+
+    changeset::set_api(m_api);
+    changeset::set_node_location_store(m_node_location_store.get());
+    m_api.set_node_history_store(m_node_history_store.get());
   }
 
   //------------------------------------------------------------------------------
-  void node_alignment_analyzer::create_report(void)
+  uint32_t node_alignment_analyzer::get_next_report_number(void)
   {
     std::string l_report_file_name = this->get_name()+"_node_alignment_report";
-    std::string l_complete_report_file_name = l_report_file_name + ".html";
-    std::ifstream l_test_file;
-    uint32_t l_number = 0;
-    bool l_continu = true;
-    while(l_continu)
-      {
-        l_test_file.open(l_complete_report_file_name.c_str());
-        l_continu = l_test_file.is_open();
-        if(l_continu)
+    std::string l_sequence_file_name = l_report_file_name + ".seq";
+    if(!m_report_number_loaded)
+      {
+        std::ifstream l_sequence_file(l_sequence_file_name.c_str());
+        if(l_sequence_file.is_open())
+          {
+            l_sequence_file >> m_report_number;
+            l_sequence_file.close();
+          }
+        else
           {
-            ++l_number;
-            std::stringstream l_number_str;
-            l_number_str << l_number;
-            l_complete_report_file_name = l_report_file_name + "_" + l_number_str.str() + ".html";
-            l_test_file.close();
+            // No sequence file yet : look for reports generated before its
+            // introduction so that they are not overwritten. This is only
+            // done once as the sequence file is then created
+            std::string l_complete_report_file_name = l_report_file_name + ".html";
+            std::ifstream l_test_file;
+            bool l_continu = true;
+            while(l_continu)
+              {
+                l_test_file.open(l_complete_report_file_name.c_str());
+                l_continu = l_test_file.is_open();
+                if(l_continu)
+                  {
+                    ++m_report_number;
+                    std::stringstream l_number_str;
+                    l_number_str << m_report_number;
+                    l_complete_report_file_name = l_report_file_name + "_" + l_number_str.str() + ".html";
+                    l_test_file.close();
+                  }
+              }
           }
+        m_report_number_loaded = true;
       }
+    uint32_t l_number = m_report_number;
+    ++m_report_number;
 
-    
-    // Creating report
-    m_report.open(l_complete_report_file_name.c_str());
-    if(m_report.fail())
+    // Persist next number so that next instances do not need to search for it
+    std::ofstream l_sequence_file(l_sequence_file_name.c_str());
+    if(!l_sequence_file.is_open())
       {
-	std::stringstream l_stream; 
-	l_stream << "ERROR : unabled to open \"" << l_complete_report_file_name << "\"" ;
+	std::stringstream l_stream;
+	l_stream << "ERROR : unable to write report sequence file \"" << l_sequence_file_name << "\"" ;
 	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
       }
-    m_report << "<html>" << std::endl ;
-    m_report << "\t<head><meta http-equiv=\"Content-Type\" content=\"text/html; charset=utf-8\">" << std::endl ;
-    m_report << "\t\t<title>" << this->get_name() << " Node Alignement Report </title>" << std::endl ;
-
-    m_report << "<script src=\"http://openlayers.org/api/OpenLayers.js\"></script>" << std::endl ;
-    m_report << "<script type=\"text/javascript\">" << std::endl ;
-    m_report << "var zoom=15;" << std::endl ;
-    m_report << "var map;" << std::endl ;
-    m_report << std::endl ;
-    m_report << "function init(name,old_file_name,new_file_name,lat,lon){" << std::endl ;
-    m_report << "  var my_map = document.getElementById(name)" << std::endl ;
-    m_report << "    my_map = new OpenLayers.Map (name, {" << std::endl ;
-    m_report << "      controls:[" << std::endl ;
-    m_report << "                new OpenLayers.Control.Navigation()," << std::endl ;
-    m_report << "                new OpenLayers.Control.PanZoomBar()," << std::endl ;
-    m_report << "                new OpenLayers.Control.LayerSwitcher()," << std::endl ;
-    m_report << "                new OpenLayers.Control.Attribution()]," << std::endl ;
-    m_report << "                                     maxExtent: new OpenLayers.Bounds(-20037508.34,-20037508.34,20037508.34,20037508.34)," << std::endl ;
-    m_report << "                                     maxResolution: 156543.0399," << std::endl ;
-    m_report << "                                     numZoomLevels: 19," << std::endl ;
-    m_report << "                                     units: 'm'," << std::endl ;
-    m_report << "                                     projection: new OpenLayers.Projection(\"EPSG:900913\")," << std::endl ;
-    m_report << "                                     displayProjection: new OpenLayers.Projection(\"EPSG:4326\")" << std::endl ;
-    m_report << "                                     } );" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  my_map.addLayer(new OpenLayers.Layer.OSM());" << std::endl ;
-    //   m_report << "  my_map.size = new OpenLayers.Size(300,200);" << std::endl ;
-    m_report << "  var lonLat = new OpenLayers.LonLat(lon, lat).transform(new OpenLayers.Projection(\"EPSG:4326\"), new OpenLayers.Projection(\"EPSG:900913\"));" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  my_map.setCenter (lonLat, zoom);" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  //Initialise the vector layer using OpenLayers.Format.OSM" << std::endl ;
-    m_report << "  var layer = new OpenLayers.Layer.Vector(old_file_name, {" << std::endl ;
-    m_report << "    strategies: [new OpenLayers.Strategy.Fixed()]," << std::endl ;
-    m_report << "                                              protocol: new OpenLayers.Protocol.HTTP({" << std::endl ;
-    m_report << "                                                url: old_file_name,   //<-- relative or absolute URL to your .osm file" << std::endl ;
-    m_report << "                                                    format: new OpenLayers.Format.GPX()" << std::endl ;
-    m_report << "                                                    })," << std::endl ;
-    m_report << "                                              style: {strokeColor: \"blue\", strokeWidth: 6, strokeOpacity: 1}," << std::endl ;
-    m_report << "                                              projection: new OpenLayers.Projection(\"EPSG:4326\")" << std::endl ;
-    m_report << "                                              });" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  my_map.addLayers([layer]);" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  //Initialise the vector layer using OpenLayers.Format.OSM" << std::endl ;
-    m_report << "  var layer2 = new OpenLayers.Layer.Vector(new_file_name, {" << std::endl ;
-    m_report << "    strategies: [new OpenLayers.Strategy.Fixed()]," << std::endl ;
-    m_report << "                                               protocol: new OpenLayers.Protocol.HTTP({" << std::endl ;
-    m_report << "                                                 url: new_file_name,   //<-- relative or absolute URL to your .osm file" << std::endl ;
-    m_report << "                                                     format: new OpenLayers.Format.GPX()" << std::endl ;
-    m_report << "                                                     })," << std::endl ;
-    m_report << "                                               style: {strokeColor: \"red\", strokeWidth: 6, strokeOpacity: 1}," << std::endl ;
-    m_report << "                                               projection: new OpenLayers.Projection(\"EPSG:4326\")" << std::endl ;
-    m_report << "                                               });" << std::endl ;
-    m_report << std::endl ;
-    m_report << "  my_map.addLayers([layer2]);" << std::endl ;
-    m_report << std::endl ;
-    m_report << "}" << std::endl ;
-    m_report << "</script>" << std::endl ;
-
-    m_report << "\t</head>" << std::endl ;
-    m_report << "\t<body><H1>" << this->get_name() << " Node alignement Report</H1>" << std::endl ;
+    l_sequence_file << m_report_number << std::endl ;
+    l_sequence_file.close();
+    return l_number;
+  }
+
+  //------------------------------------------------------------------------------
+  void node_alignment_analyzer::create_report(void)
+  {
+    std::string l_complete_report_file_name = this->get_name()+"_node_alignment_report";
+    uint32_t l_number = get_next_report_number();
+    if(l_number)
+      {
+        std::stringstream l_number_str;
+        l_number_str << l_number;
+        l_complete_report_file_name += "_" + l_number_str.str();
+      }
+    l_complete_report_file_name += ".html";
+    
+    // Creating report
+    m_report_writer.open_report(l_complete_report_file_name,this->get_name());
+    m_report_created = true;
+    m_report_nb_alerts = 0;
+    m_report_creation_time = time(NULL);
 
     m_api.ui_declare_html_report(*this,l_complete_report_file_name);
   }
 
+  //------------------------------------------------------------------------------
+  bool node_alignment_analyzer::is_report_rotation_needed(void)
+  {
+    if(m_report_max_alerts && m_report_nb_alerts >= m_report_max_alerts)
+      {
+        return true;
+      }
+    if(m_report_max_age && (uint32_t)(time(NULL) - m_report_creation_time) >= m_report_max_age)
+      {
+        return true;
+      }
+    if(m_report_max_size && m_report_writer.get_report_size() >= m_report_max_size)
+      {
+        return true;
+      }
+    return false;
+  }
+
   //------------------------------------------------------------------------------
   node_alignment_analyzer::~node_alignment_analyzer(void)
   {
     analyze_current_changesets();
 
-    for(std::map<osm_api_data_types::osm_object::t_osm_id,changeset *>::iterator l_iter = m_changesets.begin();
+    for(osm_id_map<changeset *>::iterator l_iter = m_changesets.begin();
         l_iter != m_changesets.end();
         ++l_iter)
       {
         delete l_iter->second;
       }
 
-    m_report << "</body>" << std::endl ;
-    m_report << "</html>" << std::endl ;
+    changeset::set_node_location_store(NULL);
+    m_node_location_store.reset();
+
+    // Versions seen since last automatic flush are kept for next run
+    m_api.set_node_history_store(NULL);
+    if(m_node_history_store.get() != NULL)
+      {
+        m_node_history_store->flush();
+        m_node_history_store.reset();
+      }
+
+    if(m_report_created)
+      {
+        m_report_writer.close_report();
+      }
+    m_report_writer.stop();
 
-    m_report.close();
+    if(m_metrics)
+      {
+        update_metrics();
+        metrics::write_prometheus(m_metrics_file_name,this->get_name());
+      }
+    tracer::close();
   }
 
   //------------------------------------------------------------------------------
-  void node_alignment_analyzer::init(const osm_diff_analyzer_if::osm_diff_state * p_diff_state)
+  void node_alignment_analyzer::run_snapshot_diff(const std::string & p_old_file_name,
+                                                  const std::string & p_new_file_name,
+                                                  const uint32_t & p_nb_threads)
+  {
+    time_t l_start_time = time(NULL);
+    snapshot_diff l_snapshot_diff(m_api,*this,p_nb_threads);
+    l_snapshot_diff.run(p_old_file_name,p_new_file_name);
+    if(m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        std::stringstream l_stream;
+        l_stream << "Snapshot diff : " << l_snapshot_diff.get_nb_old_nodes() << " old nodes, " << l_snapshot_diff.get_nb_new_nodes() << " new nodes, " << l_snapshot_diff.get_nb_ways() << " ways, " << l_snapshot_diff.get_nb_candidate_ways() << " scored, " << l_snapshot_diff.get_nb_alerts() << " alerts in " << (time(NULL) - l_start_time) << "s" ;
+        m_api.ui_append_log_text(*this,l_stream.str());
+      }
+  }
+
+  //------------------------------------------------------------------------------
+  void node_alignment_analyzer::update_metrics(void)
   {
+    uint64_t l_nb_held_nodes = 0;
+    for(osm_id_map<changeset *>::const_iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        l_nb_held_nodes += l_iter->second->get_nb_nodes();
+      }
+    metrics::set(metrics::OPEN_CHANGESETS,m_changesets.size());
+    metrics::set(metrics::HELD_NODES,l_nb_held_nodes);
+    metrics::set(metrics::HELD_BYTES,m_changesets_footprint);
+  }
+
+  //------------------------------------------------------------------------------
+  void node_alignment_analyzer::log_memory_footprint(void)
+  {
+    std::vector<std::pair<uint64_t,osm_api_data_types::osm_object::t_osm_id> > l_footprints;
+    l_footprints.reserve(m_changesets.size());
+    m_changesets_footprint = 0;
+    for(osm_id_map<changeset *>::const_iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        uint64_t l_footprint = l_iter->second->get_memory_footprint();
+        m_changesets_footprint += l_footprint;
+        l_footprints.push_back(std::pair<uint64_t,osm_api_data_types::osm_object::t_osm_id>(l_footprint,l_iter->first));
+      }
+    if(!m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        return;
+      }
+    uint32_t l_nb_top = m_memory_top_changesets < l_footprints.size() ? m_memory_top_changesets : l_footprints.size();
+    std::partial_sort(l_footprints.begin(),l_footprints.begin() + l_nb_top,l_footprints.end(),std::greater<std::pair<uint64_t,osm_api_data_types::osm_object::t_osm_id> >());
 
     std::stringstream l_stream;
-    l_stream << "Starting analyze of diff " << p_diff_state->get_sequence_number() ;
+    l_stream << "Memory : " << m_changesets.size() << " open changesets using " << m_changesets_footprint << " bytes" ;
+    if(l_nb_top)
+      {
+        l_stream << ", largest :" ;
+      }
+    for(uint32_t l_index = 0 ; l_index < l_nb_top ; ++l_index)
+      {
+        const changeset & l_changeset = *(m_changesets.find(l_footprints[l_index].second)->second);
+        l_stream << " " << l_footprints[l_index].second << " (" << l_changeset.get_user_name() << ", " << l_changeset.get_nb_nodes() << " nodes) " << l_footprints[l_index].first << " bytes" << (l_index + 1 < l_nb_top ? "," : "") ;
+      }
     m_api.ui_append_log_text(*this,l_stream.str());
+  }
+
+  //----------------------------------------------------------------------------
+  void node_alignment_analyzer::report_alert(const alert_record * p_record)
+  {
+    // Headless instances only feed the alert stream
+    if(!m_html_report)
+      {
+        m_report_writer.report_alert(p_record);
+        return;
+      }
+    if(m_report_created && is_report_rotation_needed())
+      {
+        // Rotated report is closed properly before starting the new one
+        m_report_writer.close_report();
+        m_report_created = false;
+      }
+    if(!m_report_created)
+      {
+        create_report();
+      }
+    ++m_report_nb_alerts;
+    m_report_writer.report_alert(p_record);
+  }
+
+  //------------------------------------------------------------------------------
+  void node_alignment_analyzer::init(const osm_diff_analyzer_if::osm_diff_state * p_diff_state)
+  {
+    // Messages of previous diff ingestion are sent in a single call
+    if(m_nb_created_changesets && m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        std::stringstream l_created_stream;
+        l_created_stream << m_nb_created_changesets << " changesets created by previous diff" ;
+        m_log.defer(module_log::INFO_LEVEL,l_created_stream.str());
+      }
+    m_nb_created_changesets = 0;
+    std::string l_deferred_text;
+    if(m_log.flush(l_deferred_text))
+      {
+        m_api.ui_append_log_text(*this,l_deferred_text);
+      }
+
+    if(m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        std::stringstream l_stream;
+        l_stream << "Starting analyze of diff " << p_diff_state->get_sequence_number() ;
+        m_api.ui_append_log_text(*this,l_stream.str());
+      }
+
+    // Extracts are compared when the first diff starts rather than at
+    // module load so that the host is not blocked while loading modules
+    if(m_snapshot_old_file_name != "")
+      {
+        std::string l_old_file_name = m_snapshot_old_file_name;
+        std::string l_new_file_name = m_snapshot_new_file_name;
+        m_snapshot_old_file_name = "";
+        m_snapshot_new_file_name = "";
+        run_snapshot_diff(l_old_file_name,l_new_file_name,m_snapshot_threads);
+      }
+
     analyze_current_changesets();
+    tracer::flush();
+    if(m_node_location_store.get() != NULL)
+      {
+        m_node_location_store->sync();
+      }
+    if(m_memory_top_changesets)
+      {
+        log_memory_footprint();
+      }
+
+    if(m_report_created || !m_html_report)
+      {
+        m_report_writer.flush();
+      }
+    if((m_report_created || !m_html_report) && m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        uint64_t l_nb_alerts;
+        uint64_t l_nb_dropped;
+        uint64_t l_nb_blocked;
+        uint32_t l_max_queue_depth;
+        m_report_writer.get_statistics(l_nb_alerts,l_nb_dropped,l_nb_blocked,l_max_queue_depth);
+        std::stringstream l_stat_stream;
+        l_stat_stream << "Report writer : " << l_nb_alerts << " alerts written, " << l_nb_dropped << " dropped, " << l_nb_blocked << " blocking submissions, max queue depth " << l_max_queue_depth ;
+        m_api.ui_append_log_text(*this,l_stat_stream.str());
+      }
+
+    const checked_way_cache & l_checked_way_cache = changeset::get_checked_way_cache();
+    if(l_checked_way_cache.get_capacity() && m_log.is_enabled(module_log::INFO_LEVEL))
+      {
+        std::stringstream l_cache_stream;
+        l_cache_stream << "Checked way cache : " << l_checked_way_cache.get_nb_hits() << " hits, " << l_checked_way_cache.get_nb_misses() << " misses, " << l_checked_way_cache.get_nb_filtered() << " filtered" ;
+        m_api.ui_append_log_text(*this,l_cache_stream.str());
+      }
+
+    if(m_metrics)
+      {
+        update_metrics();
+        if(m_log.is_enabled(module_log::INFO_LEVEL))
+          {
+            std::stringstream l_metrics_stream;
+            metrics::write_summary(l_metrics_stream);
+            m_api.ui_append_log_text(*this,l_metrics_stream.str());
+          }
+        time_t l_now = time(NULL);
+        if((uint32_t)(l_now - m_metrics_export_time) >= m_metrics_interval)
+          {
+            metrics::write_prometheus(m_metrics_file_name,this->get_name());
+            m_metrics_export_time = l_now;
+          }
+      }
   }
     
   //------------------------------------------------------------------------------
   void node_alignment_analyzer::analyze_current_changesets(void)
   {
+    tracer::scoped_span l_span("analyze_current_changesets");
     std::vector<osm_api_data_types::osm_object::t_osm_id> l_closed_changesets;
     // List closed changesets : IE changesets not mentionned in previous minute diffs
-    for(std::map<osm_api_data_types::osm_object::t_osm_id,changeset *>::const_iterator l_iter = m_changesets.begin();
+    for(osm_id_map<changeset *>::const_iterator l_iter = m_changesets.begin();
         l_iter != m_changesets.end();
         ++l_iter)
       {
-        if(m_encountered_changesets.find(l_iter->first)==m_encountered_changesets.end())
+        if(l_iter->second->get_last_seen_diff() != m_diff_number)
           {
             l_closed_changesets.push_back(l_iter->first);
           }
       }
+    // Hash table order is not deterministic : close changesets by increasing
+    // id so that alerts are always reported in the same order
+    std::sort(l_closed_changesets.begin(),l_closed_changesets.end());
     // Close changesets
     for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_closed_changesets.begin();
         l_iter != l_closed_changesets.end();
         ++l_iter)
       {
-        std::map<osm_api_data_types::osm_object::t_osm_id,changeset *>::iterator l_changeset_iter = m_changesets.find(*l_iter);
+        osm_id_map<changeset *>::iterator l_changeset_iter = m_changesets.find(*l_iter);
 
 	if(l_changeset_iter == m_changesets.end())
 	  {
@@ -248,22 +1001,39 @@ namespace osm_diff_analyzer_node_alignment
 	    l_stream << "No changeset found with id " << *l_iter ;
 	    throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
 	  }
-        l_changeset_iter->second->search_aligned_ways(m_report);
+        uint64_t l_start = metrics::start();
+        tracer::begin_changeset(*l_iter);
+        // Changesets that cannot trigger any alert do not cost any API request
+        if(l_changeset_iter->second->may_contain_alignment())
+          {
+            l_changeset_iter->second->search_aligned_ways();
+          }
+        else
+          {
+            metrics::increment(metrics::SKIPPED_CHANGESETS);
+          }
+        tracer::end_changeset();
+        metrics::stop(metrics::CHANGESET_CLOSE,l_start);
+        metrics::increment(metrics::CLOSED_CHANGESETS);
         delete l_changeset_iter->second;
         m_changesets.erase(l_changeset_iter);
       }
 
-    //
-    m_encountered_changesets.clear();
+    ++m_diff_number;
   }
 
   //------------------------------------------------------------------------------
   void node_alignment_analyzer::analyze(const std::vector<osm_api_data_types::osm_change*> & p_changes)
   {
+    tracer::scoped_span l_span("analyze");
     for(std::vector<osm_api_data_types::osm_change*>::const_iterator l_iter = p_changes.begin();
         l_iter != p_changes.end();
         ++l_iter)
       {
+        if(m_node_location_store.get() != NULL || m_node_history_store.get() != NULL)
+          {
+            update_node_stores(**l_iter);
+          }
 
         if((*l_iter)->get_type() == osm_api_data_types::osm_change::MODIFICATION)
           {
@@ -272,10 +1042,11 @@ namespace osm_diff_analyzer_node_alignment
             switch(l_element->get_core_type())
               {
               case osm_api_data_types::osm_core_element::NODE :
-                generic_analyze<osm_api_data_types::osm_node>(*l_element);
+                // Core type tag has been checked so no RTTI is needed
+                generic_analyze(static_cast<const osm_api_data_types::osm_node &>(*l_element));
                 break;
               case osm_api_data_types::osm_core_element::WAY :
-                generic_analyze<osm_api_data_types::osm_way>(*l_element);
+                generic_analyze(static_cast<const osm_api_data_types::osm_way &>(*l_element));
                 break;
               case osm_api_data_types::osm_core_element::RELATION :
                 break;
@@ -291,6 +1062,36 @@ namespace osm_diff_analyzer_node_alignment
       }
   }
 
+  //------------------------------------------------------------------------------
+  void node_alignment_analyzer::update_node_stores(const osm_api_data_types::osm_change & p_change)
+  {
+    const osm_api_data_types::osm_core_element * const l_element = p_change.get_core_element();
+    if(l_element == NULL || l_element->get_core_type() != osm_api_data_types::osm_core_element::NODE)
+      {
+        return;
+      }
+    const osm_api_data_types::osm_node & l_node = static_cast<const osm_api_data_types::osm_node &>(*l_element);
+    // Deleted versions have no coordinates so they are not part of history
+    if(p_change.get_type() == osm_api_data_types::osm_change::DELETION)
+      {
+        if(m_node_location_store.get() != NULL)
+          {
+            m_node_location_store->remove(l_node.get_id());
+          }
+      }
+    else
+      {
+        if(m_node_location_store.get() != NULL)
+          {
+            m_node_location_store->set(l_node.get_id(),l_node.get_lat(),l_node.get_lon());
+          }
+        if(m_node_history_store.get() != NULL)
+          {
+            m_node_history_store->add(l_node.get_id(),l_node.get_version(),l_node.get_lat(),l_node.get_lon());
+          }
+      }
+  }
+
   //------------------------------------------------------------------------------
   const std::string & node_alignment_analyzer::get_input_type(void)const
   {
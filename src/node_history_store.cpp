@@ -0,0 +1,430 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "node_history_store.h"
+#include "quicky_exception.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  node_history_store::node_history_store(const std::string & p_file_name):
+    m_file_name(p_file_name),
+    m_file(-1),
+    m_file_size(0),
+    m_data(NULL),
+    m_nb_records(0),
+    m_merged_size(0),
+    m_max_pending(1 << 20)
+  {
+    m_file = open(m_file_name.c_str(),O_RDWR | O_CREAT,0644);
+    if(m_file < 0)
+      {
+        throw_error("Unable to open");
+      }
+    struct stat l_stat;
+    if(fstat(m_file,&l_stat))
+      {
+        close(m_file);
+        throw_error("Unable to get size of");
+      }
+    if(l_stat.st_size)
+      {
+        char l_header[sizeof(m_magic)];
+        if(l_stat.st_size < (off_t)m_header_size || pread(m_file,l_header,sizeof(l_header),0) != (ssize_t)sizeof(l_header) || memcmp(l_header,m_magic,sizeof(m_magic)))
+          {
+            close(m_file);
+            std::stringstream l_stream;
+            l_stream << "\"" << m_file_name << "\" is not a node history store" ;
+            throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+          }
+        m_file_size = l_stat.st_size;
+      }
+    else
+      {
+        write_header(m_file);
+        m_file_size = m_header_size;
+      }
+    map();
+    load_runs(m_header_size);
+  }
+
+  //----------------------------------------------------------------------------
+  node_history_store::~node_history_store(void)
+  {
+    unmap();
+    close(m_file);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::add(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                               const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                               const float & p_lat,
+                               const float & p_lon)
+  {
+    if((((uint64_t)p_id) >> m_id_bits) || (p_version >> m_version_bits))
+      {
+        return;
+      }
+    m_pending[get_key(p_id,p_version)] = std::pair<uint32_t,uint32_t>(node_location_store::encode_lat(p_lat),node_location_store::encode_lon(p_lon));
+    if(m_max_pending && m_pending.size() >= m_max_pending)
+      {
+        flush();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::flush(void)
+  {
+    if(!m_pending.size())
+      {
+        return;
+      }
+    std::vector<record> l_records(m_pending.size());
+    std::vector<record>::iterator l_record = l_records.begin();
+    for(std::map<uint64_t,std::pair<uint32_t,uint32_t> >::const_iterator l_iter = m_pending.begin();
+        l_iter != m_pending.end();
+        ++l_iter,++l_record)
+      {
+        l_record->m_key = l_iter->first;
+        l_record->m_lat = l_iter->second.first;
+        l_record->m_lon = l_iter->second.second;
+      }
+    std::vector<t_range> l_ranges(1,t_range(&l_records[0],&l_records[0] + l_records.size()));
+    uint64_t l_offset = m_file_size;
+    uint64_t l_size = write_run(m_file,l_offset,l_ranges);
+    m_pending.clear();
+    unmap();
+    m_file_size += l_size;
+    map();
+    load_runs(l_offset);
+    if(m_runs.size() > m_max_runs)
+      {
+        merge_last_runs();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::merge_last_runs(void)
+  {
+    // First run is typically the bulk loaded history so it is kept as is
+    // and only runs appended since are merged
+    std::vector<t_range> l_ranges;
+    for(std::vector<run>::const_iterator l_iter = m_runs.begin() + 1;
+        l_iter != m_runs.end();
+        ++l_iter)
+      {
+        l_ranges.push_back(t_range(l_iter->m_records,l_iter->m_records + l_iter->m_nb_records));
+      }
+    uint64_t l_offset = m_file_size;
+    uint64_t l_size = write_run(m_file,l_offset,l_ranges);
+
+    // Merged runs are marked only once their content is safely written so
+    // that an interruption leaves at worst duplicated records
+    uint64_t l_merged = 1;
+    for(std::vector<run>::const_iterator l_iter = m_runs.begin() + 1;
+        l_iter != m_runs.end();
+        ++l_iter)
+      {
+        write(m_file,&l_merged,sizeof(l_merged),l_iter->m_offset + sizeof(uint64_t));
+        m_merged_size += sizeof(run_header) + l_iter->m_nb_records * sizeof(record);
+        m_nb_records -= l_iter->m_nb_records;
+      }
+    m_runs.erase(m_runs.begin() + 1,m_runs.end());
+    unmap();
+    m_file_size += l_size;
+    map();
+    load_runs(l_offset);
+
+    // Space of merged runs is reclaimed once it is the larger part of file
+    if(2 * m_merged_size > m_file_size)
+      {
+        compact();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::compact(void)
+  {
+    std::vector<t_range> l_ranges;
+    for(std::vector<run>::const_iterator l_iter = m_runs.begin();
+        l_iter != m_runs.end();
+        ++l_iter)
+      {
+        l_ranges.push_back(t_range(l_iter->m_records,l_iter->m_records + l_iter->m_nb_records));
+      }
+    std::vector<record> l_records;
+    for(std::map<uint64_t,std::pair<uint32_t,uint32_t> >::const_iterator l_iter = m_pending.begin();
+        l_iter != m_pending.end();
+        ++l_iter)
+      {
+        record l_record;
+        l_record.m_key = l_iter->first;
+        l_record.m_lat = l_iter->second.first;
+        l_record.m_lon = l_iter->second.second;
+        l_records.push_back(l_record);
+      }
+    if(l_records.size())
+      {
+        l_ranges.push_back(t_range(&l_records[0],&l_records[0] + l_records.size()));
+      }
+
+    // New file replaces the current one only once completely written
+    std::string l_tmp_file_name = m_file_name + ".tmp";
+    int l_file = open(l_tmp_file_name.c_str(),O_RDWR | O_CREAT | O_TRUNC,0644);
+    if(l_file < 0)
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to open \"" << l_tmp_file_name << "\" : " << strerror(errno) ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    uint64_t l_size = m_header_size;
+    try
+      {
+        write_header(l_file);
+        if(l_ranges.size())
+          {
+            l_size += write_run(l_file,m_header_size,l_ranges);
+          }
+      }
+    catch(quicky_exception::quicky_runtime_exception & e)
+      {
+        close(l_file);
+        unlink(l_tmp_file_name.c_str());
+        throw;
+      }
+    if(rename(l_tmp_file_name.c_str(),m_file_name.c_str()))
+      {
+        close(l_file);
+        unlink(l_tmp_file_name.c_str());
+        throw_error("Unable to replace");
+      }
+    m_pending.clear();
+    unmap();
+    close(m_file);
+    m_file = l_file;
+    m_file_size = l_size;
+    m_runs.clear();
+    m_nb_records = 0;
+    m_merged_size = 0;
+    map();
+    load_runs(m_header_size);
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t node_history_store::write_run(int p_file,
+                                         const uint64_t & p_offset,
+                                         const std::vector<t_range> & p_ranges)
+  {
+    // Header is written last : until then the run looks truncated and is
+    // dropped if the file is reopened
+    run_header l_header;
+    l_header.m_nb_records = ~((uint64_t)0);
+    l_header.m_merged = 0;
+    write(p_file,&l_header,sizeof(l_header),p_offset);
+
+    std::vector<t_range> l_ranges(p_ranges);
+    std::vector<record> l_buffer;
+    l_buffer.reserve(1 << 16);
+    uint64_t l_offset = p_offset + sizeof(run_header);
+    uint64_t l_nb_records = 0;
+    for(;;)
+      {
+        // Few ranges are merged so a linear search of the smallest key is
+        // enough. Last range holding the key wins
+        const record * l_min = NULL;
+        for(std::vector<t_range>::const_iterator l_iter = l_ranges.begin();
+            l_iter != l_ranges.end();
+            ++l_iter)
+          {
+            if(l_iter->first != l_iter->second && (l_min == NULL || l_iter->first->m_key <= l_min->m_key))
+              {
+                l_min = l_iter->first;
+              }
+          }
+        if(l_min == NULL || l_buffer.size() == l_buffer.capacity())
+          {
+            if(l_buffer.size())
+              {
+                write(p_file,&l_buffer[0],l_buffer.size() * sizeof(record),l_offset);
+                l_offset += l_buffer.size() * sizeof(record);
+                l_nb_records += l_buffer.size();
+                l_buffer.clear();
+              }
+            if(l_min == NULL)
+              {
+                break;
+              }
+          }
+        l_buffer.push_back(*l_min);
+        uint64_t l_key = l_min->m_key;
+        for(std::vector<t_range>::iterator l_iter = l_ranges.begin();
+            l_iter != l_ranges.end();
+            ++l_iter)
+          {
+            if(l_iter->first != l_iter->second && l_iter->first->m_key == l_key)
+              {
+                ++(l_iter->first);
+              }
+          }
+      }
+
+    if(fdatasync(p_file))
+      {
+        throw_error("Unable to sync");
+      }
+    l_header.m_nb_records = l_nb_records;
+    write(p_file,&l_header,sizeof(l_header),p_offset);
+    if(fdatasync(p_file))
+      {
+        throw_error("Unable to sync");
+      }
+    return sizeof(run_header) + l_nb_records * sizeof(record);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::map(void)
+  {
+    void * l_data = mmap(NULL,m_file_size,PROT_READ,MAP_SHARED,m_file,0);
+    if(l_data == MAP_FAILED)
+      {
+        throw_error("Unable to map");
+      }
+    m_data = (char*)l_data;
+    for(std::vector<run>::iterator l_iter = m_runs.begin();
+        l_iter != m_runs.end();
+        ++l_iter)
+      {
+        l_iter->m_records = (const record*)(m_data + l_iter->m_offset + sizeof(run_header));
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::load_runs(const uint64_t & p_offset)
+  {
+    uint64_t l_offset = p_offset;
+    while(l_offset + sizeof(run_header) <= m_file_size)
+      {
+        const run_header * l_header = (const run_header*)(m_data + l_offset);
+        if(l_header->m_nb_records > (m_file_size - l_offset - sizeof(run_header)) / sizeof(record))
+          {
+            break;
+          }
+        uint64_t l_size = sizeof(run_header) + l_header->m_nb_records * sizeof(record);
+        if(l_header->m_merged)
+          {
+            m_merged_size += l_size;
+          }
+        else if(l_header->m_nb_records)
+          {
+            m_runs.push_back(run());
+            run & l_run = m_runs.back();
+            l_run.m_offset = l_offset;
+            l_run.m_records = (const record*)(m_data + l_offset + sizeof(run_header));
+            l_run.m_nb_records = l_header->m_nb_records;
+            l_run.m_first_key = l_run.m_records[0].m_key;
+            l_run.m_last_key = l_run.m_records[l_run.m_nb_records - 1].m_key;
+            l_run.m_index.reserve((l_run.m_nb_records + m_block_size - 1) / m_block_size);
+            for(uint64_t l_index = 0 ; l_index < l_run.m_nb_records ; l_index += m_block_size)
+              {
+                l_run.m_index.push_back(l_run.m_records[l_index].m_key);
+              }
+            m_nb_records += l_run.m_nb_records;
+          }
+        l_offset += l_size;
+      }
+
+    // Remaining bytes come from an interrupted write
+    if(l_offset < m_file_size)
+      {
+        unmap();
+        if(ftruncate(m_file,l_offset))
+          {
+            throw_error("Unable to truncate");
+          }
+        m_file_size = l_offset;
+        map();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::unmap(void)
+  {
+    if(m_data != NULL)
+      {
+        munmap(m_data,m_file_size);
+        m_data = NULL;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::write_header(int p_file)
+  {
+    std::vector<char> l_header(m_header_size,0);
+    memcpy(&l_header[0],m_magic,sizeof(m_magic));
+    write(p_file,&l_header[0],m_header_size,0);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::write(int p_file,
+                                 const void * p_data,
+                                 const uint64_t & p_size,
+                                 const uint64_t & p_offset)
+  {
+    const char * l_data = (const char*)p_data;
+    uint64_t l_written = 0;
+    while(l_written < p_size)
+      {
+        ssize_t l_result = pwrite(p_file,l_data + l_written,p_size - l_written,p_offset + l_written);
+        if(l_result < 0)
+          {
+            if(errno == EINTR)
+              {
+                continue;
+              }
+            throw_error("Unable to write");
+          }
+        l_written += l_result;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_history_store::throw_error(const std::string & p_message)const
+  {
+    std::stringstream l_stream;
+    l_stream << p_message << " node history store \"" << m_file_name << "\" : " << strerror(errno) ;
+    throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+  }
+
+  const char node_history_store::m_magic[8] = {'O','S','M','N','H','S','0','1'};
+  const uint64_t node_history_store::m_header_size = 64;
+  const uint32_t node_history_store::m_block_size;
+  const uint32_t node_history_store::m_version_bits;
+  const uint32_t node_history_store::m_id_bits;
+  const uint32_t node_history_store::m_max_runs = 16;
+}
+//EOF
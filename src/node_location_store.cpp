@@ -0,0 +1,153 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "node_location_store.h"
+#include "quicky_exception.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  node_location_store::node_location_store(const std::string & p_file_name):
+    m_file_name(p_file_name),
+    m_file(-1),
+    m_capacity(0),
+    m_data(NULL),
+    m_locations(NULL)
+  {
+    m_file = open(m_file_name.c_str(),O_RDWR | O_CREAT,0644);
+    if(m_file < 0)
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to open node location store \"" << m_file_name << "\" : " << strerror(errno) ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    struct stat l_stat;
+    if(fstat(m_file,&l_stat))
+      {
+        close(m_file);
+	std::stringstream l_stream;
+	l_stream << "Unable to get size of node location store \"" << m_file_name << "\" : " << strerror(errno) ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    uint64_t l_capacity = m_min_capacity;
+    if(l_stat.st_size)
+      {
+        char l_header[sizeof(m_magic)];
+        if(l_stat.st_size < (off_t)m_header_size || pread(m_file,l_header,sizeof(l_header),0) != (ssize_t)sizeof(l_header) || memcmp(l_header,m_magic,sizeof(m_magic)))
+          {
+            close(m_file);
+            std::stringstream l_stream;
+            l_stream << "\"" << m_file_name << "\" is not a node location store" ;
+            throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+          }
+        l_capacity = (l_stat.st_size - m_header_size) / sizeof(location);
+      }
+    map(l_capacity);
+    memcpy(m_data,m_magic,sizeof(m_magic));
+  }
+
+  //----------------------------------------------------------------------------
+  node_location_store::~node_location_store(void)
+  {
+    unmap();
+    close(m_file);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_location_store::set(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                const float & p_lat,
+                                const float & p_lon)
+  {
+    if(p_id >= m_capacity)
+      {
+        // Capacity is doubled to amortize remapping, unused part is sparse
+        uint64_t l_capacity = 2 * m_capacity;
+        if(l_capacity <= p_id)
+          {
+            l_capacity = p_id + 1;
+          }
+        unmap();
+        map(l_capacity);
+      }
+    m_locations[p_id].m_lat = encode_lat(p_lat);
+    m_locations[p_id].m_lon = encode_lon(p_lon);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_location_store::remove(const osm_api_data_types::osm_object::t_osm_id & p_id)
+  {
+    if(p_id < m_capacity)
+      {
+        m_locations[p_id].m_lat = 0;
+        m_locations[p_id].m_lon = 0;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void node_location_store::sync(void)
+  {
+    msync(m_data,m_header_size + m_capacity * sizeof(location),MS_ASYNC);
+  }
+
+  //----------------------------------------------------------------------------
+  void node_location_store::map(const uint64_t & p_capacity)
+  {
+    uint64_t l_size = m_header_size + p_capacity * sizeof(location);
+    if(ftruncate(m_file,l_size))
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to resize node location store \"" << m_file_name << "\" to " << l_size << " bytes : " << strerror(errno) ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    void * l_data = mmap(NULL,l_size,PROT_READ | PROT_WRITE,MAP_SHARED,m_file,0);
+    if(l_data == MAP_FAILED)
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to map node location store \"" << m_file_name << "\" : " << strerror(errno) ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    m_data = (char*)l_data;
+    m_locations = (location*)(m_data + m_header_size);
+    m_capacity = p_capacity;
+  }
+
+  //----------------------------------------------------------------------------
+  void node_location_store::unmap(void)
+  {
+    if(m_data != NULL)
+      {
+        munmap(m_data,m_header_size + m_capacity * sizeof(location));
+        m_data = NULL;
+        m_locations = NULL;
+      }
+  }
+
+  const char node_location_store::m_magic[8] = {'O','S','M','N','L','S','0','1'};
+  const uint64_t node_location_store::m_header_size = 64;
+  const uint64_t node_location_store::m_min_capacity = 1 << 20;
+}
+//EOF
@@ -0,0 +1,470 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "report_writer.h"
+#include "alert_renderer.h"
+#include "quicky_exception.h"
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  report_writer::report_writer(void):
+    m_report_buffer(64 * 1024),
+    m_artifact_mode(FILES),
+    m_svg_compact(true),
+    m_svg_decimation(false),
+    m_alert_stream_format(alert_stream::JSONL),
+    m_flush_interval(1),
+    m_nb_unflushed_alerts(0),
+    m_report_size(0),
+    m_nb_submitted_open(0),
+    m_nb_processed_open(0),
+    m_started(false),
+    m_stop_requested(false),
+    m_queue_size(0),
+    m_drop_when_full(false),
+    m_nb_alerts(0),
+    m_nb_dropped(0),
+    m_nb_blocked(0),
+    m_max_queue_depth(0)
+  {
+    pthread_mutex_init(&m_mutex,NULL);
+    pthread_cond_init(&m_not_empty,NULL);
+    pthread_cond_init(&m_not_full,NULL);
+  }
+
+  //----------------------------------------------------------------------------
+  report_writer::~report_writer(void)
+  {
+    join();
+    if(m_report.is_open())
+      {
+        m_report.close();
+      }
+    m_alert_stream.close();
+    pthread_cond_destroy(&m_not_full);
+    pthread_cond_destroy(&m_not_empty);
+    pthread_mutex_destroy(&m_mutex);
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::start(const uint32_t & p_queue_size,
+                            bool p_drop_when_full,
+                            const uint32_t & p_flush_interval)
+  {
+    m_flush_interval = p_flush_interval;
+    if(!p_queue_size || m_started)
+      {
+        return;
+      }
+    m_queue_size = p_queue_size;
+    m_drop_when_full = p_drop_when_full;
+    m_stop_requested = false;
+    if(pthread_create(&m_thread,NULL,thread_entry,this))
+      {
+	throw quicky_exception::quicky_runtime_exception("Unable to create report writer thread",__LINE__,__FILE__);
+      }
+    m_started = true;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::set_artifact_mode(const t_artifact_mode & p_mode)
+  {
+    m_artifact_mode = p_mode;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::set_svg_options(bool p_compact,
+                                      bool p_decimation)
+  {
+    m_svg_compact = p_compact;
+    m_svg_decimation = p_decimation;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::set_alert_stream(const std::string & p_file_name,
+                                       const alert_stream::t_format & p_format)
+  {
+    m_alert_stream_file_name = p_file_name;
+    m_alert_stream_format = p_format;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::stop(void)
+  {
+    if(!m_started)
+      {
+        return;
+      }
+    join();
+    // No submission will follow so errors of last commands are thrown here
+    check_error();
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::open_report(const std::string & p_file_name,
+                                  const std::string & p_title)
+  {
+    ++m_nb_submitted_open;
+    submit(new command(command::OPEN_REPORT,p_file_name,p_title));
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::report_alert(const alert_record * p_record)
+  {
+    submit(new command(command::ALERT,"","",p_record));
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::flush(void)
+  {
+    submit(new command(command::FLUSH));
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::close_report(void)
+  {
+    submit(new command(command::CLOSE_REPORT));
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::get_statistics(uint64_t & p_nb_alerts,
+                                     uint64_t & p_nb_dropped,
+                                     uint64_t & p_nb_blocked,
+                                     uint32_t & p_max_queue_depth)
+  {
+    pthread_mutex_lock(&m_mutex);
+    p_nb_alerts = m_nb_alerts;
+    p_nb_dropped = m_nb_dropped;
+    p_nb_blocked = m_nb_blocked;
+    p_max_queue_depth = m_max_queue_depth;
+    pthread_mutex_unlock(&m_mutex);
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t report_writer::get_report_size(void)
+  {
+    if(!m_started)
+      {
+        return m_report_size;
+      }
+    pthread_mutex_lock(&m_mutex);
+    uint64_t l_result = m_nb_submitted_open == m_nb_processed_open ? m_report_size : 0;
+    pthread_mutex_unlock(&m_mutex);
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::submit(command * p_command)
+  {
+    if(!m_started)
+      {
+        process(*p_command);
+        delete p_command;
+        return;
+      }
+    check_error();
+    pthread_mutex_lock(&m_mutex);
+    // Only alerts are subject to the queue bound : control commands must
+    // never be lost otherwise report would be corrupted
+    if(p_command->m_type == command::ALERT && m_queue.size() >= m_queue_size)
+      {
+        if(m_drop_when_full)
+          {
+            ++m_nb_dropped;
+            pthread_mutex_unlock(&m_mutex);
+            delete p_command;
+            return;
+          }
+        ++m_nb_blocked;
+        while(m_queue.size() >= m_queue_size)
+          {
+            pthread_cond_wait(&m_not_full,&m_mutex);
+          }
+      }
+    m_queue.push_back(p_command);
+    if(m_queue.size() > m_max_queue_depth)
+      {
+        m_max_queue_depth = m_queue.size();
+      }
+    pthread_cond_signal(&m_not_empty);
+    pthread_mutex_unlock(&m_mutex);
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::join(void)
+  {
+    if(!m_started)
+      {
+        return;
+      }
+    pthread_mutex_lock(&m_mutex);
+    m_stop_requested = true;
+    pthread_cond_signal(&m_not_empty);
+    pthread_mutex_unlock(&m_mutex);
+    pthread_join(m_thread,NULL);
+    m_started = false;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::check_error(void)
+  {
+    pthread_mutex_lock(&m_mutex);
+    std::string l_error = m_error;
+    m_error = "";
+    pthread_mutex_unlock(&m_mutex);
+    if(l_error != "")
+      {
+	throw quicky_exception::quicky_runtime_exception(l_error,__LINE__,__FILE__);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void * report_writer::thread_entry(void * p_writer)
+  {
+    static_cast<report_writer*>(p_writer)->run();
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::run(void)
+  {
+    pthread_mutex_lock(&m_mutex);
+    while(!m_stop_requested || m_queue.size())
+      {
+        if(m_queue.empty())
+          {
+            pthread_cond_wait(&m_not_empty,&m_mutex);
+            continue;
+          }
+        command * l_command = m_queue.front();
+        m_queue.pop_front();
+        pthread_cond_signal(&m_not_full);
+        pthread_mutex_unlock(&m_mutex);
+
+        // Errors cannot be propagated from this thread : they are stored to
+        // be thrown by the next submission
+        std::string l_error;
+        try
+          {
+            process(*l_command);
+          }
+        catch(std::exception & e)
+          {
+            l_error = e.what();
+          }
+        delete l_command;
+
+        pthread_mutex_lock(&m_mutex);
+        if(l_error != "")
+          {
+            m_error = l_error;
+          }
+      }
+    pthread_mutex_unlock(&m_mutex);
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::process(const command & p_command)
+  {
+    switch(p_command.m_type)
+      {
+      case command::OPEN_REPORT:
+        m_report.rdbuf()->pubsetbuf(&m_report_buffer[0],m_report_buffer.size());
+        m_report.open(p_command.m_file_name.c_str());
+        if(m_report.fail())
+          {
+            std::stringstream l_stream; 
+            l_stream << "ERROR : unabled to open \"" << p_command.m_file_name << "\"" ;
+            throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+          }
+        write_header(p_command.m_title);
+        m_report.flush();
+        if(m_started)
+          {
+            pthread_mutex_lock(&m_mutex);
+            ++m_nb_processed_open;
+            m_report_size = m_report.tellp();
+            pthread_mutex_unlock(&m_mutex);
+          }
+        else
+          {
+            ++m_nb_processed_open;
+            m_report_size = m_report.tellp();
+          }
+        if(m_artifact_mode == ARCHIVE)
+          {
+            // One archive per report named after it
+            std::string l_archive_name = p_command.m_file_name;
+            std::string::size_type l_pos = l_archive_name.rfind(".html");
+            if(l_pos != std::string::npos)
+              {
+                l_archive_name = l_archive_name.substr(0,l_pos);
+              }
+            m_archive.open(l_archive_name + ".pack");
+          }
+        break;
+      case command::ALERT:
+        {
+        uint64_t l_report_size = 0;
+        // HTML report is not opened by headless instances
+        if(m_report.is_open())
+          {
+            write_alert(*(p_command.m_record));
+            l_report_size = m_report.tellp();
+          }
+        if(m_alert_stream_file_name != "")
+          {
+            if(!m_alert_stream.is_open())
+              {
+                m_alert_stream.open(m_alert_stream_file_name,m_alert_stream_format);
+              }
+            m_alert_stream.write(*(p_command.m_record));
+          }
+        if(m_started)
+          {
+            pthread_mutex_lock(&m_mutex);
+            ++m_nb_alerts;
+            m_report_size = l_report_size;
+            pthread_mutex_unlock(&m_mutex);
+          }
+        else
+          {
+            ++m_nb_alerts;
+            m_report_size = l_report_size;
+          }
+        ++m_nb_unflushed_alerts;
+        if(m_nb_unflushed_alerts >= m_flush_interval)
+          {
+            flush_outputs();
+          }
+        }
+        break;
+      case command::FLUSH:
+        flush_outputs();
+        break;
+      case command::CLOSE_REPORT:
+        write_footer();
+        m_report.close();
+        m_archive.close();
+        break;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::flush_outputs(void)
+  {
+    // Artifacts are flushed before report lines referencing them
+    if(m_archive.is_open())
+      {
+        m_archive.flush();
+      }
+    if(m_alert_stream.is_open())
+      {
+        m_alert_stream.flush();
+      }
+    m_report.flush();
+    m_nb_unflushed_alerts = 0;
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::write_header(const std::string & p_title)
+  {
+    alert_renderer::render_html_header(m_report,p_title);
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::write_footer(void)
+  {
+    alert_renderer::render_html_footer(m_report);
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::write_alert(const alert_record & p_record)
+  {
+    if(m_artifact_mode == LAZY)
+      {
+        // Artifacts will be rendered on demand from alert stream
+        alert_renderer::render_html_alert(m_report,p_record,"","","");
+        return;
+      }
+    std::string l_base_name = alert_renderer::get_base_name(p_record);
+
+    std::string l_svg_name = l_base_name+".svg";
+    std::stringstream l_svg_stream;
+    alert_renderer::render_svg(l_svg_stream,p_record,m_svg_compact,m_svg_decimation);
+    store_artifact(l_svg_name,l_svg_stream.str());
+
+    std::string l_old_gpx = l_base_name+"_old";
+    std::stringstream l_old_gpx_stream;
+    alert_renderer::render_gpx(l_old_gpx_stream,l_old_gpx,p_record.get_old_coordinates());
+    store_artifact(l_old_gpx+".gpx",l_old_gpx_stream.str());
+
+    std::string l_new_gpx = l_base_name+"_new";
+    std::stringstream l_new_gpx_stream;
+    alert_renderer::render_gpx(l_new_gpx_stream,l_new_gpx,p_record.get_new_coordinates());
+    store_artifact(l_new_gpx+".gpx",l_new_gpx_stream.str());
+
+    alert_renderer::render_html_alert(m_report,p_record,
+                                      get_artifact_reference(l_old_gpx+".gpx"),
+                                      get_artifact_reference(l_new_gpx+".gpx"),
+                                      get_artifact_reference(l_svg_name));
+  }
+
+  //----------------------------------------------------------------------------
+  void report_writer::store_artifact(const std::string & p_name,
+                                     const std::string & p_content)
+  {
+    if(m_artifact_mode == ARCHIVE)
+      {
+        m_archive.append(p_name,p_content);
+        return;
+      }
+    std::ofstream l_file(p_name.c_str(),std::ios::out | std::ios::binary);
+    if(!l_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Error when creating file \"" << p_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    l_file.write(p_content.data(),p_content.size());
+    l_file.close();
+  }
+
+  //----------------------------------------------------------------------------
+  std::string report_writer::get_artifact_reference(const std::string & p_name)const
+  {
+    if(m_artifact_mode == ARCHIVE)
+      {
+        // Archive is next to the report : only its base name is kept
+        std::string l_directory = artifact_archive::get_unpack_directory(m_archive.get_file_name());
+        std::string::size_type l_pos = l_directory.rfind('/');
+        if(l_pos != std::string::npos)
+          {
+            l_directory = l_directory.substr(l_pos + 1);
+          }
+        return "./" + l_directory + "/" + p_name;
+      }
+    return "./" + p_name;
+  }
+
+}
+//EOF
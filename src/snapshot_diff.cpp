@@ -0,0 +1,336 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "snapshot_diff.h"
+#include "node_alignment_common_api.h"
+#include "node_alignment_analyzer.h"
+#include "changeset.h"
+#include "regression_moments.h"
+#include "alert_record.h"
+#include "quicky_exception.h"
+#include <algorithm>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  snapshot_diff::snapshot_diff(node_alignment_common_api & p_api,
+                               node_alignment_analyzer & p_analyzer,
+                               const uint32_t & p_nb_threads):
+    m_api(p_api),
+    m_analyzer(p_analyzer),
+    m_nb_threads(p_nb_threads ? p_nb_threads : 1),
+    m_next_candidate(0),
+    m_nb_old_nodes(0),
+    m_nb_new_nodes(0),
+    m_nb_ways(0),
+    m_nb_alerts(0)
+  {
+    pthread_mutex_init(&m_mutex,NULL);
+  }
+
+  //----------------------------------------------------------------------------
+  snapshot_diff::~snapshot_diff(void)
+  {
+    for(std::vector<candidate_way*>::iterator l_iter = m_candidates.begin();
+        l_iter != m_candidates.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+    pthread_mutex_destroy(&m_mutex);
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::run(const std::string & p_old_file_name,
+                          const std::string & p_new_file_name)
+  {
+    // Old extract is indexed and released before loading the new one so
+    // that both parsed extracts never coexist in memory
+    load(p_old_file_name,m_old_nodes,false);
+    m_nb_old_nodes = m_old_nodes.size();
+    load(p_new_file_name,m_new_nodes,true);
+    m_nb_new_nodes = m_new_nodes.size();
+    std::sort(m_candidates.begin(),m_candidates.end(),compare_candidates);
+
+    // Current thread works too so only additional workers are created
+    m_next_candidate = 0;
+    std::vector<pthread_t> l_threads;
+    for(uint32_t l_index = 1 ; l_index < m_nb_threads ; ++l_index)
+      {
+        pthread_t l_thread;
+        if(pthread_create(&l_thread,NULL,thread_entry,this))
+          {
+            break;
+          }
+        l_threads.push_back(l_thread);
+      }
+    work();
+    for(std::vector<pthread_t>::iterator l_iter = l_threads.begin();
+        l_iter != l_threads.end();
+        ++l_iter)
+      {
+        pthread_join(*l_iter,NULL);
+      }
+
+    // API and report writer are only used from calling thread. Candidates
+    // are sorted by way id so reports do not depend on scheduling
+    for(std::vector<candidate_way*>::const_iterator l_iter = m_candidates.begin();
+        l_iter != m_candidates.end();
+        ++l_iter)
+      {
+        if((*l_iter)->m_aligned)
+          {
+            report(**l_iter);
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::load(const std::string & p_file_name,
+                           coordinates_index & p_index,
+                           bool p_keep_ways)
+  {
+    std::vector<osm_api_data_types::osm_node*> l_nodes;
+    std::vector<osm_api_data_types::osm_way*> l_ways;
+    std::vector<osm_api_data_types::osm_relation*> l_relations;
+    m_api.get_osm_file_content(p_file_name,l_nodes,l_ways,l_relations);
+
+    for(std::vector<osm_api_data_types::osm_node*>::iterator l_iter = l_nodes.begin();
+        l_iter != l_nodes.end();
+        ++l_iter)
+      {
+        p_index.add((*l_iter)->get_id(),(*l_iter)->get_lat(),(*l_iter)->get_lon());
+        delete *l_iter;
+      }
+    p_index.sort();
+
+    uint32_t l_min_moved_nodes = changeset::get_min_moved_nodes();
+    for(std::vector<osm_api_data_types::osm_way*>::iterator l_iter = l_ways.begin();
+        l_iter != l_ways.end();
+        ++l_iter)
+      {
+        if(p_keep_ways)
+          {
+            ++m_nb_ways;
+            const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_node_refs = (*l_iter)->get_node_refs();
+            if(l_node_refs.size() > changeset::get_min_way_node_nb())
+              {
+                // Only nodes present in both extracts can have moved
+                uint32_t l_nb_moved_nodes = 0;
+                for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter_node = l_node_refs.begin();
+                    l_iter_node != l_node_refs.end();
+                    ++l_iter_node)
+                  {
+                    float l_old_lat;
+                    float l_old_lon;
+                    float l_new_lat;
+                    float l_new_lon;
+                    if(m_old_nodes.find(*l_iter_node,l_old_lat,l_old_lon) && m_new_nodes.find(*l_iter_node,l_new_lat,l_new_lon) &&
+                       (l_old_lat != l_new_lat || l_old_lon != l_new_lon))
+                      {
+                        ++l_nb_moved_nodes;
+                      }
+                  }
+                if(l_nb_moved_nodes >= l_min_moved_nodes && changeset::has_enough_moved_nodes(l_nb_moved_nodes,l_node_refs.size()))
+                  {
+                    m_candidates.push_back(new candidate_way(**l_iter));
+                  }
+              }
+          }
+        delete *l_iter;
+      }
+    for(std::vector<osm_api_data_types::osm_relation*>::iterator l_iter = l_relations.begin();
+        l_iter != l_relations.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool snapshot_diff::compare_candidates(const candidate_way * p_way1,
+                                         const candidate_way * p_way2)
+  {
+    return p_way1->m_id < p_way2->m_id;
+  }
+
+  //----------------------------------------------------------------------------
+  void * snapshot_diff::thread_entry(void * p_snapshot_diff)
+  {
+    ((snapshot_diff*)p_snapshot_diff)->work();
+    return NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::work(void)
+  {
+    // Candidates are distributed by chunks to limit contention on mutex
+    const uint64_t l_chunk_size = 64;
+    while(true)
+      {
+        pthread_mutex_lock(&m_mutex);
+        uint64_t l_begin = m_next_candidate;
+        uint64_t l_end = l_begin + l_chunk_size < m_candidates.size() ? l_begin + l_chunk_size : m_candidates.size();
+        m_next_candidate = l_end;
+        pthread_mutex_unlock(&m_mutex);
+        if(l_begin >= l_end)
+          {
+            return;
+          }
+        for(uint64_t l_index = l_begin ; l_index < l_end ; ++l_index)
+          {
+            score(*(m_candidates[l_index]));
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::score(candidate_way & p_way)const
+  {
+    // Geometries are rebuilt like in check_way : nodes unknown in old extract
+    // are considered as not moved and nodes unknown in new one are ignored
+    regression_moments l_old_moments;
+    regression_moments l_new_moments;
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = p_way.m_node_refs.begin();
+        l_iter != p_way.m_node_refs.end();
+        ++l_iter)
+      {
+        float l_old_lat;
+        float l_old_lon;
+        float l_new_lat;
+        float l_new_lon;
+        bool l_new_found = m_new_nodes.find(*l_iter,l_new_lat,l_new_lon);
+        if(l_new_found)
+          {
+            p_way.m_new_coordinates.push_back(std::pair<double,double>(l_new_lat,l_new_lon));
+            l_new_moments.add(l_new_lat,l_new_lon);
+          }
+        if(m_old_nodes.find(*l_iter,l_old_lat,l_old_lon))
+          {
+            p_way.m_old_coordinates.push_back(std::pair<double,double>(l_old_lat,l_old_lon));
+            l_old_moments.add(l_old_lat,l_old_lon);
+          }
+        else if(l_new_found)
+          {
+            p_way.m_old_coordinates.push_back(std::pair<double,double>(l_new_lat,l_new_lon));
+            l_old_moments.add(l_new_lat,l_new_lon);
+          }
+      }
+    p_way.m_aligned = changeset::score_alignment(l_old_moments,
+                                                 l_new_moments,
+                                                 p_way.m_old_coordinates,
+                                                 p_way.m_new_coordinates,
+                                                 p_way.m_alignment_modification_rate,
+                                                 p_way.m_min_square_modification_rate,
+                                                 p_way.m_center_lat,
+                                                 p_way.m_center_lon);
+    if(!p_way.m_aligned)
+      {
+        // Geometries are only kept for report
+        std::vector<std::pair<double,double> >().swap(p_way.m_old_coordinates);
+        std::vector<std::pair<double,double> >().swap(p_way.m_new_coordinates);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::report(const candidate_way & p_way)
+  {
+    ++m_nb_alerts;
+    std::string l_object_url;
+    m_api.get_object_browse_url(l_object_url,"way",p_way.m_id);
+    std::string l_changeset_url;
+    m_api.get_object_browse_url(l_changeset_url,"changeset",p_way.m_changeset_id);
+    std::string l_user_url;
+    m_api.get_user_browse_url(l_user_url,p_way.m_user_id,p_way.m_user_name);
+    m_analyzer.report_alert(new alert_record(p_way.m_id,
+                                             p_way.m_changeset_id,
+                                             p_way.m_user_name,
+                                             p_way.m_user_id,
+                                             l_object_url,
+                                             l_changeset_url,
+                                             l_user_url,
+                                             p_way.m_alignment_modification_rate,
+                                             p_way.m_min_square_modification_rate,
+                                             p_way.m_old_coordinates,
+                                             p_way.m_new_coordinates,
+                                             p_way.m_center_lat,
+                                             p_way.m_center_lon));
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::coordinates_index::add(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                             const float & p_lat,
+                                             const float & p_lon)
+  {
+    entry l_entry;
+    l_entry.m_id = p_id;
+    l_entry.m_lat = p_lat;
+    l_entry.m_lon = p_lon;
+    m_entries.push_back(l_entry);
+  }
+
+  //----------------------------------------------------------------------------
+  void snapshot_diff::coordinates_index::sort(void)
+  {
+    // Extracts are usually already sorted by id
+    for(uint64_t l_index = 1 ; l_index < m_entries.size() ; ++l_index)
+      {
+        if(m_entries[l_index] < m_entries[l_index - 1])
+          {
+            std::sort(m_entries.begin(),m_entries.end());
+            break;
+          }
+      }
+    std::vector<entry>(m_entries).swap(m_entries);
+  }
+
+  //----------------------------------------------------------------------------
+  bool snapshot_diff::coordinates_index::find(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                              float & p_lat,
+                                              float & p_lon)const
+  {
+    entry l_key;
+    l_key.m_id = p_id;
+    std::vector<entry>::const_iterator l_iter = std::lower_bound(m_entries.begin(),m_entries.end(),l_key);
+    if(l_iter == m_entries.end() || l_iter->m_id != p_id)
+      {
+        return false;
+      }
+    p_lat = l_iter->m_lat;
+    p_lon = l_iter->m_lon;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  snapshot_diff::candidate_way::candidate_way(const osm_api_data_types::osm_way & p_way):
+    m_id(p_way.get_id()),
+    m_changeset_id(p_way.get_changeset()),
+    m_user_id(p_way.get_user_id()),
+    m_user_name(p_way.get_user()),
+    m_node_refs(p_way.get_node_refs()),
+    m_aligned(false),
+    m_alignment_modification_rate(0.0),
+    m_min_square_modification_rate(0.0),
+    m_center_lat(0.0),
+    m_center_lon(0.0)
+  {
+  }
+}
+//EOF
@@ -19,7 +19,6 @@
 */
 
 #include "svg_report.h"
-#include "quicky_exception.h"
 #include <limits>
 #include <iostream>
 #include <sstream>
@@ -34,11 +33,26 @@ namespace osm_diff_analyzer_node_alignment
     m_min_lat(std::numeric_limits<double>::max()),
     m_max_lat(-(std::numeric_limits<double>::max()- 1 )),
     m_min_lon(std::numeric_limits<double>::max()),
-    m_max_lon(-(std::numeric_limits<double>::max()- 1 ))
+    m_max_lon(-(std::numeric_limits<double>::max()- 1 )),
+    m_svg_file(NULL),
+    m_compact(false),
+    m_decimation(false)
     {
     
     }
 
+  //----------------------------------------------------------------------------
+  void svg_report::set_compact(bool p_compact)
+  {
+    m_compact = p_compact;
+  }
+
+  //----------------------------------------------------------------------------
+  void svg_report::set_decimation(bool p_decimation)
+  {
+    m_decimation = p_decimation;
+  }
+
   //----------------------------------------------------------------------------
   void svg_report::update_xtrem_coordinates(const std::vector<std::pair<double,double> > & p_list)
   {
@@ -78,24 +92,19 @@ namespace osm_diff_analyzer_node_alignment
   }
 
   //----------------------------------------------------------------------------
-  void svg_report::open(const std::string & p_file_name)
+  void svg_report::open(std::ostream & p_stream)
   {
-    m_svg_file.open(p_file_name.c_str());
-    if(!m_svg_file.is_open())
-      {
-	std::stringstream l_stream;
-        l_stream << "Error when creating SVG file \"" << p_file_name << "\"" ;
-	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
-      }
-    m_svg_file << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << std::endl ;
-    m_svg_file << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"" << m_width << "\" height=\"" << m_height << "\">" << std::endl ;
+    m_svg_file = &p_stream;
+    m_markers.clear();
+    *m_svg_file << "<?xml version=\"1.0\" encoding=\"utf-8\"?>" << "\n" ;
+    *m_svg_file << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\" width=\"" << m_width << "\" height=\"" << m_height << "\">" << "\n" ;
   }
 
   //----------------------------------------------------------------------------
   void svg_report::close(void)
   {
-    m_svg_file << "</svg>" << std::endl ;
-    m_svg_file.close();
+    *m_svg_file << "</svg>" << "\n" ;
+    m_svg_file = NULL;
   }
 
   //----------------------------------------------------------------------------
@@ -103,6 +112,11 @@ namespace osm_diff_analyzer_node_alignment
                                  const std::string & p_color,
                                  const uint32_t & p_supp)
   {
+    if(m_compact)
+      {
+        draw_compact_polyline(p_list,p_color,p_supp);
+        return;
+      }
     double l_previous_x = 0.0;
     double l_previous_y = 0.0;
     for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_list.begin() ;
@@ -113,14 +127,66 @@ namespace osm_diff_analyzer_node_alignment
         double l_y = (( m_height - 1.0) * (m_max_lat - l_iter->first ))/ (m_max_lat - m_min_lat);
         if(l_previous_x != 0.0 && l_previous_y != 0.0)
           {
-            m_svg_file << "<line x1=\""<< l_previous_x << "\" y1=\"" << l_previous_y << "\" x2=\"" << l_x << "\" y2=\"" << l_y << "\" stroke=\"" << p_color << "\" />" << std::endl ;
+            *m_svg_file << "<line x1=\""<< l_previous_x << "\" y1=\"" << l_previous_y << "\" x2=\"" << l_x << "\" y2=\"" << l_y << "\" stroke=\"" << p_color << "\" />" << "\n" ;
+          }
+        l_previous_x = l_x;
+        l_previous_y = l_y;
+        *m_svg_file << "<circle cx=\""<< l_x << "\" cy=\"" << l_y << "\" r=\""<< (m_circle_size+p_supp) <<"\" fill=\"" << p_color << "\" />" << "\n" ;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void svg_report::draw_compact_polyline(const std::vector<std::pair<double,double> > & p_list,
+                                         const std::string & p_color,
+                                         const uint32_t & p_supp)
+  {
+    if(!p_list.size()) return;
+    const std::string & l_marker = get_marker(p_color,m_circle_size + p_supp);
+    *m_svg_file << "<polyline fill=\"none\" stroke=\"" << p_color << "\" marker-start=\"url(#" << l_marker << ")\" marker-mid=\"url(#" << l_marker << ")\" marker-end=\"url(#" << l_marker << ")\" points=\"" ;
+    int32_t l_previous_x = 0;
+    int32_t l_previous_y = 0;
+    std::vector<std::pair<double,double> >::const_iterator l_last = p_list.end();
+    --l_last;
+    for(std::vector<std::pair<double,double> >::const_iterator l_iter = p_list.begin() ;
+        l_iter != p_list.end();
+        ++l_iter)
+      {
+        int32_t l_x = get_x(*l_iter);
+        int32_t l_y = get_y(*l_iter);
+        if(l_iter != p_list.begin())
+          {
+            // Last vertex is always kept so that the end marker is right
+            if(m_decimation && l_x == l_previous_x && l_y == l_previous_y && l_iter != l_last)
+              {
+                continue;
+              }
+            *m_svg_file << " " ;
           }
+        *m_svg_file << l_x << "," << l_y ;
         l_previous_x = l_x;
         l_previous_y = l_y;
-        m_svg_file << "<circle cx=\""<< l_x << "\" cy=\"" << l_y << "\" r=\""<< (m_circle_size+p_supp) <<"\" fill=\"" << p_color << "\" />" << std::endl ;
       }
+    *m_svg_file << "\"/>" << "\n" ;
   }
 
+  //----------------------------------------------------------------------------
+  const std::string & svg_report::get_marker(const std::string & p_color,
+                                             const uint32_t & p_radius)
+  {
+    std::pair<std::string,uint32_t> l_key(p_color,p_radius);
+    std::map<std::pair<std::string,uint32_t>,std::string>::const_iterator l_iter = m_markers.find(l_key);
+    if(l_iter != m_markers.end())
+      {
+        return l_iter->second;
+      }
+    std::stringstream l_id_stream;
+    l_id_stream << "v" << m_markers.size();
+    std::string & l_id = m_markers[l_key];
+    l_id = l_id_stream.str();
+    uint32_t l_size = 2 * p_radius;
+    *m_svg_file << "<defs><marker id=\"" << l_id << "\" markerUnits=\"userSpaceOnUse\" markerWidth=\"" << l_size << "\" markerHeight=\"" << l_size << "\" refX=\"" << p_radius << "\" refY=\"" << p_radius << "\" overflow=\"visible\"><circle cx=\"" << p_radius << "\" cy=\"" << p_radius << "\" r=\"" << p_radius << "\" fill=\"" << p_color << "\"/></marker></defs>" << "\n" ;
+    return l_id;
+  }
 }
 
 //EOF
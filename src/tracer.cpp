@@ -0,0 +1,190 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "tracer.h"
+#include "quicky_exception.h"
+#include <sstream>
+#include <time.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  void tracer::configure(const t_mode & p_mode,
+                         const std::string & p_file_name,
+                         const uint32_t & p_slow_threshold_ms,
+                         const uint32_t & p_buffer_size)
+  {
+    m_mode = p_mode;
+    m_file_name = p_file_name;
+    m_slow_threshold = ((uint64_t)p_slow_threshold_ms) * 1000;
+    m_ring.resize(p_mode == SLOW ? (p_buffer_size ? p_buffer_size : 1) : 0);
+    m_ring_start = 0;
+    m_ring_size = 0;
+    m_origin = get_time_us();
+    if(m_mode == NONE || m_file.is_open())
+      {
+        return;
+      }
+    // File is created here rather than at first span : spans are written
+    // from scoped_span destructors which must not throw, possibly while an
+    // exception is already propagating
+    m_file.open(m_file_name.c_str());
+    if(!m_file.is_open())
+      {
+        m_mode = NONE;
+        std::stringstream l_stream;
+        l_stream << "Unable to create trace file \"" << m_file_name << "\"" ;
+        throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    // Chrome trace viewer accepts an unterminated array so the file is
+    // usable even if the process is killed
+    m_file << "[" ;
+    m_first_event = true;
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::begin_changeset(const osm_api_data_types::osm_object::t_osm_id & p_id)
+  {
+    if(m_mode == NONE) return;
+    m_changeset_id = p_id;
+    m_changeset_start = get_time_us();
+    m_ring_start = 0;
+    m_ring_size = 0;
+    m_nb_overwritten = 0;
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::end_changeset(void)
+  {
+    if(m_mode == SLOW && get_time_us() - m_changeset_start >= m_slow_threshold)
+      {
+        for(uint32_t l_index = 0 ; l_index < m_ring_size ; ++l_index)
+          {
+            write(m_ring[(m_ring_start + l_index) % m_ring.size()]);
+          }
+        if(m_nb_overwritten)
+          {
+            std::stringstream l_stream;
+            l_stream << ",\n{\"name\":\"ring_buffer_overflow\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":1,\"ts\":" << m_changeset_start - m_origin << ",\"args\":{\"changeset\":" << m_changeset_id << ",\"lost_spans\":" << m_nb_overwritten << "}}" ;
+            m_file << l_stream.str();
+          }
+        m_file.flush();
+      }
+    m_changeset_id = 0;
+    m_ring_size = 0;
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::flush(void)
+  {
+    if(m_file.is_open())
+      {
+        m_file.flush();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::close(void)
+  {
+    if(m_file.is_open())
+      {
+        m_file << "\n]\n" ;
+        m_file.close();
+      }
+    m_mode = NONE;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t tracer::get_time_us(void)
+  {
+    struct timespec l_time;
+    clock_gettime(CLOCK_MONOTONIC,&l_time);
+    return ((uint64_t)l_time.tv_sec) * 1000000 + l_time.tv_nsec / 1000;
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::end_span(const char * p_name,
+                        const uint64_t & p_start)
+  {
+    span l_span;
+    l_span.m_name = p_name;
+    l_span.m_start = p_start;
+    l_span.m_duration = get_time_us() - p_start;
+    l_span.m_changeset_id = m_changeset_id;
+    l_span.m_way_id = m_way_id;
+    if(m_mode == ALL)
+      {
+        write(l_span);
+      }
+    else if(m_changeset_id)
+      {
+        // SLOW mode only keeps spans belonging to a changeset, oldest ones
+        // being overwritten when buffer is full
+        if(m_ring_size < m_ring.size())
+          {
+            m_ring[(m_ring_start + m_ring_size) % m_ring.size()] = l_span;
+            ++m_ring_size;
+          }
+        else
+          {
+            m_ring[m_ring_start] = l_span;
+            m_ring_start = (m_ring_start + 1) % m_ring.size();
+            ++m_nb_overwritten;
+          }
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void tracer::write(const span & p_span)
+  {
+    // File has been opened by configure and stream errors do not throw
+    m_file << (m_first_event ? "\n" : ",\n") << "{\"name\":\"" << p_span.m_name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << p_span.m_start - m_origin << ",\"dur\":" << p_span.m_duration ;
+    if(p_span.m_changeset_id || p_span.m_way_id)
+      {
+        m_file << ",\"args\":{" ;
+        if(p_span.m_changeset_id)
+          {
+            m_file << "\"changeset\":" << p_span.m_changeset_id << (p_span.m_way_id ? "," : "") ;
+          }
+        if(p_span.m_way_id)
+          {
+            m_file << "\"way\":" << p_span.m_way_id ;
+          }
+        m_file << "}" ;
+      }
+    m_file << "}" ;
+    m_first_event = false;
+  }
+
+  tracer::t_mode tracer::m_mode = tracer::NONE;
+  std::string tracer::m_file_name;
+  std::ofstream tracer::m_file;
+  bool tracer::m_first_event = true;
+  uint64_t tracer::m_origin = 0;
+  uint64_t tracer::m_slow_threshold = 0;
+  osm_api_data_types::osm_object::t_osm_id tracer::m_changeset_id = 0;
+  osm_api_data_types::osm_object::t_osm_id tracer::m_way_id = 0;
+  uint64_t tracer::m_changeset_start = 0;
+  std::vector<tracer::span> tracer::m_ring;
+  uint32_t tracer::m_ring_start = 0;
+  uint32_t tracer::m_ring_size = 0;
+  uint64_t tracer::m_nb_overwritten = 0;
+}
+//EOF
@@ -0,0 +1,91 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _BENCHMARK_RUNNER_H_
+#define _BENCHMARK_RUNNER_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Operation measured by benchmark runner. Only run is measured, setup and
+  // teardown are called around each repetition
+  class benchmark_case
+  {
+  public:
+    inline virtual ~benchmark_case(void){}
+    inline virtual void setup(void){}
+    // Return the number of operations done
+    virtual uint64_t run(void)=0;
+    inline virtual void teardown(void){}
+  };
+
+  class benchmark_runner
+  {
+  public:
+    benchmark_runner(const uint32_t & p_nb_repetitions);
+    ~benchmark_runner(void);
+    // Runner takes ownership of benchmark
+    void add(const std::string & p_name,
+             benchmark_case * p_benchmark);
+    void run(std::ostream & p_stream);
+    void save(const std::string & p_file_name)const;
+    // Return false if one benchmark is slower than baseline by more than
+    // p_threshold percent
+    bool compare(const std::string & p_file_name,
+                 const double & p_threshold,
+                 std::ostream & p_stream)const;
+
+    // Called by replaced global allocation operators
+    inline static void count_allocation(void);
+  private:
+    class result
+    {
+    public:
+      std::string m_name;
+      uint64_t m_nb_operations;
+      double m_ns_per_operation;
+      double m_allocations_per_operation;
+      uint64_t m_peak_rss_kb;
+    };
+    static double get_time_ns(void);
+    static uint64_t get_peak_rss_kb(void);
+
+    const uint32_t m_nb_repetitions;
+    std::vector<std::pair<std::string,benchmark_case*> > m_benchmarks;
+    std::vector<result> m_results;
+    static bool m_count_allocations;
+    static uint64_t m_nb_allocations;
+  };
+
+  //----------------------------------------------------------------------------
+  void benchmark_runner::count_allocation(void)
+  {
+    if(m_count_allocations)
+      {
+        ++m_nb_allocations;
+      }
+  }
+}
+#endif // _BENCHMARK_RUNNER_H_
+//EOF
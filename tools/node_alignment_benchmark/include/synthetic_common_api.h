@@ -0,0 +1,66 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _SYNTHETIC_COMMON_API_H_
+#define _SYNTHETIC_COMMON_API_H_
+
+#include "common_api_if.h"
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  class synthetic_dataset;
+
+  // Common API implementation serving a synthetic dataset so that benchmarks
+  // only measure module code. UI entries do nothing
+  class synthetic_common_api
+  {
+  public:
+    static void set_dataset(const synthetic_dataset & p_dataset);
+    static void register_function(uintptr_t * p_api,
+                                  uint32_t p_api_size);
+    static const uint64_t & get_nb_calls(void);
+  private:
+    static const osm_api_data_types::osm_node * get_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                         void * p_user_data);
+    static const osm_api_data_types::osm_node * get_node_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                 const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                                 void * p_user_data);
+    static const std::vector<osm_api_data_types::osm_way*> * const get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                 void * p_user_data);
+    static void get_user_browse_url(std::string & p_result,
+                                    const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                    const std::string & p_user_name);
+    static void get_object_browse_url(std::string & p_result,
+                                      const std::string & p_type,
+                                      const osm_api_data_types::osm_object::t_osm_id & p_id);
+    static void ui_register_module(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                   const std::string & p_text);
+    static void ui_append_log_text(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                   const std::string & p_text);
+    static void ui_declare_html_report(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                       const std::string & p_name);
+
+    static const synthetic_dataset * m_dataset;
+    static uint64_t m_nb_calls;
+  };
+}
+#endif // _SYNTHETIC_COMMON_API_H_
+//EOF
@@ -0,0 +1,129 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _SYNTHETIC_DATASET_H_
+#define _SYNTHETIC_DATASET_H_
+
+#include "osm_node.h"
+#include "osm_way.h"
+#include <vector>
+#include <map>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Reproducible generator of OSM data for benchmarks. Ways are random
+  // walks whose version 1 is the baseline. Each generated changeset edits
+  // some ways : either by aligning all their inner nodes on the line joining
+  // their ends or by slightly moving a few nodes. Edit wars alternately
+  // reverting and restoring some alignments and an import like changeset
+  // editing a huge number of ways can be added
+  class synthetic_dataset
+  {
+  public:
+    class parameters
+    {
+    public:
+      parameters(void);
+      uint32_t m_seed;
+      uint32_t m_nb_changesets;
+      uint32_t m_ways_per_changeset;
+      uint32_t m_nodes_per_way;
+      // Share of way edits aligning the way in [0,1]
+      double m_aligned_share;
+      // Number of ways of import changeset, 0 for no import changeset
+      uint32_t m_import_ways;
+      // Number of aligned ways fought by an edit war
+      uint32_t m_edit_wars;
+    };
+
+    class changeset_content
+    {
+    public:
+      osm_api_data_types::osm_object::t_osm_id m_id;
+      std::string m_user_name;
+      osm_api_data_types::osm_object::t_osm_id m_user_id;
+      std::vector<osm_api_data_types::osm_node*> m_nodes;
+      std::vector<osm_api_data_types::osm_way*> m_ways;
+    };
+
+    synthetic_dataset(const parameters & p_parameters);
+    ~synthetic_dataset(void);
+    inline const std::vector<changeset_content> & get_changesets(void)const;
+    // Import changeset is the last one when requested
+    inline bool has_import_changeset(void)const;
+    inline uint64_t get_nb_elements(void)const;
+
+    // Data access used by the synthetic common API. Version 0 is latest one
+    bool get_node_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                              const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                              float & p_lat,
+                              float & p_lon)const;
+    const osm_api_data_types::osm_core_element::t_osm_version get_node_latest_version(const osm_api_data_types::osm_object::t_osm_id & p_id)const;
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id)const;
+    const osm_api_data_types::osm_way * get_way(const osm_api_data_types::osm_object::t_osm_id & p_id)const;
+  private:
+    // Park-Miller generator so that datasets do not depend on libc
+    uint32_t random(void);
+    double random_double(void);
+    changeset_content & add_changeset(void);
+    osm_api_data_types::osm_object::t_osm_id create_way(void);
+    void edit_way(changeset_content & p_changeset,
+                  const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                  bool p_aligned);
+    // Move modified nodes of the way back to their previous coordinates
+    void revert_way(changeset_content & p_changeset,
+                    const osm_api_data_types::osm_object::t_osm_id & p_way_id);
+
+    // Changesets of each edit war : revert, restore, revert, restore
+    static const uint32_t m_nb_edit_war_rounds = 4;
+    uint32_t m_random_state;
+    const parameters m_parameters;
+    osm_api_data_types::osm_object::t_osm_id m_next_node_id;
+    osm_api_data_types::osm_object::t_osm_id m_next_way_id;
+    // Successive coordinates of each node, index 0 being version 1
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<std::pair<float,float> > > m_node_versions;
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<osm_api_data_types::osm_object::t_osm_id> > m_node_ways;
+    std::map<osm_api_data_types::osm_object::t_osm_id,osm_api_data_types::osm_way*> m_ways;
+    std::vector<changeset_content> m_changesets;
+    uint64_t m_nb_elements;
+    static const std::vector<osm_api_data_types::osm_object::t_osm_id> m_no_way;
+  };
+
+  //----------------------------------------------------------------------------
+  const std::vector<synthetic_dataset::changeset_content> & synthetic_dataset::get_changesets(void)const
+  {
+    return m_changesets;
+  }
+
+  //----------------------------------------------------------------------------
+  bool synthetic_dataset::has_import_changeset(void)const
+  {
+    return m_parameters.m_import_ways != 0;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t synthetic_dataset::get_nb_elements(void)const
+  {
+    return m_nb_elements;
+  }
+}
+#endif // _SYNTHETIC_DATASET_H_
+//EOF
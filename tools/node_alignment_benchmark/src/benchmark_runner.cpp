@@ -0,0 +1,208 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "benchmark_runner.h"
+#include "quicky_exception.h"
+#include <sys/resource.h>
+#include <time.h>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <map>
+#include <cstdlib>
+#include <new>
+
+//------------------------------------------------------------------------------
+// Replacement of global allocation operators to count allocations done by
+// measured code
+void * operator new(std::size_t p_size) throw(std::bad_alloc)
+{
+  osm_diff_analyzer_node_alignment::benchmark_runner::count_allocation();
+  void * l_result = malloc(p_size ? p_size : 1);
+  if(l_result == NULL) throw std::bad_alloc();
+  return l_result;
+}
+
+//------------------------------------------------------------------------------
+void * operator new[](std::size_t p_size) throw(std::bad_alloc)
+{
+  osm_diff_analyzer_node_alignment::benchmark_runner::count_allocation();
+  void * l_result = malloc(p_size ? p_size : 1);
+  if(l_result == NULL) throw std::bad_alloc();
+  return l_result;
+}
+
+//------------------------------------------------------------------------------
+void operator delete(void * p_ptr) throw()
+{
+  free(p_ptr);
+}
+
+//------------------------------------------------------------------------------
+void operator delete[](void * p_ptr) throw()
+{
+  free(p_ptr);
+}
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  benchmark_runner::benchmark_runner(const uint32_t & p_nb_repetitions):
+    m_nb_repetitions(p_nb_repetitions ? p_nb_repetitions : 1)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  benchmark_runner::~benchmark_runner(void)
+  {
+    for(std::vector<std::pair<std::string,benchmark_case*> >::iterator l_iter = m_benchmarks.begin();
+        l_iter != m_benchmarks.end();
+        ++l_iter)
+      {
+        delete l_iter->second;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void benchmark_runner::add(const std::string & p_name,
+                             benchmark_case * p_benchmark)
+  {
+    m_benchmarks.push_back(std::make_pair(p_name,p_benchmark));
+  }
+
+  //----------------------------------------------------------------------------
+  void benchmark_runner::run(std::ostream & p_stream)
+  {
+    p_stream << std::left << std::setw(32) << "Benchmark" << std::right << std::setw(12) << "ops" << std::setw(14) << "ns/op" << std::setw(14) << "allocs/op" << std::setw(14) << "peak RSS kB" << std::endl ;
+    for(std::vector<std::pair<std::string,benchmark_case*> >::iterator l_iter = m_benchmarks.begin();
+        l_iter != m_benchmarks.end();
+        ++l_iter)
+      {
+        // Median of repetitions is kept to be robust against noise
+        std::vector<double> l_ns_per_operation;
+        uint64_t l_nb_operations = 0;
+        uint64_t l_nb_allocations = 0;
+        for(uint32_t l_repetition = 0 ; l_repetition < m_nb_repetitions ; ++l_repetition)
+          {
+            l_iter->second->setup();
+            m_nb_allocations = 0;
+            m_count_allocations = true;
+            double l_start = get_time_ns();
+            uint64_t l_nb = l_iter->second->run();
+            double l_end = get_time_ns();
+            m_count_allocations = false;
+            l_iter->second->teardown();
+            l_nb_operations = l_nb ? l_nb : 1;
+            l_nb_allocations = m_nb_allocations;
+            l_ns_per_operation.push_back((l_end - l_start) / l_nb_operations);
+          }
+        std::sort(l_ns_per_operation.begin(),l_ns_per_operation.end());
+
+        result l_result;
+        l_result.m_name = l_iter->first;
+        l_result.m_nb_operations = l_nb_operations;
+        l_result.m_ns_per_operation = l_ns_per_operation[l_ns_per_operation.size() / 2];
+        l_result.m_allocations_per_operation = ((double)l_nb_allocations) / l_nb_operations;
+        l_result.m_peak_rss_kb = get_peak_rss_kb();
+        m_results.push_back(l_result);
+        p_stream << std::left << std::setw(32) << l_result.m_name << std::right << std::setw(12) << l_result.m_nb_operations << std::fixed << std::setprecision(1) << std::setw(14) << l_result.m_ns_per_operation << std::setprecision(2) << std::setw(14) << l_result.m_allocations_per_operation << std::setw(14) << l_result.m_peak_rss_kb << std::endl ;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void benchmark_runner::save(const std::string & p_file_name)const
+  {
+    std::ofstream l_file(p_file_name.c_str());
+    if(!l_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to create baseline file \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    for(std::vector<result>::const_iterator l_iter = m_results.begin();
+        l_iter != m_results.end();
+        ++l_iter)
+      {
+        l_file << l_iter->m_name << " " << std::setprecision(12) << l_iter->m_ns_per_operation << " " << l_iter->m_allocations_per_operation << std::endl ;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool benchmark_runner::compare(const std::string & p_file_name,
+                                 const double & p_threshold,
+                                 std::ostream & p_stream)const
+  {
+    std::ifstream l_file(p_file_name.c_str());
+    if(!l_file.is_open())
+      {
+	std::stringstream l_stream;
+	l_stream << "Unable to open baseline file \"" << p_file_name << "\"" ;
+	throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    std::map<std::string,std::pair<double,double> > l_baseline;
+    std::string l_name;
+    double l_ns_per_operation;
+    double l_allocations_per_operation;
+    while(l_file >> l_name >> l_ns_per_operation >> l_allocations_per_operation)
+      {
+        l_baseline[l_name] = std::make_pair(l_ns_per_operation,l_allocations_per_operation);
+      }
+
+    bool l_ok = true;
+    p_stream << std::left << std::setw(32) << "Benchmark" << std::right << std::setw(14) << "base ns/op" << std::setw(14) << "ns/op" << std::setw(10) << "delta" << std::setw(14) << "base allocs" << std::setw(14) << "allocs/op" << std::endl ;
+    for(std::vector<result>::const_iterator l_iter = m_results.begin();
+        l_iter != m_results.end();
+        ++l_iter)
+      {
+        std::map<std::string,std::pair<double,double> >::const_iterator l_base_iter = l_baseline.find(l_iter->m_name);
+        if(l_base_iter == l_baseline.end())
+          {
+            p_stream << std::left << std::setw(32) << l_iter->m_name << std::right << " not in baseline" << std::endl ;
+            continue;
+          }
+        double l_delta = l_base_iter->second.first > 0.0 ? 100.0 * (l_iter->m_ns_per_operation - l_base_iter->second.first) / l_base_iter->second.first : 0.0;
+        bool l_regression = l_delta > p_threshold;
+        l_ok &= !l_regression;
+        p_stream << std::left << std::setw(32) << l_iter->m_name << std::right << std::fixed << std::setprecision(1) << std::setw(14) << l_base_iter->second.first << std::setw(14) << l_iter->m_ns_per_operation << std::setw(9) << std::showpos << l_delta << std::noshowpos << "%" << std::setprecision(2) << std::setw(14) << l_base_iter->second.second << std::setw(14) << l_iter->m_allocations_per_operation << (l_regression ? "  REGRESSION" : "") << std::endl ;
+      }
+    return l_ok;
+  }
+
+  //----------------------------------------------------------------------------
+  double benchmark_runner::get_time_ns(void)
+  {
+    struct timespec l_time;
+    clock_gettime(CLOCK_MONOTONIC,&l_time);
+    return l_time.tv_sec * 1000000000.0 + l_time.tv_nsec;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t benchmark_runner::get_peak_rss_kb(void)
+  {
+    struct rusage l_usage;
+    getrusage(RUSAGE_SELF,&l_usage);
+    return l_usage.ru_maxrss;
+  }
+
+  bool benchmark_runner::m_count_allocations = false;
+  uint64_t benchmark_runner::m_nb_allocations = 0;
+}
+//EOF
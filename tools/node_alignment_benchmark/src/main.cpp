@@ -0,0 +1,582 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Reproducible benchmarks of node_alignment hot paths on synthetic data.
+// Results can be saved as a baseline and later runs compared to it
+
+#include "benchmark_runner.h"
+#include "synthetic_dataset.h"
+#include "synthetic_common_api.h"
+#include "node_alignment_analyzer.h"
+#include "node_alignment_common_api.h"
+#include "changeset.h"
+#include "linear_regression.h"
+#include "alert_record.h"
+#include "alert_renderer.h"
+#include "module_configuration.h"
+#include "osm_id_map.h"
+#include "osm_change.h"
+#include "quicky_exception.h"
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+
+using namespace osm_diff_analyzer_node_alignment;
+
+//------------------------------------------------------------------------------
+void usage(const std::string & p_name)
+{
+  std::cerr << "Usage : " << p_name << " [options]" << std::endl ;
+  std::cerr << "Options :" << std::endl ;
+  std::cerr << "  --seed <n>               : seed of synthetic dataset (default 1)" << std::endl ;
+  std::cerr << "  --changesets <n>         : number of changesets (default 200)" << std::endl ;
+  std::cerr << "  --ways-per-changeset <n> : ways edited by each changeset (default 5)" << std::endl ;
+  std::cerr << "  --nodes-per-way <n>      : nodes of each way (default 30)" << std::endl ;
+  std::cerr << "  --aligned-share <x>      : share of edits aligning a way (default 0.1)" << std::endl ;
+  std::cerr << "  --import-ways <n>        : add an import changeset editing n ways (default 0)" << std::endl ;
+  std::cerr << "  --edit-wars <n>          : revert and restore n aligned ways twice (default 0)" << std::endl ;
+  std::cerr << "  --repetitions <n>        : repetitions of each benchmark, median is kept (default 5)" << std::endl ;
+  std::cerr << "  --save <file>            : save results as baseline" << std::endl ;
+  std::cerr << "  --compare <file>         : compare results with baseline" << std::endl ;
+  std::cerr << "  --threshold <percent>    : slowdown considered as regression (default 10)" << std::endl ;
+}
+
+//------------------------------------------------------------------------------
+// Fit of the coordinates of all dataset ways
+class linear_regression_benchmark:public benchmark_case
+{
+public:
+  linear_regression_benchmark(const synthetic_dataset & p_dataset):
+    m_result(0.0)
+  {
+    const std::vector<synthetic_dataset::changeset_content> & l_changesets = p_dataset.get_changesets();
+    for(std::vector<synthetic_dataset::changeset_content>::const_iterator l_iter = l_changesets.begin();
+        l_iter != l_changesets.end();
+        ++l_iter)
+      {
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_iter->m_ways.begin();
+            l_way_iter != l_iter->m_ways.end();
+            ++l_way_iter)
+          {
+            std::vector<std::pair<double,double> > l_points;
+            const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = (*l_way_iter)->get_node_refs();
+            for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_ref_iter = l_refs.begin();
+                l_ref_iter != l_refs.end();
+                ++l_ref_iter)
+              {
+                float l_lat;
+                float l_lon;
+                if(p_dataset.get_node_coordinates(*l_ref_iter,0,l_lat,l_lon))
+                  {
+                    l_points.push_back(std::make_pair((double)l_lat,(double)l_lon));
+                  }
+              }
+            m_point_lists.push_back(l_points);
+          }
+      }
+  }
+
+  uint64_t run(void)
+  {
+    for(std::vector<std::vector<std::pair<double,double> > >::const_iterator l_iter = m_point_lists.begin();
+        l_iter != m_point_lists.end();
+        ++l_iter)
+      {
+        linear_regression l_regression;
+        m_result += l_regression.compute(*l_iter);
+      }
+    return m_point_lists.size();
+  }
+private:
+  std::vector<std::vector<std::pair<double,double> > > m_point_lists;
+  // Accumulated to prevent compiler from optimising computation away
+  double m_result;
+};
+
+//------------------------------------------------------------------------------
+// Rendering of the SVG picture of an alert for each way
+class svg_benchmark:public benchmark_case
+{
+public:
+  svg_benchmark(const synthetic_dataset & p_dataset,
+                bool p_compact):
+    m_compact(p_compact),
+    m_size(0)
+  {
+    const std::vector<synthetic_dataset::changeset_content> & l_changesets = p_dataset.get_changesets();
+    for(std::vector<synthetic_dataset::changeset_content>::const_iterator l_iter = l_changesets.begin();
+        l_iter != l_changesets.end() && m_records.size() < 200;
+        ++l_iter)
+      {
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_iter->m_ways.begin();
+            l_way_iter != l_iter->m_ways.end();
+            ++l_way_iter)
+          {
+            std::vector<std::pair<double,double> > l_old_points;
+            std::vector<std::pair<double,double> > l_new_points;
+            const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = (*l_way_iter)->get_node_refs();
+            for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_ref_iter = l_refs.begin();
+                l_ref_iter != l_refs.end();
+                ++l_ref_iter)
+              {
+                float l_lat;
+                float l_lon;
+                if(p_dataset.get_node_coordinates(*l_ref_iter,1,l_lat,l_lon))
+                  {
+                    l_old_points.push_back(std::make_pair((double)l_lat,(double)l_lon));
+                  }
+                if(p_dataset.get_node_coordinates(*l_ref_iter,0,l_lat,l_lon))
+                  {
+                    l_new_points.push_back(std::make_pair((double)l_lat,(double)l_lon));
+                  }
+              }
+            m_records.push_back(new alert_record((*l_way_iter)->get_id(),l_iter->m_id,l_iter->m_user_name,l_iter->m_user_id,
+                                                 "","","",1.0,0.0,l_old_points,l_new_points,
+                                                 l_new_points.front().first,l_new_points.front().second));
+          }
+      }
+  }
+
+  ~svg_benchmark(void)
+  {
+    for(std::vector<alert_record*>::iterator l_iter = m_records.begin();
+        l_iter != m_records.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+  }
+
+  uint64_t run(void)
+  {
+    for(std::vector<alert_record*>::const_iterator l_iter = m_records.begin();
+        l_iter != m_records.end();
+        ++l_iter)
+      {
+        std::stringstream l_stream;
+        alert_renderer::render_svg(l_stream,**l_iter,m_compact,m_compact);
+        m_size += l_stream.str().size();
+      }
+    return m_records.size();
+  }
+private:
+  bool m_compact;
+  std::vector<alert_record*> m_records;
+  uint64_t m_size;
+};
+
+//------------------------------------------------------------------------------
+// Id index usage of a changeset : insertion of its nodes then lookup of every
+// node reference of its ways. Used to compare std::map and osm_id_map
+template <class T>
+class id_index_benchmark:public benchmark_case
+{
+public:
+  id_index_benchmark(const synthetic_dataset & p_dataset):
+    m_nb_found(0)
+  {
+    const std::vector<synthetic_dataset::changeset_content> & l_changesets = p_dataset.get_changesets();
+    for(std::vector<synthetic_dataset::changeset_content>::const_iterator l_iter = l_changesets.begin();
+        l_iter != l_changesets.end();
+        ++l_iter)
+      {
+        std::vector<osm_api_data_types::osm_object::t_osm_id> l_node_ids;
+        for(std::vector<osm_api_data_types::osm_node*>::const_iterator l_node_iter = l_iter->m_nodes.begin();
+            l_node_iter != l_iter->m_nodes.end();
+            ++l_node_iter)
+          {
+            l_node_ids.push_back((*l_node_iter)->get_id());
+          }
+        std::vector<osm_api_data_types::osm_object::t_osm_id> l_node_refs;
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_iter->m_ways.begin();
+            l_way_iter != l_iter->m_ways.end();
+            ++l_way_iter)
+          {
+            l_node_refs.insert(l_node_refs.end(),(*l_way_iter)->get_node_refs().begin(),(*l_way_iter)->get_node_refs().end());
+          }
+        m_node_ids.push_back(l_node_ids);
+        m_node_refs.push_back(l_node_refs);
+      }
+  }
+
+  uint64_t run(void)
+  {
+    uint64_t l_nb_operations = 0;
+    for(uint32_t l_index = 0 ; l_index < m_node_ids.size() ; ++l_index)
+      {
+        T l_map;
+        for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = m_node_ids[l_index].begin();
+            l_iter != m_node_ids[l_index].end();
+            ++l_iter)
+          {
+            l_map.insert(typename T::value_type(*l_iter,(void*)&(*l_iter)));
+          }
+        for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = m_node_refs[l_index].begin();
+            l_iter != m_node_refs[l_index].end();
+            ++l_iter)
+          {
+            if(l_map.find(*l_iter) != l_map.end())
+              {
+                ++m_nb_found;
+              }
+          }
+        l_nb_operations += m_node_ids[l_index].size() + m_node_refs[l_index].size();
+      }
+    return l_nb_operations;
+  }
+private:
+  std::vector<std::vector<osm_api_data_types::osm_object::t_osm_id> > m_node_ids;
+  std::vector<std::vector<osm_api_data_types::osm_object::t_osm_id> > m_node_refs;
+  uint64_t m_nb_found;
+};
+
+//------------------------------------------------------------------------------
+// Base of benchmarks working on changeset objects : changesets are created in
+// setup and destroyed in teardown so that only the measured step is timed
+class changeset_benchmark:public benchmark_case
+{
+public:
+  changeset_benchmark(node_alignment_analyzer & p_analyzer,
+                      const synthetic_dataset & p_dataset,
+                      bool p_import_only):
+    m_analyzer(p_analyzer),
+    m_dataset(p_dataset),
+    m_import_only(p_import_only)
+  {
+  }
+
+  void setup(void)
+  {
+    const std::vector<synthetic_dataset::changeset_content> & l_changesets = m_dataset.get_changesets();
+    std::vector<synthetic_dataset::changeset_content>::const_iterator l_iter = l_changesets.begin();
+    if(m_import_only && m_dataset.has_import_changeset())
+      {
+        l_iter = l_changesets.end() - 1;
+      }
+    for(;
+        l_iter != l_changesets.end();
+        ++l_iter)
+      {
+        m_changesets.push_back(std::make_pair(&(*l_iter),new changeset(m_analyzer,l_iter->m_id,l_iter->m_user_name,l_iter->m_user_id)));
+      }
+  }
+
+  void teardown(void)
+  {
+    for(std::vector<std::pair<const synthetic_dataset::changeset_content*,changeset*> >::iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        delete l_iter->second;
+      }
+    m_changesets.clear();
+  }
+protected:
+  uint64_t add_content(void)
+  {
+    uint64_t l_nb_elements = 0;
+    for(std::vector<std::pair<const synthetic_dataset::changeset_content*,changeset*> >::iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        const synthetic_dataset::changeset_content & l_content = *(l_iter->first);
+        for(std::vector<osm_api_data_types::osm_node*>::const_iterator l_node_iter = l_content.m_nodes.begin();
+            l_node_iter != l_content.m_nodes.end();
+            ++l_node_iter)
+          {
+            l_iter->second->add(**l_node_iter);
+          }
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_content.m_ways.begin();
+            l_way_iter != l_content.m_ways.end();
+            ++l_way_iter)
+          {
+            l_iter->second->add(**l_way_iter);
+          }
+        l_nb_elements += l_content.m_nodes.size() + l_content.m_ways.size();
+      }
+    return l_nb_elements;
+  }
+
+  node_alignment_analyzer & m_analyzer;
+  const synthetic_dataset & m_dataset;
+  bool m_import_only;
+  std::vector<std::pair<const synthetic_dataset::changeset_content*,changeset*> > m_changesets;
+};
+
+//------------------------------------------------------------------------------
+class changeset_add_benchmark:public changeset_benchmark
+{
+public:
+  changeset_add_benchmark(node_alignment_analyzer & p_analyzer,
+                          const synthetic_dataset & p_dataset):
+    changeset_benchmark(p_analyzer,p_dataset,false)
+  {
+  }
+
+  uint64_t run(void)
+  {
+    return add_content();
+  }
+};
+
+//------------------------------------------------------------------------------
+class check_way_benchmark:public changeset_benchmark
+{
+public:
+  check_way_benchmark(node_alignment_analyzer & p_analyzer,
+                      const synthetic_dataset & p_dataset):
+    changeset_benchmark(p_analyzer,p_dataset,false)
+  {
+  }
+
+  void setup(void)
+  {
+    changeset_benchmark::setup();
+    add_content();
+  }
+
+  uint64_t run(void)
+  {
+    uint64_t l_nb_ways = 0;
+    for(std::vector<std::pair<const synthetic_dataset::changeset_content*,changeset*> >::iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        const synthetic_dataset::changeset_content & l_content = *(l_iter->first);
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_content.m_ways.begin();
+            l_way_iter != l_content.m_ways.end();
+            ++l_way_iter)
+          {
+            l_iter->second->check_way((*l_way_iter)->get_id(),(*l_way_iter)->get_version(),(*l_way_iter)->get_node_refs());
+            ++l_nb_ways;
+          }
+      }
+    return l_nb_ways;
+  }
+};
+
+//------------------------------------------------------------------------------
+class search_aligned_ways_benchmark:public changeset_benchmark
+{
+public:
+  search_aligned_ways_benchmark(node_alignment_analyzer & p_analyzer,
+                                const synthetic_dataset & p_dataset,
+                                bool p_import_only):
+    changeset_benchmark(p_analyzer,p_dataset,p_import_only)
+  {
+  }
+
+  void setup(void)
+  {
+    changeset_benchmark::setup();
+    add_content();
+  }
+
+  uint64_t run(void)
+  {
+    for(std::vector<std::pair<const synthetic_dataset::changeset_content*,changeset*> >::iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        l_iter->second->search_aligned_ways();
+      }
+    return m_changesets.size();
+  }
+};
+
+//------------------------------------------------------------------------------
+// Ingestion of diffs by analyzer : element dispatch and changeset lookup or
+// creation. Changesets are closed in teardown which is not measured
+class analyze_benchmark:public benchmark_case
+{
+public:
+  analyze_benchmark(node_alignment_analyzer & p_analyzer,
+                    const synthetic_dataset & p_dataset):
+    m_analyzer(p_analyzer),
+    m_sequence_number(0)
+  {
+    const std::vector<synthetic_dataset::changeset_content> & l_changesets = p_dataset.get_changesets();
+    for(std::vector<synthetic_dataset::changeset_content>::const_iterator l_iter = l_changesets.begin();
+        l_iter != l_changesets.end();
+        ++l_iter)
+      {
+        for(std::vector<osm_api_data_types::osm_node*>::const_iterator l_node_iter = l_iter->m_nodes.begin();
+            l_node_iter != l_iter->m_nodes.end();
+            ++l_node_iter)
+          {
+            const osm_api_data_types::osm_node & l_node = **l_node_iter;
+            m_changes.push_back(new osm_api_data_types::osm_change(osm_api_data_types::osm_change::MODIFICATION,
+                                                                   new osm_api_data_types::osm_node(l_node.get_id(),l_node.get_lat(),l_node.get_lon(),l_node.get_timestamp(),l_node.get_version(),l_node.get_changeset(),l_node.get_user_id(),l_node.get_user())));
+          }
+        for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_way_iter = l_iter->m_ways.begin();
+            l_way_iter != l_iter->m_ways.end();
+            ++l_way_iter)
+          {
+            const osm_api_data_types::osm_way & l_way = **l_way_iter;
+            osm_api_data_types::osm_way * l_copy = new osm_api_data_types::osm_way(l_way.get_id(),l_way.get_timestamp(),l_way.get_version(),l_way.get_changeset(),l_way.get_user_id(),l_way.get_user());
+            for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_ref_iter = l_way.get_node_refs().begin();
+                l_ref_iter != l_way.get_node_refs().end();
+                ++l_ref_iter)
+              {
+                l_copy->add_node(*l_ref_iter);
+              }
+            m_changes.push_back(new osm_api_data_types::osm_change(osm_api_data_types::osm_change::MODIFICATION,l_copy));
+          }
+      }
+  }
+
+  ~analyze_benchmark(void)
+  {
+    for(std::vector<osm_api_data_types::osm_change*>::iterator l_iter = m_changes.begin();
+        l_iter != m_changes.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+  }
+
+  uint64_t run(void)
+  {
+    m_analyzer.analyze(m_changes);
+    return m_changes.size();
+  }
+
+  void teardown(void)
+  {
+    // Two diffs without the changesets are needed to close them
+    for(uint32_t l_index = 0 ; l_index < 2 ; ++l_index)
+      {
+        osm_diff_analyzer_if::osm_diff_state l_diff_state(++m_sequence_number,"");
+        m_analyzer.init(&l_diff_state);
+      }
+  }
+private:
+  node_alignment_analyzer & m_analyzer;
+  std::vector<osm_api_data_types::osm_change*> m_changes;
+  uint64_t m_sequence_number;
+};
+
+//------------------------------------------------------------------------------
+int main(int argc,char ** argv)
+{
+  synthetic_dataset::parameters l_parameters;
+  uint32_t l_nb_repetitions = 5;
+  std::string l_save_file_name;
+  std::string l_compare_file_name;
+  double l_threshold = 10.0;
+
+  int l_index = 1;
+  while(l_index < argc)
+    {
+      std::string l_option(argv[l_index]);
+      if(l_option == "--help")
+        {
+          usage(argv[0]);
+          return 0;
+        }
+      if(l_index + 1 >= argc)
+        {
+          std::cerr << "ERROR : missing value for option " << l_option << std::endl ;
+          usage(argv[0]);
+          return -1;
+        }
+      const char * l_value = argv[l_index + 1];
+      if(l_option == "--seed") l_parameters.m_seed = strtoul(l_value,NULL,10);
+      else if(l_option == "--changesets") l_parameters.m_nb_changesets = strtoul(l_value,NULL,10);
+      else if(l_option == "--ways-per-changeset") l_parameters.m_ways_per_changeset = strtoul(l_value,NULL,10);
+      else if(l_option == "--nodes-per-way") l_parameters.m_nodes_per_way = strtoul(l_value,NULL,10);
+      else if(l_option == "--aligned-share") l_parameters.m_aligned_share = strtod(l_value,NULL);
+      else if(l_option == "--import-ways") l_parameters.m_import_ways = strtoul(l_value,NULL,10);
+      else if(l_option == "--edit-wars") l_parameters.m_edit_wars = strtoul(l_value,NULL,10);
+      else if(l_option == "--repetitions") l_nb_repetitions = strtoul(l_value,NULL,10);
+      else if(l_option == "--save") l_save_file_name = l_value;
+      else if(l_option == "--compare") l_compare_file_name = l_value;
+      else if(l_option == "--threshold") l_threshold = strtod(l_value,NULL);
+      else
+        {
+          std::cerr << "ERROR : unknown option " << l_option << std::endl ;
+          usage(argv[0]);
+          return -1;
+        }
+      l_index += 2;
+    }
+
+  try
+    {
+      synthetic_dataset l_dataset(l_parameters);
+      std::cout << "Dataset : seed " << l_parameters.m_seed << ", " << l_dataset.get_changesets().size() << " changesets, " << l_dataset.get_nb_elements() << " elements" << std::endl ;
+
+      synthetic_common_api::set_dataset(l_dataset);
+      node_alignment_common_api l_api(synthetic_common_api::register_function);
+
+      // Reports are disabled so that benchmarks do not measure disk access
+      osm_diff_analyzer_if::module_configuration l_configuration("benchmark","node_alignment");
+      l_configuration.add_parameter("html_report","no");
+      l_configuration.add_parameter("report_queue_size","0");
+      l_configuration.add_parameter("checked_way_cache_size","0");
+      l_configuration.add_parameter("known_node_cache_size","0");
+      node_alignment_analyzer l_analyzer(&l_configuration,l_api);
+
+      benchmark_runner l_runner(l_nb_repetitions);
+      l_runner.add("linear_regression",new linear_regression_benchmark(l_dataset));
+      l_runner.add("svg_legacy",new svg_benchmark(l_dataset,false));
+      l_runner.add("svg_compact",new svg_benchmark(l_dataset,true));
+      l_runner.add("id_index_std_map",new id_index_benchmark<std::map<osm_api_data_types::osm_object::t_osm_id,void*> >(l_dataset));
+      l_runner.add("id_index_osm_id_map",new id_index_benchmark<osm_id_map<void*> >(l_dataset));
+      l_runner.add("analyze",new analyze_benchmark(l_analyzer,l_dataset));
+      l_runner.add("changeset_add",new changeset_add_benchmark(l_analyzer,l_dataset));
+      l_runner.add("check_way",new check_way_benchmark(l_analyzer,l_dataset));
+      l_runner.add("search_aligned_ways",new search_aligned_ways_benchmark(l_analyzer,l_dataset,false));
+      if(l_dataset.has_import_changeset())
+        {
+          l_runner.add("search_aligned_ways_import",new search_aligned_ways_benchmark(l_analyzer,l_dataset,true));
+        }
+      l_runner.run(std::cout);
+      std::cout << "API calls : " << synthetic_common_api::get_nb_calls() << std::endl ;
+
+      if(l_save_file_name != "")
+        {
+          l_runner.save(l_save_file_name);
+          std::cout << "Baseline saved in " << l_save_file_name << std::endl ;
+        }
+      if(l_compare_file_name != "")
+        {
+          if(!l_runner.compare(l_compare_file_name,l_threshold,std::cout))
+            {
+              std::cerr << "ERROR : performance regression above " << l_threshold << "%" << std::endl ;
+              return 1;
+            }
+        }
+    }
+  catch(quicky_exception::quicky_runtime_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return -1;
+    }
+  catch(quicky_exception::quicky_logic_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return -1;
+    }
+  return 0;
+}
+//EOF
@@ -0,0 +1,131 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "synthetic_common_api.h"
+#include "synthetic_dataset.h"
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::set_dataset(const synthetic_dataset & p_dataset)
+  {
+    m_dataset = &p_dataset;
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::register_function(uintptr_t * p_api,
+                                               uint32_t p_api_size)
+  {
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE] = (uintptr_t)get_node;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE_VERSION] = (uintptr_t)get_node_version;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE_WAYS] = (uintptr_t)get_node_ways;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_USER_BROWSE_URL] = (uintptr_t)get_user_browse_url;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_OBJECT_BROWSE_URL] = (uintptr_t)get_object_browse_url;
+    p_api[osm_diff_analyzer_if::common_api_if::UI_REGISTER_MODULE] = (uintptr_t)ui_register_module;
+    p_api[osm_diff_analyzer_if::common_api_if::UI_APPEND_LOG_TEXT] = (uintptr_t)ui_append_log_text;
+    p_api[osm_diff_analyzer_if::common_api_if::UI_DECLARE_HTML_REPORT] = (uintptr_t)ui_declare_html_report;
+  }
+
+  //----------------------------------------------------------------------------
+  const uint64_t & synthetic_common_api::get_nb_calls(void)
+  {
+    return m_nb_calls;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_node * synthetic_common_api::get_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                      void * p_user_data)
+  {
+    return get_node_version(p_id,0,p_user_data);
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_node * synthetic_common_api::get_node_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                              const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                                              void * p_user_data)
+  {
+    ++m_nb_calls;
+    float l_lat;
+    float l_lon;
+    if(!m_dataset->get_node_coordinates(p_id,p_version,l_lat,l_lon))
+      {
+        return NULL;
+      }
+    osm_api_data_types::osm_core_element::t_osm_version l_version = p_version ? p_version : m_dataset->get_node_latest_version(p_id);
+    return new osm_api_data_types::osm_node(p_id,l_lat,l_lon,"2012-01-01T00:00:00Z",l_version,1,1,"creator");
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_way*> * const synthetic_common_api::get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                              void * p_user_data)
+  {
+    ++m_nb_calls;
+    std::vector<osm_api_data_types::osm_way*> * l_result = new std::vector<osm_api_data_types::osm_way*>();
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_ways = m_dataset->get_node_ways(p_id);
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_ways.begin();
+        l_iter != l_ways.end();
+        ++l_iter)
+      {
+        l_result->push_back(new osm_api_data_types::osm_way(*(m_dataset->get_way(*l_iter))));
+      }
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::get_user_browse_url(std::string & p_result,
+                                                 const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                 const std::string & p_user_name)
+  {
+    p_result = "http://www.openstreetmap.org/user/" + p_user_name;
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::get_object_browse_url(std::string & p_result,
+                                                   const std::string & p_type,
+                                                   const osm_api_data_types::osm_object::t_osm_id & p_id)
+  {
+    std::stringstream l_stream;
+    l_stream << "http://www.openstreetmap.org/browse/" << p_type << "/" << p_id;
+    p_result = l_stream.str();
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::ui_register_module(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                                const std::string & p_text)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::ui_append_log_text(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                                const std::string & p_text)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_common_api::ui_declare_html_report(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                                    const std::string & p_name)
+  {
+  }
+
+  const synthetic_dataset * synthetic_common_api::m_dataset = NULL;
+  uint64_t synthetic_common_api::m_nb_calls = 0;
+}
+//EOF
@@ -0,0 +1,285 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "synthetic_dataset.h"
+#include <cmath>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  synthetic_dataset::parameters::parameters(void):
+    m_seed(1),
+    m_nb_changesets(200),
+    m_ways_per_changeset(5),
+    m_nodes_per_way(30),
+    m_aligned_share(0.1),
+    m_import_ways(0),
+    m_edit_wars(0)
+  {
+  }
+
+  //----------------------------------------------------------------------------
+  synthetic_dataset::synthetic_dataset(const parameters & p_parameters):
+    m_random_state(p_parameters.m_seed ? p_parameters.m_seed : 1),
+    m_parameters(p_parameters),
+    m_next_node_id(1),
+    m_next_way_id(1),
+    m_nb_elements(0)
+  {
+    uint32_t l_nb_changesets = m_parameters.m_nb_changesets + m_nb_edit_war_rounds * m_parameters.m_edit_wars + (m_parameters.m_import_ways ? 1 : 0);
+    m_changesets.reserve(l_nb_changesets);
+    std::vector<osm_api_data_types::osm_object::t_osm_id> l_aligned_ways;
+    for(uint32_t l_index = 0 ; l_index < m_parameters.m_nb_changesets ; ++l_index)
+      {
+        changeset_content & l_changeset = add_changeset();
+        for(uint32_t l_way_index = 0 ; l_way_index < m_parameters.m_ways_per_changeset ; ++l_way_index)
+          {
+            bool l_aligned = random_double() < m_parameters.m_aligned_share;
+            osm_api_data_types::osm_object::t_osm_id l_way_id = create_way();
+            edit_way(l_changeset,l_way_id,l_aligned);
+            if(l_aligned)
+              {
+                l_aligned_ways.push_back(l_way_id);
+              }
+          }
+        m_nb_elements += l_changeset.m_nodes.size() + l_changeset.m_ways.size();
+      }
+    for(uint32_t l_index = 0 ; l_index < m_parameters.m_edit_wars && l_index < l_aligned_ways.size() ; ++l_index)
+      {
+        for(uint32_t l_round = 0 ; l_round < m_nb_edit_war_rounds ; ++l_round)
+          {
+            changeset_content & l_changeset = add_changeset();
+            revert_way(l_changeset,l_aligned_ways[l_index]);
+            m_nb_elements += l_changeset.m_nodes.size();
+          }
+      }
+    if(m_parameters.m_import_ways)
+      {
+        changeset_content & l_changeset = add_changeset();
+        // Imports move everything slightly : alignment is not their goal
+        for(uint32_t l_way_index = 0 ; l_way_index < m_parameters.m_import_ways ; ++l_way_index)
+          {
+            edit_way(l_changeset,create_way(),false);
+          }
+        m_nb_elements += l_changeset.m_nodes.size() + l_changeset.m_ways.size();
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  synthetic_dataset::~synthetic_dataset(void)
+  {
+    for(std::vector<changeset_content>::iterator l_iter = m_changesets.begin();
+        l_iter != m_changesets.end();
+        ++l_iter)
+      {
+        for(std::vector<osm_api_data_types::osm_node*>::iterator l_node_iter = l_iter->m_nodes.begin();
+            l_node_iter != l_iter->m_nodes.end();
+            ++l_node_iter)
+          {
+            delete *l_node_iter;
+          }
+        for(std::vector<osm_api_data_types::osm_way*>::iterator l_way_iter = l_iter->m_ways.begin();
+            l_way_iter != l_iter->m_ways.end();
+            ++l_way_iter)
+          {
+            delete *l_way_iter;
+          }
+      }
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,osm_api_data_types::osm_way*>::iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        delete l_iter->second;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  uint32_t synthetic_dataset::random(void)
+  {
+    m_random_state = (uint32_t)(((uint64_t)m_random_state * 48271) % 2147483647);
+    return m_random_state;
+  }
+
+  //----------------------------------------------------------------------------
+  double synthetic_dataset::random_double(void)
+  {
+    return (random() - 1) / 2147483646.0;
+  }
+
+  //----------------------------------------------------------------------------
+  synthetic_dataset::changeset_content & synthetic_dataset::add_changeset(void)
+  {
+    m_changesets.push_back(changeset_content());
+    changeset_content & l_changeset = m_changesets.back();
+    l_changeset.m_id = 1000 + m_changesets.size() - 1;
+    l_changeset.m_user_id = 1 + random() % 50;
+    l_changeset.m_user_name = "user";
+    return l_changeset;
+  }
+
+  //----------------------------------------------------------------------------
+  osm_api_data_types::osm_object::t_osm_id synthetic_dataset::create_way(void)
+  {
+    osm_api_data_types::osm_object::t_osm_id l_way_id = m_next_way_id++;
+    osm_api_data_types::osm_way * l_way = new osm_api_data_types::osm_way(l_way_id,"2012-01-01T00:00:00Z",1,1,1,"creator");
+    double l_lat = 43.0 + 5.0 * random_double();
+    double l_lon = 1.0 + 5.0 * random_double();
+    double l_direction = 2 * 3.14159265358979 * random_double();
+    for(uint32_t l_index = 0 ; l_index < m_parameters.m_nodes_per_way ; ++l_index)
+      {
+        osm_api_data_types::osm_object::t_osm_id l_node_id = m_next_node_id++;
+        m_node_versions[l_node_id].push_back(std::pair<float,float>(l_lat,l_lon));
+        m_node_ways[l_node_id].push_back(l_way_id);
+        l_way->add_node(l_node_id);
+        // Random walk of about 10 meters steps
+        l_direction += 0.8 * (random_double() - 0.5);
+        l_lat += 0.0001 * sin(l_direction);
+        l_lon += 0.0001 * cos(l_direction);
+      }
+    m_ways[l_way_id] = l_way;
+    return l_way_id;
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_dataset::edit_way(changeset_content & p_changeset,
+                                   const osm_api_data_types::osm_object::t_osm_id & p_way_id,
+                                   bool p_aligned)
+  {
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = m_ways[p_way_id]->get_node_refs();
+    const std::pair<float,float> & l_first = m_node_versions[l_refs.front()].back();
+    const std::pair<float,float> & l_last = m_node_versions[l_refs.back()].back();
+    double l_dlat = l_last.first - l_first.first;
+    double l_dlon = l_last.second - l_first.second;
+    double l_length = l_dlat * l_dlat + l_dlon * l_dlon;
+    for(uint32_t l_index = 1 ; l_index + 1 < l_refs.size() ; ++l_index)
+      {
+        std::vector<std::pair<float,float> > & l_versions = m_node_versions[l_refs[l_index]];
+        std::pair<float,float> l_coordinates = l_versions.back();
+        if(p_aligned && l_length > 0.0)
+          {
+            // Projection on the line joining way ends
+            double l_t = ((l_coordinates.first - l_first.first) * l_dlat + (l_coordinates.second - l_first.second) * l_dlon) / l_length;
+            l_coordinates.first = l_first.first + l_t * l_dlat;
+            l_coordinates.second = l_first.second + l_t * l_dlon;
+          }
+        else if(!p_aligned && random() % 4 == 0)
+          {
+            l_coordinates.first += 0.00002 * (random_double() - 0.5);
+            l_coordinates.second += 0.00002 * (random_double() - 0.5);
+          }
+        else
+          {
+            continue;
+          }
+        l_versions.push_back(l_coordinates);
+        p_changeset.m_nodes.push_back(new osm_api_data_types::osm_node(l_refs[l_index],
+                                                                        l_coordinates.first,
+                                                                        l_coordinates.second,
+                                                                        "2012-01-02T00:00:00Z",
+                                                                        l_versions.size(),
+                                                                        p_changeset.m_id,
+                                                                        p_changeset.m_user_id,
+                                                                        p_changeset.m_user_name));
+      }
+    // Half of edited ways also have their tags modified
+    if(random() % 2)
+      {
+        osm_api_data_types::osm_way * l_way = m_ways[p_way_id];
+        osm_api_data_types::osm_way * l_new_way = new osm_api_data_types::osm_way(p_way_id,"2012-01-02T00:00:00Z",l_way->get_version() + 1,p_changeset.m_id,p_changeset.m_user_id,p_changeset.m_user_name);
+        for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_refs.begin();
+            l_iter != l_refs.end();
+            ++l_iter)
+          {
+            l_new_way->add_node(*l_iter);
+          }
+        p_changeset.m_ways.push_back(l_new_way);
+        m_ways[p_way_id] = new osm_api_data_types::osm_way(*l_new_way);
+        delete l_way;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void synthetic_dataset::revert_way(changeset_content & p_changeset,
+                                     const osm_api_data_types::osm_object::t_osm_id & p_way_id)
+  {
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = m_ways[p_way_id]->get_node_refs();
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_refs.begin();
+        l_iter != l_refs.end();
+        ++l_iter)
+      {
+        std::vector<std::pair<float,float> > & l_versions = m_node_versions[*l_iter];
+        if(l_versions.size() < 2)
+          {
+            continue;
+          }
+        std::pair<float,float> l_coordinates = l_versions[l_versions.size() - 2];
+        l_versions.push_back(l_coordinates);
+        p_changeset.m_nodes.push_back(new osm_api_data_types::osm_node(*l_iter,
+                                                                        l_coordinates.first,
+                                                                        l_coordinates.second,
+                                                                        "2012-01-03T00:00:00Z",
+                                                                        l_versions.size(),
+                                                                        p_changeset.m_id,
+                                                                        p_changeset.m_user_id,
+                                                                        p_changeset.m_user_name));
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  bool synthetic_dataset::get_node_coordinates(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                               const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                               float & p_lat,
+                                               float & p_lon)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<std::pair<float,float> > >::const_iterator l_iter = m_node_versions.find(p_id);
+    if(l_iter == m_node_versions.end() || p_version > l_iter->second.size())
+      {
+        return false;
+      }
+    const std::pair<float,float> & l_coordinates = p_version ? l_iter->second[p_version - 1] : l_iter->second.back();
+    p_lat = l_coordinates.first;
+    p_lon = l_coordinates.second;
+    return true;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_core_element::t_osm_version synthetic_dataset::get_node_latest_version(const osm_api_data_types::osm_object::t_osm_id & p_id)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<std::pair<float,float> > >::const_iterator l_iter = m_node_versions.find(p_id);
+    return l_iter != m_node_versions.end() ? l_iter->second.size() : 0;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_object::t_osm_id> & synthetic_dataset::get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<osm_api_data_types::osm_object::t_osm_id> >::const_iterator l_iter = m_node_ways.find(p_id);
+    return l_iter != m_node_ways.end() ? l_iter->second : m_no_way;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_way * synthetic_dataset::get_way(const osm_api_data_types::osm_object::t_osm_id & p_id)const
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,osm_api_data_types::osm_way*>::const_iterator l_iter = m_ways.find(p_id);
+    return l_iter != m_ways.end() ? l_iter->second : NULL;
+  }
+
+  const std::vector<osm_api_data_types::osm_object::t_osm_id> synthetic_dataset::m_no_way;
+}
+//EOF
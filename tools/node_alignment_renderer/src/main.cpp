@@ -0,0 +1,239 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Render on demand the views of alerts stored in a binary alert stream
+// generated with "alert_stream_format" set to "binary", or unpack the
+// artifacts of a report generated with "artifact_mode" set to "archive"
+// in the directory its links point to
+
+#include "alert_stream.h"
+#include "alert_renderer.h"
+#include "artifact_archive.h"
+#include "quicky_exception.h"
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+using namespace osm_diff_analyzer_node_alignment;
+
+//------------------------------------------------------------------------------
+void usage(const std::string & p_name)
+{
+  std::cerr << "Usage : " << p_name << " <alert_stream.bin> list" << std::endl ;
+  std::cerr << "        " << p_name << " <alert_stream.bin> svg|gpx|map <way_id> <changeset_id> [<output_directory>]" << std::endl ;
+  std::cerr << "  svg : way_<id>_c<changeset>.svg" << std::endl ;
+  std::cerr << "  gpx : way_<id>_c<changeset>_old.gpx and way_<id>_c<changeset>_new.gpx" << std::endl ;
+  std::cerr << "  map : HTML page with map and picture plus its SVG and GPX files" << std::endl ;
+  std::cerr << "        " << p_name << " <report.pack> unpack [<output_directory>]" << std::endl ;
+  std::cerr << "  unpack : extract archived artifacts, by default in <report>_artifacts directory where report links point" << std::endl ;
+}
+
+//------------------------------------------------------------------------------
+void write_file(const std::string & p_directory,
+                const std::string & p_name,
+                const std::string & p_content)
+{
+  std::string l_file_name = p_directory + "/" + p_name;
+  std::ofstream l_file(l_file_name.c_str(),std::ios::out | std::ios::binary);
+  if(!l_file.is_open())
+    {
+      std::stringstream l_stream;
+      l_stream << "Error when creating file \"" << l_file_name << "\"" ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  l_file.write(p_content.data(),p_content.size());
+  l_file.close();
+  std::cout << "Generated " << l_file_name << std::endl ;
+}
+
+//------------------------------------------------------------------------------
+void render_gpx(const alert_record & p_record,
+                const std::string & p_directory)
+{
+  std::string l_base_name = alert_renderer::get_base_name(p_record);
+  std::stringstream l_old_stream;
+  alert_renderer::render_gpx(l_old_stream,l_base_name + "_old",p_record.get_old_coordinates());
+  write_file(p_directory,l_base_name + "_old.gpx",l_old_stream.str());
+  std::stringstream l_new_stream;
+  alert_renderer::render_gpx(l_new_stream,l_base_name + "_new",p_record.get_new_coordinates());
+  write_file(p_directory,l_base_name + "_new.gpx",l_new_stream.str());
+}
+
+//------------------------------------------------------------------------------
+void render_svg(const alert_record & p_record,
+                const std::string & p_directory)
+{
+  std::stringstream l_stream;
+  alert_renderer::render_svg(l_stream,p_record,true,false);
+  write_file(p_directory,alert_renderer::get_base_name(p_record) + ".svg",l_stream.str());
+}
+
+//------------------------------------------------------------------------------
+void render_map(const alert_record & p_record,
+                const std::string & p_directory)
+{
+  render_svg(p_record,p_directory);
+  render_gpx(p_record,p_directory);
+  std::string l_base_name = alert_renderer::get_base_name(p_record);
+  std::stringstream l_stream;
+  alert_renderer::render_html_header(l_stream,l_base_name);
+  alert_renderer::render_html_alert(l_stream,p_record,
+                                    "./" + l_base_name + "_old.gpx",
+                                    "./" + l_base_name + "_new.gpx",
+                                    "./" + l_base_name + ".svg");
+  alert_renderer::render_html_footer(l_stream);
+  write_file(p_directory,l_base_name + ".html",l_stream.str());
+}
+
+//------------------------------------------------------------------------------
+void unpack(const std::string & p_archive_name,
+            const std::string & p_directory)
+{
+  if(mkdir(p_directory.c_str(),0755) && errno != EEXIST)
+    {
+      std::stringstream l_stream;
+      l_stream << "Error when creating directory \"" << p_directory << "\" : " << strerror(errno) ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  std::map<std::string,std::pair<uint64_t,uint64_t> > l_entries;
+  artifact_archive::read_index(p_archive_name,l_entries);
+  std::ifstream l_file(p_archive_name.c_str(),std::ios::in | std::ios::binary);
+  if(!l_file.is_open())
+    {
+      std::stringstream l_stream;
+      l_stream << "Unable to open archive \"" << p_archive_name << "\"" ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  for(std::map<std::string,std::pair<uint64_t,uint64_t> >::const_iterator l_iter = l_entries.begin();
+      l_iter != l_entries.end();
+      ++l_iter)
+    {
+      std::vector<char> l_buffer(l_iter->second.second);
+      l_file.seekg(l_iter->second.first);
+      if(l_buffer.size() && !l_file.read(&l_buffer[0],l_buffer.size()))
+        {
+          std::stringstream l_stream;
+          l_stream << "Truncated entry \"" << l_iter->first << "\" in archive \"" << p_archive_name << "\"" ;
+          throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+        }
+      write_file(p_directory,l_iter->first,std::string(l_buffer.begin(),l_buffer.end()));
+    }
+}
+
+//------------------------------------------------------------------------------
+int main(int argc,char ** argv)
+{
+  if(argc >= 3 && std::string(argv[2]) == "unpack")
+    {
+      try
+        {
+          unpack(argv[1],argc > 3 ? argv[3] : artifact_archive::get_unpack_directory(argv[1]));
+        }
+      catch(quicky_exception::quicky_runtime_exception & e)
+        {
+          std::cerr << "ERROR : " << e.what() << std::endl ;
+          return EXIT_FAILURE;
+        }
+      return EXIT_SUCCESS;
+    }
+  if(argc < 3 || (std::string(argv[2]) != "list" && argc < 5))
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  std::string l_stream_name = argv[1];
+  std::string l_command = argv[2];
+  if(l_command != "list" && l_command != "svg" && l_command != "gpx" && l_command != "map")
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  uint64_t l_way_id = argc > 3 ? strtoul(argv[3],NULL,10) : 0;
+  uint64_t l_changeset_id = argc > 4 ? strtoul(argv[4],NULL,10) : 0;
+  std::string l_directory = argc > 5 ? argv[5] : ".";
+
+  try
+    {
+      std::ifstream l_file(l_stream_name.c_str(),std::ios::in | std::ios::binary);
+      if(!l_file.is_open())
+        {
+          std::stringstream l_stream;
+          l_stream << "Unable to open alert stream \"" << l_stream_name << "\"" ;
+          throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+        }
+      uint32_t l_version;
+      alert_stream::read_header(l_file,l_version);
+
+      // Stream is append only so last matching record is the most recent one
+      alert_record * l_found = NULL;
+      alert_record * l_record;
+      while((l_record = alert_stream::read(l_file,l_version)) != NULL)
+        {
+          if("list" == l_command)
+            {
+              std::cout << "Way " << l_record->get_way_id() << " changeset " << l_record->get_changeset_id() << " user " << l_record->get_user_name() << std::endl ;
+              delete l_record;
+            }
+          else if(l_record->get_way_id() == l_way_id && l_record->get_changeset_id() == l_changeset_id)
+            {
+              delete l_found;
+              l_found = l_record;
+            }
+          else
+            {
+              delete l_record;
+            }
+        }
+      if("list" == l_command)
+        {
+          return EXIT_SUCCESS;
+        }
+      if(NULL == l_found)
+        {
+          std::cerr << "No alert for way " << l_way_id << " in changeset " << l_changeset_id << std::endl ;
+          return EXIT_FAILURE;
+        }
+      if("svg" == l_command)
+        {
+          render_svg(*l_found,l_directory);
+        }
+      else if("gpx" == l_command)
+        {
+          render_gpx(*l_found,l_directory);
+        }
+      else
+        {
+          render_map(*l_found,l_directory);
+        }
+      delete l_found;
+    }
+  catch(quicky_exception::quicky_runtime_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+//EOF
@@ -0,0 +1,94 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _LOCAL_COMMON_API_H_
+#define _LOCAL_COMMON_API_H_
+
+#include "common_api_if.h"
+#include "osm_node.h"
+#include "osm_way.h"
+#include <map>
+#include <vector>
+#include <string>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // File backed stand-in for the data entries of the common API. Objects of
+  // local .osm or history files are indexed in memory and served instead
+  // of querying OSM API. An artificial latency with jitter can be added to
+  // each call to simulate network behaviour. Returned objects are copies
+  // owned by caller as with host implementation
+  class local_common_api
+  {
+  public:
+    // Files are parsed with the get_osm_file_content entry of backing API
+    static void load(const std::string & p_file_name,
+                     osm_diff_analyzer_if::common_api_if::t_get_osm_file_content p_parser);
+    static void set_latency(const uint32_t & p_latency_us,
+                            const uint32_t & p_jitter_us);
+    // Replace served entries in common API table
+    static void install(uintptr_t * p_api);
+    static void release(void);
+    static uint64_t get_nb_nodes(void);
+    static uint64_t get_nb_ways(void);
+    static void get_call_statistics(std::map<std::string,uint64_t> & p_statistics);
+
+    static const osm_api_data_types::osm_node * get_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                         void * p_user_data);
+    static const osm_api_data_types::osm_node * get_node_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                 const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                                 void * p_user_data);
+    static const std::vector<osm_api_data_types::osm_node*> * const get_node_history(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                     void * p_user_data);
+    static const std::vector<osm_api_data_types::osm_way*> * const get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                 void * p_user_data);
+    static const std::vector<osm_api_data_types::osm_node*> * const get_nodes(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_ids,
+                                                                              void * p_user_data);
+    static const osm_api_data_types::osm_way * get_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                       void * p_user_data);
+    static const osm_api_data_types::osm_way * get_way_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                               const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                               void * p_user_data);
+    static const osm_api_data_types::osm_way * const get_way_full(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                  std::vector<osm_api_data_types::osm_node*> & p_nodes,
+                                                                  void * p_user_data);
+  private:
+    typedef std::map<osm_api_data_types::osm_core_element::t_osm_version,osm_api_data_types::osm_node*> t_node_versions;
+    typedef std::map<osm_api_data_types::osm_core_element::t_osm_version,osm_api_data_types::osm_way*> t_way_versions;
+
+    static void simulate_latency(const std::string & p_call);
+    static const osm_api_data_types::osm_node * find_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                          const osm_api_data_types::osm_core_element::t_osm_version & p_version);
+    static const osm_api_data_types::osm_way * find_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                        const osm_api_data_types::osm_core_element::t_osm_version & p_version);
+
+    static std::map<osm_api_data_types::osm_object::t_osm_id,t_node_versions> m_nodes;
+    static std::map<osm_api_data_types::osm_object::t_osm_id,t_way_versions> m_ways;
+    // Ways referencing a node in their latest version
+    static std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<osm_api_data_types::osm_object::t_osm_id> > m_node_ways;
+    static bool m_node_ways_valid;
+    static uint32_t m_latency_us;
+    static uint32_t m_jitter_us;
+    static std::map<std::string,uint64_t> m_call_statistics;
+  };
+}
+#endif // _LOCAL_COMMON_API_H_
+//EOF
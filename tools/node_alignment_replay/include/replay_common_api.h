@@ -0,0 +1,64 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#ifndef _REPLAY_COMMON_API_H_
+#define _REPLAY_COMMON_API_H_
+
+#include "common_api_if.h"
+#include <string>
+#include <vector>
+#include <inttypes.h>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  // Common API table given to the module by the replay driver. Entries are
+  // those of a backing implementation provided by host library except UI
+  // ones which are handled locally. Individual entries can be replaced to
+  // serve data from local stores
+  class replay_common_api
+  {
+  public:
+    static void load_backing(osm_diff_analyzer_if::module_library_if::t_register_function p_backing_func);
+    static void set_entry(const uint32_t & p_index,
+                          uintptr_t p_function);
+    static uintptr_t get_backing_entry(const uint32_t & p_index);
+    // Function given to module through require_common_api
+    static void register_function(uintptr_t * p_api,
+                                  uint32_t p_api_size);
+    static void set_verbose(bool p_verbose);
+    static const std::vector<std::string> & get_declared_reports(void);
+
+    static const std::vector<osm_api_data_types::osm_change*> * const get_osm_change_file_content(const std::string & p_file_name);
+  private:
+    static void ui_register_module(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                   const std::string & p_text);
+    static void ui_append_log_text(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                   const std::string & p_text);
+    static void ui_declare_html_report(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                       const std::string & p_name);
+
+    static uintptr_t m_backing_api[COMMON_API_IF_SIZE];
+    static uintptr_t m_api[COMMON_API_IF_SIZE];
+    static bool m_verbose;
+    static std::vector<std::string> m_declared_reports;
+  };
+}
+#endif // _REPLAY_COMMON_API_H_
+//EOF
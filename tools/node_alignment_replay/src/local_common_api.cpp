@@ -0,0 +1,339 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "local_common_api.h"
+#include "quicky_exception.h"
+#include <unistd.h>
+#include <cstdlib>
+#include <sstream>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  void local_common_api::load(const std::string & p_file_name,
+                              osm_diff_analyzer_if::common_api_if::t_get_osm_file_content p_parser)
+  {
+    if(p_parser == NULL)
+      {
+	throw quicky_exception::quicky_logic_exception("Common API implementation does not provide get_osm_file_content",__LINE__,__FILE__);
+      }
+    std::vector<osm_api_data_types::osm_node*> l_nodes;
+    std::vector<osm_api_data_types::osm_way*> l_ways;
+    std::vector<osm_api_data_types::osm_relation*> l_relations;
+    p_parser(p_file_name,l_nodes,l_ways,l_relations);
+
+    // History files contain several versions of the same object
+    for(std::vector<osm_api_data_types::osm_node*>::const_iterator l_iter = l_nodes.begin();
+        l_iter != l_nodes.end();
+        ++l_iter)
+      {
+        osm_api_data_types::osm_node * & l_node = m_nodes[(*l_iter)->get_id()][(*l_iter)->get_version()];
+        delete l_node;
+        l_node = *l_iter;
+      }
+    for(std::vector<osm_api_data_types::osm_way*>::const_iterator l_iter = l_ways.begin();
+        l_iter != l_ways.end();
+        ++l_iter)
+      {
+        osm_api_data_types::osm_way * & l_way = m_ways[(*l_iter)->get_id()][(*l_iter)->get_version()];
+        delete l_way;
+        l_way = *l_iter;
+      }
+    for(std::vector<osm_api_data_types::osm_relation*>::const_iterator l_iter = l_relations.begin();
+        l_iter != l_relations.end();
+        ++l_iter)
+      {
+        delete *l_iter;
+      }
+    m_node_ways_valid = false;
+  }
+
+  //----------------------------------------------------------------------------
+  void local_common_api::set_latency(const uint32_t & p_latency_us,
+                                     const uint32_t & p_jitter_us)
+  {
+    m_latency_us = p_latency_us;
+    m_jitter_us = p_jitter_us;
+  }
+
+  //----------------------------------------------------------------------------
+  void local_common_api::install(uintptr_t * p_api)
+  {
+    // Reverse index is built once all files are loaded
+    if(!m_node_ways_valid)
+      {
+        m_node_ways.clear();
+        for(std::map<osm_api_data_types::osm_object::t_osm_id,t_way_versions>::const_iterator l_iter = m_ways.begin();
+            l_iter != m_ways.end();
+            ++l_iter)
+          {
+            const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = l_iter->second.rbegin()->second->get_node_refs();
+            for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_ref_iter = l_refs.begin();
+                l_ref_iter != l_refs.end();
+                ++l_ref_iter)
+              {
+                std::vector<osm_api_data_types::osm_object::t_osm_id> & l_node_ways = m_node_ways[*l_ref_iter];
+                // Closed ways reference their first node twice
+                if(l_node_ways.empty() || l_node_ways.back() != l_iter->first)
+                  {
+                    l_node_ways.push_back(l_iter->first);
+                  }
+              }
+          }
+        m_node_ways_valid = true;
+      }
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE] = (uintptr_t)get_node;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE_VERSION] = (uintptr_t)get_node_version;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE_HISTORY] = (uintptr_t)get_node_history;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODE_WAYS] = (uintptr_t)get_node_ways;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_NODES] = (uintptr_t)get_nodes;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_WAY] = (uintptr_t)get_way;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_WAY_VERSION] = (uintptr_t)get_way_version;
+    p_api[osm_diff_analyzer_if::common_api_if::GET_WAY_FULL] = (uintptr_t)get_way_full;
+  }
+
+  //----------------------------------------------------------------------------
+  void local_common_api::release(void)
+  {
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,t_node_versions>::iterator l_iter = m_nodes.begin();
+        l_iter != m_nodes.end();
+        ++l_iter)
+      {
+        for(t_node_versions::iterator l_version_iter = l_iter->second.begin();
+            l_version_iter != l_iter->second.end();
+            ++l_version_iter)
+          {
+            delete l_version_iter->second;
+          }
+      }
+    m_nodes.clear();
+    for(std::map<osm_api_data_types::osm_object::t_osm_id,t_way_versions>::iterator l_iter = m_ways.begin();
+        l_iter != m_ways.end();
+        ++l_iter)
+      {
+        for(t_way_versions::iterator l_version_iter = l_iter->second.begin();
+            l_version_iter != l_iter->second.end();
+            ++l_version_iter)
+          {
+            delete l_version_iter->second;
+          }
+      }
+    m_ways.clear();
+    m_node_ways.clear();
+    m_node_ways_valid = false;
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t local_common_api::get_nb_nodes(void)
+  {
+    return m_nodes.size();
+  }
+
+  //----------------------------------------------------------------------------
+  uint64_t local_common_api::get_nb_ways(void)
+  {
+    return m_ways.size();
+  }
+
+  //----------------------------------------------------------------------------
+  void local_common_api::get_call_statistics(std::map<std::string,uint64_t> & p_statistics)
+  {
+    p_statistics = m_call_statistics;
+  }
+
+  //----------------------------------------------------------------------------
+  void local_common_api::simulate_latency(const std::string & p_call)
+  {
+    ++m_call_statistics[p_call];
+    uint32_t l_delay = m_latency_us;
+    if(m_jitter_us)
+      {
+        l_delay += rand() % (m_jitter_us + 1);
+      }
+    if(l_delay)
+      {
+        usleep(l_delay);
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_node * local_common_api::find_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                   const osm_api_data_types::osm_core_element::t_osm_version & p_version)
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,t_node_versions>::const_iterator l_iter = m_nodes.find(p_id);
+    if(l_iter == m_nodes.end())
+      {
+        return NULL;
+      }
+    // Version 0 means latest version
+    if(!p_version)
+      {
+        return l_iter->second.rbegin()->second;
+      }
+    t_node_versions::const_iterator l_version_iter = l_iter->second.find(p_version);
+    return l_version_iter != l_iter->second.end() ? l_version_iter->second : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_way * local_common_api::find_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                 const osm_api_data_types::osm_core_element::t_osm_version & p_version)
+  {
+    std::map<osm_api_data_types::osm_object::t_osm_id,t_way_versions>::const_iterator l_iter = m_ways.find(p_id);
+    if(l_iter == m_ways.end())
+      {
+        return NULL;
+      }
+    if(!p_version)
+      {
+        return l_iter->second.rbegin()->second;
+      }
+    t_way_versions::const_iterator l_version_iter = l_iter->second.find(p_version);
+    return l_version_iter != l_iter->second.end() ? l_version_iter->second : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_node * local_common_api::get_node(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                  void * p_user_data)
+  {
+    simulate_latency("get_node");
+    const osm_api_data_types::osm_node * l_node = find_node(p_id,0);
+    return l_node ? new osm_api_data_types::osm_node(*l_node) : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_node * local_common_api::get_node_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                          const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                                          void * p_user_data)
+  {
+    simulate_latency("get_node_version");
+    const osm_api_data_types::osm_node * l_node = find_node(p_id,p_version);
+    return l_node ? new osm_api_data_types::osm_node(*l_node) : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_node*> * const local_common_api::get_node_history(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                              void * p_user_data)
+  {
+    simulate_latency("get_node_history");
+    std::vector<osm_api_data_types::osm_node*> * l_result = new std::vector<osm_api_data_types::osm_node*>();
+    std::map<osm_api_data_types::osm_object::t_osm_id,t_node_versions>::const_iterator l_iter = m_nodes.find(p_id);
+    if(l_iter != m_nodes.end())
+      {
+        for(t_node_versions::const_iterator l_version_iter = l_iter->second.begin();
+            l_version_iter != l_iter->second.end();
+            ++l_version_iter)
+          {
+            l_result->push_back(new osm_api_data_types::osm_node(*(l_version_iter->second)));
+          }
+      }
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_way*> * const local_common_api::get_node_ways(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                                          void * p_user_data)
+  {
+    simulate_latency("get_node_ways");
+    std::vector<osm_api_data_types::osm_way*> * l_result = new std::vector<osm_api_data_types::osm_way*>();
+    std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<osm_api_data_types::osm_object::t_osm_id> >::const_iterator l_iter = m_node_ways.find(p_id);
+    if(l_iter != m_node_ways.end())
+      {
+        for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_way_iter = l_iter->second.begin();
+            l_way_iter != l_iter->second.end();
+            ++l_way_iter)
+          {
+            l_result->push_back(new osm_api_data_types::osm_way(*find_way(*l_way_iter,0)));
+          }
+      }
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_node*> * const local_common_api::get_nodes(const std::vector<osm_api_data_types::osm_object::t_osm_id> & p_ids,
+                                                                                       void * p_user_data)
+  {
+    simulate_latency("get_nodes");
+    std::vector<osm_api_data_types::osm_node*> * l_result = new std::vector<osm_api_data_types::osm_node*>();
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = p_ids.begin();
+        l_iter != p_ids.end();
+        ++l_iter)
+      {
+        const osm_api_data_types::osm_node * l_node = find_node(*l_iter,0);
+        if(l_node)
+          {
+            l_result->push_back(new osm_api_data_types::osm_node(*l_node));
+          }
+      }
+    return l_result;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_way * local_common_api::get_way(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                void * p_user_data)
+  {
+    simulate_latency("get_way");
+    const osm_api_data_types::osm_way * l_way = find_way(p_id,0);
+    return l_way ? new osm_api_data_types::osm_way(*l_way) : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_way * local_common_api::get_way_version(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                        const osm_api_data_types::osm_core_element::t_osm_version & p_version,
+                                                                        void * p_user_data)
+  {
+    simulate_latency("get_way_version");
+    const osm_api_data_types::osm_way * l_way = find_way(p_id,p_version);
+    return l_way ? new osm_api_data_types::osm_way(*l_way) : NULL;
+  }
+
+  //----------------------------------------------------------------------------
+  const osm_api_data_types::osm_way * const local_common_api::get_way_full(const osm_api_data_types::osm_object::t_osm_id & p_id,
+                                                                           std::vector<osm_api_data_types::osm_node*> & p_nodes,
+                                                                           void * p_user_data)
+  {
+    simulate_latency("get_way_full");
+    const osm_api_data_types::osm_way * l_way = find_way(p_id,0);
+    if(l_way == NULL)
+      {
+        return NULL;
+      }
+    const std::vector<osm_api_data_types::osm_object::t_osm_id> & l_refs = l_way->get_node_refs();
+    for(std::vector<osm_api_data_types::osm_object::t_osm_id>::const_iterator l_iter = l_refs.begin();
+        l_iter != l_refs.end();
+        ++l_iter)
+      {
+        const osm_api_data_types::osm_node * l_node = find_node(*l_iter,0);
+        if(l_node)
+          {
+            p_nodes.push_back(new osm_api_data_types::osm_node(*l_node));
+          }
+      }
+    return new osm_api_data_types::osm_way(*l_way);
+  }
+
+  std::map<osm_api_data_types::osm_object::t_osm_id,local_common_api::t_node_versions> local_common_api::m_nodes;
+  std::map<osm_api_data_types::osm_object::t_osm_id,local_common_api::t_way_versions> local_common_api::m_ways;
+  std::map<osm_api_data_types::osm_object::t_osm_id,std::vector<osm_api_data_types::osm_object::t_osm_id> > local_common_api::m_node_ways;
+  bool local_common_api::m_node_ways_valid = false;
+  uint32_t local_common_api::m_latency_us = 0;
+  uint32_t local_common_api::m_jitter_us = 0;
+  std::map<std::string,uint64_t> local_common_api::m_call_statistics;
+}
+//EOF
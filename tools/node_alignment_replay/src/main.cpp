@@ -0,0 +1,410 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Standalone driver replaying a directory of osmChange files through the
+// node_alignment module outside of soda host
+
+#include "replay_common_api.h"
+#include "local_common_api.h"
+#include "module_library_if.h"
+#include "cpp_analyzer_base.h"
+#include "quicky_exception.h"
+#include <dlfcn.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+
+using namespace osm_diff_analyzer_node_alignment;
+
+//------------------------------------------------------------------------------
+void usage(const std::string & p_name)
+{
+  std::cerr << "Usage : " << p_name << " --module <module.so> --api-library <host_api.so> [options] <osc_directory>" << std::endl ;
+  std::cerr << "Options :" << std::endl ;
+  std::cerr << "  --api-symbol <name>  : function of API library filling common API table (default register_common_api)" << std::endl ;
+  std::cerr << "  --name <name>        : name of analyzer instance (default node_alignment_replay)" << std::endl ;
+  std::cerr << "  --param <key>=<value>: module parameter, can be repeated" << std::endl ;
+  std::cerr << "  --osm-file <file>    : serve node and way requests from this .osm or history file instead of OSM API, can be repeated" << std::endl ;
+  std::cerr << "  --latency-us <n>     : artificial latency added to each local request" << std::endl ;
+  std::cerr << "  --jitter-us <n>      : maximum random delay added to latency" << std::endl ;
+  std::cerr << "  --verbose            : display module logs" << std::endl ;
+}
+
+//------------------------------------------------------------------------------
+double get_time(void)
+{
+  struct timeval l_time;
+  gettimeofday(&l_time,NULL);
+  return l_time.tv_sec + l_time.tv_usec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+// Compare file names so that numbers are sorted by value : 9.osc < 10.osc
+bool natural_less(const std::string & p_first,
+                  const std::string & p_second)
+{
+  size_t l_first_index = 0;
+  size_t l_second_index = 0;
+  while(l_first_index < p_first.size() && l_second_index < p_second.size())
+    {
+      if(isdigit(p_first[l_first_index]) && isdigit(p_second[l_second_index]))
+        {
+          size_t l_first_end = l_first_index;
+          while(l_first_end < p_first.size() && isdigit(p_first[l_first_end])) ++l_first_end;
+          size_t l_second_end = l_second_index;
+          while(l_second_end < p_second.size() && isdigit(p_second[l_second_end])) ++l_second_end;
+          uint64_t l_first_number = strtoul(p_first.substr(l_first_index,l_first_end - l_first_index).c_str(),NULL,10);
+          uint64_t l_second_number = strtoul(p_second.substr(l_second_index,l_second_end - l_second_index).c_str(),NULL,10);
+          if(l_first_number != l_second_number) return l_first_number < l_second_number;
+          l_first_index = l_first_end;
+          l_second_index = l_second_end;
+        }
+      else
+        {
+          if(p_first[l_first_index] != p_second[l_second_index]) return p_first[l_first_index] < p_second[l_second_index];
+          ++l_first_index;
+          ++l_second_index;
+        }
+    }
+  return p_first.size() - l_first_index < p_second.size() - l_second_index;
+}
+
+//------------------------------------------------------------------------------
+// Replication directories are nested like 000/123/456.osc
+void list_osc_files(const std::string & p_directory,
+                    std::vector<std::string> & p_files)
+{
+  DIR * l_dir = opendir(p_directory.c_str());
+  if(l_dir == NULL)
+    {
+      std::stringstream l_stream;
+      l_stream << "Unable to open directory \"" << p_directory << "\"" ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  struct dirent * l_entry;
+  while((l_entry = readdir(l_dir)) != NULL)
+    {
+      std::string l_name = l_entry->d_name;
+      if(l_name == "." || l_name == "..") continue;
+      std::string l_path = p_directory + "/" + l_name;
+      struct stat l_stat;
+      if(stat(l_path.c_str(),&l_stat)) continue;
+      if(S_ISDIR(l_stat.st_mode))
+        {
+          list_osc_files(l_path,p_files);
+        }
+      else if(l_name.size() > 4 && l_name.substr(l_name.size() - 4) == ".osc")
+        {
+          p_files.push_back(l_path);
+        }
+    }
+  closedir(l_dir);
+}
+
+//------------------------------------------------------------------------------
+// Sequence number is made of path digits : 000/123/456.osc gives 123456
+uint64_t get_sequence_number(const std::string & p_relative_path)
+{
+  std::string l_digits;
+  for(std::string::const_iterator l_iter = p_relative_path.begin();
+      l_iter != p_relative_path.end();
+      ++l_iter)
+    {
+      if(isdigit(*l_iter)) l_digits += *l_iter;
+    }
+  return strtoul(l_digits.c_str(),NULL,10);
+}
+
+//------------------------------------------------------------------------------
+// Number of records in the binary alert stream of the module. Records are
+// prefixed by their little endian uint32 length after the 8 bytes header
+uint64_t count_alerts(const std::string & p_file_name)
+{
+  std::ifstream l_file(p_file_name.c_str(),std::ios::in | std::ios::binary);
+  if(!l_file.is_open()) return 0;
+  uint64_t l_nb_alerts = 0;
+  l_file.seekg(8);
+  unsigned char l_length[4];
+  while(l_file.read((char*)l_length,sizeof(l_length)))
+    {
+      uint32_t l_size = l_length[0] | (l_length[1] << 8) | (l_length[2] << 16) | ((uint32_t)l_length[3] << 24);
+      l_file.seekg(l_size,std::ios::cur);
+      ++l_nb_alerts;
+    }
+  return l_nb_alerts;
+}
+
+//------------------------------------------------------------------------------
+void * get_symbol(void * p_library,
+                  const std::string & p_library_name,
+                  const std::string & p_symbol)
+{
+  void * l_symbol = dlsym(p_library,p_symbol.c_str());
+  if(l_symbol == NULL)
+    {
+      std::stringstream l_stream;
+      l_stream << "Unable to find symbol \"" << p_symbol << "\" in \"" << p_library_name << "\" : " << dlerror() ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  return l_symbol;
+}
+
+//------------------------------------------------------------------------------
+void * open_library(const std::string & p_library_name)
+{
+  void * l_library = dlopen(p_library_name.c_str(),RTLD_NOW | RTLD_GLOBAL);
+  if(l_library == NULL)
+    {
+      std::stringstream l_stream;
+      l_stream << "Unable to load \"" << p_library_name << "\" : " << dlerror() ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  return l_library;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc,char ** argv)
+{
+  std::string l_module_name;
+  std::string l_api_library_name;
+  std::string l_api_symbol = "register_common_api";
+  std::string l_instance_name = "node_alignment_replay";
+  std::string l_directory;
+  std::vector<std::pair<std::string,std::string> > l_parameters;
+  std::vector<std::string> l_osm_files;
+  uint32_t l_latency_us = 0;
+  uint32_t l_jitter_us = 0;
+  bool l_verbose = false;
+  for(int l_index = 1 ; l_index < argc ; ++l_index)
+    {
+      std::string l_arg = argv[l_index];
+      bool l_has_value = l_index + 1 < argc;
+      if(l_arg == "--module" && l_has_value) l_module_name = argv[++l_index];
+      else if(l_arg == "--api-library" && l_has_value) l_api_library_name = argv[++l_index];
+      else if(l_arg == "--api-symbol" && l_has_value) l_api_symbol = argv[++l_index];
+      else if(l_arg == "--name" && l_has_value) l_instance_name = argv[++l_index];
+      else if(l_arg == "--param" && l_has_value)
+        {
+          std::string l_param = argv[++l_index];
+          std::string::size_type l_pos = l_param.find('=');
+          if(l_pos == std::string::npos)
+            {
+              usage(argv[0]);
+              return EXIT_FAILURE;
+            }
+          l_parameters.push_back(std::make_pair(l_param.substr(0,l_pos),l_param.substr(l_pos + 1)));
+        }
+      else if(l_arg == "--osm-file" && l_has_value) l_osm_files.push_back(argv[++l_index]);
+      else if(l_arg == "--latency-us" && l_has_value) l_latency_us = strtoul(argv[++l_index],NULL,10);
+      else if(l_arg == "--jitter-us" && l_has_value) l_jitter_us = strtoul(argv[++l_index],NULL,10);
+      else if(l_arg == "--verbose") l_verbose = true;
+      else if(l_arg.size() && l_arg[0] != '-' && l_directory == "") l_directory = l_arg;
+      else
+        {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+    }
+  if(l_module_name == "" || l_api_library_name == "" || l_directory == "")
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  try
+    {
+      std::vector<std::string> l_files;
+      list_osc_files(l_directory,l_files);
+      std::sort(l_files.begin(),l_files.end(),natural_less);
+      std::cout << l_files.size() << " osmChange files found in \"" << l_directory << "\"" << std::endl ;
+
+      // Common API implementation of host, used to parse files and to reach OSM API
+      void * l_api_library = open_library(l_api_library_name);
+      replay_common_api::load_backing((osm_diff_analyzer_if::module_library_if::t_register_function)get_symbol(l_api_library,l_api_library_name,l_api_symbol));
+      replay_common_api::set_verbose(l_verbose);
+
+      // Local files replace OSM API for node and way requests
+      if(l_osm_files.size())
+        {
+          double l_load_start = get_time();
+          for(std::vector<std::string>::const_iterator l_iter = l_osm_files.begin();
+              l_iter != l_osm_files.end();
+              ++l_iter)
+            {
+              local_common_api::load(*l_iter,(osm_diff_analyzer_if::common_api_if::t_get_osm_file_content)replay_common_api::get_backing_entry(osm_diff_analyzer_if::common_api_if::GET_OSM_FILE_CONTENT));
+            }
+          local_common_api::set_latency(l_latency_us,l_jitter_us);
+          uintptr_t l_local_api[COMMON_API_IF_SIZE];
+          for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+            {
+              l_local_api[l_index] = 0;
+            }
+          local_common_api::install(l_local_api);
+          for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+            {
+              if(l_local_api[l_index])
+                {
+                  replay_common_api::set_entry(l_index,l_local_api[l_index]);
+                }
+            }
+          std::cout << local_common_api::get_nb_nodes() << " nodes and " << local_common_api::get_nb_ways() << " ways loaded in " << get_time() - l_load_start << " s" << std::endl ;
+        }
+
+      // Module loading as done by soda host
+      void * l_module_library = open_library(l_module_name);
+      osm_diff_analyzer_if::module_library_if::t_register_function l_register_module = (osm_diff_analyzer_if::module_library_if::t_register_function)get_symbol(l_module_library,l_module_name,"register_module");
+      uintptr_t l_module_api[MODULE_LIBRARY_IF_API_SIZE];
+      l_register_module(l_module_api,MODULE_LIBRARY_IF_API_SIZE);
+      ((osm_diff_analyzer_if::module_library_if::t_require_common_api)l_module_api[osm_diff_analyzer_if::module_library_if::REQUIRE_COMMON_API])(replay_common_api::register_function);
+
+      // Alerts are counted from binary alert stream unless user chose another format
+      osm_diff_analyzer_if::module_configuration l_conf(l_instance_name,"node_alignment");
+      bool l_alert_stream_set = false;
+      bool l_count_alerts = true;
+      for(std::vector<std::pair<std::string,std::string> >::const_iterator l_iter = l_parameters.begin();
+          l_iter != l_parameters.end();
+          ++l_iter)
+        {
+          l_conf.add_parameter(l_iter->first,l_iter->second);
+          if(l_iter->first == "alert_stream_format")
+            {
+              l_alert_stream_set = true;
+              l_count_alerts = l_iter->second == "binary";
+            }
+        }
+      if(!l_alert_stream_set)
+        {
+          l_conf.add_parameter("alert_stream_format","binary");
+        }
+      std::string l_alert_stream_name = l_instance_name + "_node_alignment_alerts.bin";
+      uint64_t l_initial_nb_alerts = count_alerts(l_alert_stream_name);
+
+      osm_diff_analyzer_if::general_analyzer_if * l_general_analyzer = ((osm_diff_analyzer_if::module_library_if::t_create_analyzer)l_module_api[osm_diff_analyzer_if::module_library_if::CREATE_ANALYZER])(&l_conf);
+      osm_diff_analyzer_cpp_if::cpp_analyzer_base * l_analyzer = dynamic_cast<osm_diff_analyzer_cpp_if::cpp_analyzer_base*>(l_general_analyzer);
+      if(l_analyzer == NULL)
+        {
+          throw quicky_exception::quicky_logic_exception("Module analyzer is not a cpp analyzer",__LINE__,__FILE__);
+        }
+
+      double l_parse_time = 0.0;
+      double l_analyze_time = 0.0;
+      uint64_t l_nb_elements = 0;
+      double l_start_time = get_time();
+      for(std::vector<std::string>::const_iterator l_iter = l_files.begin();
+          l_iter != l_files.end();
+          ++l_iter)
+        {
+          double l_time = get_time();
+          const std::vector<osm_api_data_types::osm_change*> * const l_changes = replay_common_api::get_osm_change_file_content(*l_iter);
+          double l_parsed_time = get_time();
+          l_parse_time += l_parsed_time - l_time;
+
+          osm_diff_analyzer_if::osm_diff_state l_diff_state(get_sequence_number(l_iter->substr(l_directory.size())),"");
+          l_analyzer->init(&l_diff_state);
+          l_analyzer->analyze(*l_changes);
+          l_analyze_time += get_time() - l_parsed_time;
+          l_nb_elements += l_changes->size();
+
+          for(std::vector<osm_api_data_types::osm_change*>::const_iterator l_change_iter = l_changes->begin();
+              l_change_iter != l_changes->end();
+              ++l_change_iter)
+            {
+              delete *l_change_iter;
+            }
+          delete l_changes;
+        }
+
+      // Analyzer only closes changesets absent from the diff preceding init
+      // and its destructor only the ones absent from the last analyzed
+      // diff : an empty diff is simulated so that changesets of last file
+      // are closed and analyzed when analyzer is destroyed
+      double l_time = get_time();
+      if(l_files.size())
+        {
+          osm_diff_analyzer_if::osm_diff_state l_diff_state(get_sequence_number(l_files.back().substr(l_directory.size())) + 1,"");
+          l_analyzer->init(&l_diff_state);
+        }
+      delete l_general_analyzer;
+      l_analyze_time += get_time() - l_time;
+      double l_total_time = get_time() - l_start_time;
+      ((osm_diff_analyzer_if::module_library_if::t_cleanup)l_module_api[osm_diff_analyzer_if::module_library_if::CLEAN_UP])();
+
+      uint64_t l_nb_alerts = !l_count_alerts ? 0 : count_alerts(l_alert_stream_name) - l_initial_nb_alerts;
+      uint64_t l_nb_diffs = l_files.size();
+      std::cout << std::fixed << std::setprecision(3) ;
+      std::cout << "Diffs    : " << l_nb_diffs << std::endl ;
+      std::cout << "Elements : " << l_nb_elements << std::endl ;
+      if(l_count_alerts)
+        {
+          std::cout << "Alerts   : " << l_nb_alerts << std::endl ;
+        }
+      std::cout << "Parsing  : " << l_parse_time << " s" << std::endl ;
+      std::cout << "Analysis : " << l_analyze_time << " s" << std::endl ;
+      std::cout << "Total    : " << l_total_time << " s" << std::endl ;
+      if(l_total_time > 0.0)
+        {
+          std::cout << "Throughput : " << l_nb_diffs / l_total_time << " diffs/s, " << l_nb_elements / l_total_time << " elements/s" ;
+          if(l_count_alerts)
+            {
+              std::cout << ", " << l_nb_alerts / l_total_time << " alerts/s" ;
+            }
+          std::cout << std::endl ;
+        }
+      if(l_analyze_time > 0.0)
+        {
+          std::cout << "Analysis throughput : " << l_nb_diffs / l_analyze_time << " diffs/s, " << l_nb_elements / l_analyze_time << " elements/s" << std::endl ;
+        }
+      std::map<std::string,uint64_t> l_call_statistics;
+      local_common_api::get_call_statistics(l_call_statistics);
+      for(std::map<std::string,uint64_t>::const_iterator l_iter = l_call_statistics.begin();
+          l_iter != l_call_statistics.end();
+          ++l_iter)
+        {
+          std::cout << "Local " << l_iter->first << " calls : " << l_iter->second << std::endl ;
+        }
+      local_common_api::release();
+      for(std::vector<std::string>::const_iterator l_iter = replay_common_api::get_declared_reports().begin();
+          l_iter != replay_common_api::get_declared_reports().end();
+          ++l_iter)
+        {
+          std::cout << "Report : " << *l_iter << std::endl ;
+        }
+    }
+  catch(quicky_exception::quicky_runtime_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return EXIT_FAILURE;
+    }
+  catch(quicky_exception::quicky_logic_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+//EOF
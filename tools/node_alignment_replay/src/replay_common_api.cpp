@@ -0,0 +1,136 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+#include "replay_common_api.h"
+#include "quicky_exception.h"
+#include <iostream>
+#include <sstream>
+#include <cassert>
+
+namespace osm_diff_analyzer_node_alignment
+{
+  //----------------------------------------------------------------------------
+  void replay_common_api::load_backing(osm_diff_analyzer_if::module_library_if::t_register_function p_backing_func)
+  {
+    for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+      {
+        m_backing_api[l_index] = 0;
+      }
+    p_backing_func(m_backing_api,COMMON_API_IF_SIZE);
+    for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+      {
+        m_api[l_index] = m_backing_api[l_index];
+      }
+    m_api[osm_diff_analyzer_if::common_api_if::UI_REGISTER_MODULE] = (uintptr_t)ui_register_module;
+    m_api[osm_diff_analyzer_if::common_api_if::UI_APPEND_LOG_TEXT] = (uintptr_t)ui_append_log_text;
+    m_api[osm_diff_analyzer_if::common_api_if::UI_DECLARE_HTML_REPORT] = (uintptr_t)ui_declare_html_report;
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::set_entry(const uint32_t & p_index,
+                                    uintptr_t p_function)
+  {
+    assert(p_index < COMMON_API_IF_SIZE);
+    m_api[p_index] = p_function;
+  }
+
+  //----------------------------------------------------------------------------
+  uintptr_t replay_common_api::get_backing_entry(const uint32_t & p_index)
+  {
+    assert(p_index < COMMON_API_IF_SIZE);
+    return m_backing_api[p_index];
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::register_function(uintptr_t * p_api,
+                                            uint32_t p_api_size)
+  {
+    if(p_api_size != COMMON_API_IF_SIZE)
+      {
+	std::stringstream l_stream;
+	l_stream << "p_api_size != COMMON_API_IF_SIZE : " << p_api_size << " != " << COMMON_API_IF_SIZE ;
+	throw quicky_exception::quicky_logic_exception(l_stream.str(),__LINE__,__FILE__);
+      }
+    for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+      {
+        p_api[l_index] = m_api[l_index];
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::set_verbose(bool p_verbose)
+  {
+    m_verbose = p_verbose;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<std::string> & replay_common_api::get_declared_reports(void)
+  {
+    return m_declared_reports;
+  }
+
+  //----------------------------------------------------------------------------
+  const std::vector<osm_api_data_types::osm_change*> * const replay_common_api::get_osm_change_file_content(const std::string & p_file_name)
+  {
+    osm_diff_analyzer_if::common_api_if::t_get_osm_change_file_content l_function = (osm_diff_analyzer_if::common_api_if::t_get_osm_change_file_content)m_api[osm_diff_analyzer_if::common_api_if::GET_OSM_CHANGE_FILE_CONTENT];
+    if(l_function == NULL)
+      {
+	throw quicky_exception::quicky_logic_exception("Common API implementation does not provide get_osm_change_file_content",__LINE__,__FILE__);
+      }
+    return l_function(p_file_name);
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::ui_register_module(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                             const std::string & p_text)
+  {
+    if(m_verbose)
+      {
+        std::cout << "[" << p_module.get_name() << "] registered : " << p_text << std::endl ;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::ui_append_log_text(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                             const std::string & p_text)
+  {
+    if(m_verbose)
+      {
+        std::cout << "[" << p_module.get_name() << "] " << p_text << std::endl ;
+      }
+  }
+
+  //----------------------------------------------------------------------------
+  void replay_common_api::ui_declare_html_report(const osm_diff_analyzer_if::analyzer_base & p_module,
+                                                 const std::string & p_name)
+  {
+    m_declared_reports.push_back(p_name);
+    if(m_verbose)
+      {
+        std::cout << "[" << p_module.get_name() << "] report " << p_name << std::endl ;
+      }
+  }
+
+  uintptr_t replay_common_api::m_backing_api[COMMON_API_IF_SIZE];
+  uintptr_t replay_common_api::m_api[COMMON_API_IF_SIZE];
+  bool replay_common_api::m_verbose = false;
+  std::vector<std::string> replay_common_api::m_declared_reports;
+}
+//EOF
@@ -0,0 +1,70 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Checks of node_alignment numeric building blocks. Exit status is the
+// number of failed checks
+
+#include "linear_regression.h"
+#include <iostream>
+#include <vector>
+#include <string>
+
+using namespace osm_diff_analyzer_node_alignment;
+
+static unsigned int g_nb_failures = 0;
+
+//------------------------------------------------------------------------------
+void check(bool p_condition,const std::string & p_description)
+{
+  std::cout << (p_condition ? "PASS" : "FAIL") << " : " << p_description << std::endl ;
+  if(!p_condition)
+    {
+      ++g_nb_failures;
+    }
+}
+
+//------------------------------------------------------------------------------
+// Nodes exactly aligned with centimetric spacing, given in analyzer
+// (lat,lon) order. Centering Y on the X average in the slope numerator is
+// equivalent in exact arithmetic but here subtracts 45 from values close
+// to -120 : the cancellation gives a slope of about 49 instead of 2 and
+// the way no longer looks aligned
+void test_linear_regression_aligned_nodes(void)
+{
+  std::vector<std::pair<double,double> > l_points;
+  for(unsigned int l_index = 0 ; l_index < 4 ; ++l_index)
+    {
+      double l_delta = l_index * 1e-7;
+      l_points.push_back(std::make_pair(45.0 + l_delta,-120.0 + 2 * l_delta));
+    }
+  linear_regression l_regression;
+  double l_sum = l_regression.compute(l_points);
+  check(l_sum < 1e-24,"residual sum of aligned nodes is null");
+  check(l_regression.get_max_alignment_square() < 1e-24,"max square deviation of aligned nodes is null");
+}
+
+//------------------------------------------------------------------------------
+int main(void)
+{
+  test_linear_regression_aligned_nodes();
+  std::cout << g_nb_failures << " failure(s)" << std::endl ;
+  return g_nb_failures;
+}
+//EOF
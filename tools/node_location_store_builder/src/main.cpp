@@ -0,0 +1,202 @@
+/*
+  This file is part of osm_diff_analyzer_node_alignment, Openstreetmap
+  diff analyzer based on CPP diff representation. It's aim is to survey
+  ways edited and to generate an alert in case of node alignment
+  Copyright (C) 2012  Julien Thevenon ( julien_thevenon at yahoo.fr )
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>
+*/
+
+// Build the dense node location store used by "node_location_store"
+// parameter and the node history store used by "node_history_store"
+// parameter from local .osm extracts. Files are parsed with the
+// get_osm_file_content entry of host common API implementation so big
+// areas should be given as several regional extracts
+
+#include "node_location_store.h"
+#include "node_history_store.h"
+#include "common_api_if.h"
+#include "module_library_if.h"
+#include "osm_api_data_types.h"
+#include "quicky_exception.h"
+#include <dlfcn.h>
+#include <sys/time.h>
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+
+using namespace osm_diff_analyzer_node_alignment;
+
+//------------------------------------------------------------------------------
+void usage(const std::string & p_name)
+{
+  std::cerr << "Usage : " << p_name << " --api-library <host_api.so> [--api-symbol <name>] [--location-store <file>] [--history-store <file>] <extract.osm> [<extract.osm> ...]" << std::endl ;
+  std::cerr << "  --api-symbol <name>      : function of API library filling common API table (default register_common_api)" << std::endl ;
+  std::cerr << "  --location-store <file>  : node location store filled with last version of nodes" << std::endl ;
+  std::cerr << "  --history-store <file>   : node history store filled with every node version, extracts should be full history ones" << std::endl ;
+  std::cerr << "At least one store is needed. Existing stores are updated : nodes of extracts overwrite stored locations and versions" << std::endl ;
+}
+
+//------------------------------------------------------------------------------
+double get_time(void)
+{
+  struct timeval l_time;
+  gettimeofday(&l_time,NULL);
+  return l_time.tv_sec + l_time.tv_usec / 1000000.0;
+}
+
+//------------------------------------------------------------------------------
+void * get_symbol(void * p_library,
+                  const std::string & p_library_name,
+                  const std::string & p_symbol)
+{
+  void * l_symbol = dlsym(p_library,p_symbol.c_str());
+  if(l_symbol == NULL)
+    {
+      std::stringstream l_stream;
+      l_stream << "Unable to find symbol \"" << p_symbol << "\" in \"" << p_library_name << "\" : " << dlerror() ;
+      throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+    }
+  return l_symbol;
+}
+
+//------------------------------------------------------------------------------
+int main(int argc,char ** argv)
+{
+  std::string l_api_library_name;
+  std::string l_api_symbol = "register_common_api";
+  std::string l_location_store_name;
+  std::string l_history_store_name;
+  std::vector<std::string> l_files;
+  for(int l_index = 1 ; l_index < argc ; ++l_index)
+    {
+      std::string l_arg = argv[l_index];
+      bool l_has_value = l_index + 1 < argc;
+      if(l_arg == "--api-library" && l_has_value) l_api_library_name = argv[++l_index];
+      else if(l_arg == "--api-symbol" && l_has_value) l_api_symbol = argv[++l_index];
+      else if(l_arg == "--location-store" && l_has_value) l_location_store_name = argv[++l_index];
+      else if(l_arg == "--history-store" && l_has_value) l_history_store_name = argv[++l_index];
+      else if(l_arg.size() && l_arg[0] != '-') l_files.push_back(l_arg);
+      else
+        {
+          usage(argv[0]);
+          return EXIT_FAILURE;
+        }
+    }
+  if(l_api_library_name == "" || (l_location_store_name == "" && l_history_store_name == "") || l_files.empty())
+    {
+      usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  try
+    {
+      void * l_api_library = dlopen(l_api_library_name.c_str(),RTLD_NOW | RTLD_GLOBAL);
+      if(l_api_library == NULL)
+        {
+          std::stringstream l_stream;
+          l_stream << "Unable to load \"" << l_api_library_name << "\" : " << dlerror() ;
+          throw quicky_exception::quicky_runtime_exception(l_stream.str(),__LINE__,__FILE__);
+        }
+      uintptr_t l_api[COMMON_API_IF_SIZE];
+      for(uint32_t l_index = 0 ; l_index < COMMON_API_IF_SIZE ; ++l_index)
+        {
+          l_api[l_index] = 0;
+        }
+      ((osm_diff_analyzer_if::module_library_if::t_register_function)get_symbol(l_api_library,l_api_library_name,l_api_symbol))(l_api,COMMON_API_IF_SIZE);
+      osm_diff_analyzer_if::common_api_if::t_get_osm_file_content l_parser = (osm_diff_analyzer_if::common_api_if::t_get_osm_file_content)l_api[osm_diff_analyzer_if::common_api_if::GET_OSM_FILE_CONTENT];
+      if(l_parser == NULL)
+        {
+          throw quicky_exception::quicky_runtime_exception("API library does not provide get_osm_file_content",__LINE__,__FILE__);
+        }
+
+      node_location_store * l_location_store = l_location_store_name != "" ? new node_location_store(l_location_store_name) : NULL;
+      node_history_store * l_history_store = NULL;
+      if(l_history_store_name != "")
+        {
+          l_history_store = new node_history_store(l_history_store_name);
+          // Versions of an extract are appended as a single run
+          l_history_store->set_max_pending(0);
+        }
+      uint64_t l_nb_nodes = 0;
+      for(std::vector<std::string>::const_iterator l_iter = l_files.begin();
+          l_iter != l_files.end();
+          ++l_iter)
+        {
+          double l_start = get_time();
+          std::vector<osm_api_data_types::osm_node*> l_nodes;
+          std::vector<osm_api_data_types::osm_way*> l_ways;
+          std::vector<osm_api_data_types::osm_relation*> l_relations;
+          l_parser(*l_iter,l_nodes,l_ways,l_relations);
+          for(std::vector<osm_api_data_types::osm_node*>::iterator l_iter_node = l_nodes.begin();
+              l_iter_node != l_nodes.end();
+              ++l_iter_node)
+            {
+              if(l_location_store != NULL)
+                {
+                  l_location_store->set((*l_iter_node)->get_id(),(*l_iter_node)->get_lat(),(*l_iter_node)->get_lon());
+                }
+              if(l_history_store != NULL)
+                {
+                  l_history_store->add((*l_iter_node)->get_id(),(*l_iter_node)->get_version(),(*l_iter_node)->get_lat(),(*l_iter_node)->get_lon());
+                }
+              delete *l_iter_node;
+            }
+          for(std::vector<osm_api_data_types::osm_way*>::iterator l_iter_way = l_ways.begin();
+              l_iter_way != l_ways.end();
+              ++l_iter_way)
+            {
+              delete *l_iter_way;
+            }
+          for(std::vector<osm_api_data_types::osm_relation*>::iterator l_iter_relation = l_relations.begin();
+              l_iter_relation != l_relations.end();
+              ++l_iter_relation)
+            {
+              delete *l_iter_relation;
+            }
+          if(l_history_store != NULL)
+            {
+              l_history_store->flush();
+            }
+          l_nb_nodes += l_nodes.size();
+          std::cout << l_nodes.size() << " nodes of \"" << *l_iter << "\" stored in " << get_time() - l_start << " s" << std::endl ;
+        }
+      if(l_location_store != NULL)
+        {
+          l_location_store->sync();
+          std::cout << l_nb_nodes << " nodes stored in \"" << l_location_store_name << "\", capacity " << l_location_store->get_capacity() << " nodes" << std::endl ;
+          delete l_location_store;
+        }
+      if(l_history_store != NULL)
+        {
+          // A single run gives the fastest lookups
+          double l_start = get_time();
+          l_history_store->compact();
+          std::cout << l_history_store->get_nb_records() << " node versions stored in \"" << l_history_store_name << "\", compacted in " << get_time() - l_start << " s" << std::endl ;
+          delete l_history_store;
+        }
+    }
+  catch(quicky_exception::quicky_runtime_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return EXIT_FAILURE;
+    }
+  catch(quicky_exception::quicky_logic_exception & e)
+    {
+      std::cerr << "ERROR : " << e.what() << std::endl ;
+      return EXIT_FAILURE;
+    }
+  return EXIT_SUCCESS;
+}
+//EOF